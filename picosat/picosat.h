@@ -56,10 +56,22 @@ void picosat_set_resize (void *, void * (*)(void *, void *, size_t, size_t));
 void picosat_set_delete (void *, void (*)(void *, void *, size_t));
 
 /*------------------------------------------------------------------------*/
+/* The complete state of a solver is kept in an opaque 'PicoSAT' instance.
+ * All other functions of this API operate on the instance currently
+ * selected by the calling thread.  'picosat_init' creates a new instance
+ * and selects it, 'picosat_reset' deletes the selected instance.  Several
+ * instances may be alive at the same time; use 'picosat_select' to switch
+ * between them.  Different threads may use different instances
+ * concurrently, but one instance must not be used by two threads at once.
+ */
+typedef struct PicoSAT PicoSAT;
 
-void picosat_init (void);               /* constructor */
+PicoSAT * picosat_init (void);          /* constructor */
 void picosat_reset (void);              /* destructor */
 
+PicoSAT * picosat_current (void);       /* selected instance or 0 */
+void picosat_select (PicoSAT *);        /* select instance for this thread */
+
 /*------------------------------------------------------------------------*/
 /* The following five functions are essentially parameters to 'init', and
  * thus should be called right after 'picosat_init' before doing anything
@@ -0,0 +1,262 @@
+/*
+ *   undertaker - index of analyzed files for incremental runs
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AnalysisIndex.h"
+#include "CnfConfigurationModel.h"
+#include "ConditionalBlock.h"
+#include "ModelContainer.h"
+#include "QueryCache.h"
+#include "StringJoiner.h"
+#include "Logging.h"
+#include "Tools.h"
+#include "bool.h"
+#include "exceptions/IOException.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <boost/filesystem.hpp>
+
+
+namespace {
+    // XXX do not modify without changing the tag, lines of other versions are ignored then
+    const std::string lineTag = "UAI1";
+    // of contentHash(), the hex digits of a 64 bit hash
+    const size_t hashLength = 16;
+    // stands for the empty hash of a file that couldn't be read
+    const std::string unreadable(hashLength, '-');
+
+    std::string toHex(uint64_t value) {
+        char buf[17];
+        snprintf(buf, sizeof(buf), "%016" PRIx64, value);
+        return buf;
+    }
+
+    // unlike std::getline, keeps empty fields, also the last one
+    std::vector<std::string> split(const std::string &str, char separator) {
+        std::vector<std::string> fields;
+        size_t start = 0, end;
+        while ((end = str.find(separator, start)) != std::string::npos) {
+            fields.push_back(str.substr(start, end - start));
+            start = end + 1;
+        }
+        fields.push_back(str.substr(start));
+        return fields;
+    }
+
+    std::vector<std::string> splitList(const std::string &str) {
+        std::vector<std::string> list;
+        for (const std::string &s : split(str, ' '))
+            if (!s.empty())
+                list.push_back(s);
+        return list;
+    }
+
+    std::string join(const std::string &name, const std::string &content,
+                     const std::map<std::string, std::string> &includes,
+                     const std::string &slice, const std::set<std::string> &items,
+                     const std::vector<std::string> &reports) {
+        StringJoiner sj_includes, sj_items, sj_reports;
+        // the hashes have a fixed length, they are followed by the name of the file
+        for (const auto &include : includes)  // pair<string, string>
+            sj_includes.push_back((include.second.empty() ? unreadable : include.second)
+                                  + include.first);
+        sj_items.insert(sj_items.end(), items.begin(), items.end());
+        sj_reports.insert(sj_reports.end(), reports.begin(), reports.end());
+        // the lists may be empty, the fields are kept nevertheless
+        return lineTag + "\t" + name + "\t" + content + "\t" + sj_includes.join(" ") + "\t"
+            + slice + "\t" + sj_items.join(" ") + "\t" + sj_reports.join(" ") + "\n";
+    }
+} // namespace
+
+AnalysisIndex &AnalysisIndex::getInstance() {
+    static AnalysisIndex instance;
+    return instance;
+}
+
+AnalysisIndex::~AnalysisIndex() {
+    if (fd >= 0)
+        close(fd);
+}
+
+void AnalysisIndex::enable(const std::string &file, const std::string &settings) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (fd >= 0)
+        close(fd);
+    fd = -1;
+    entries.clear();
+    this->settings = settings;
+
+    const int newFd = open(file.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (newFd < 0)
+        throw kconfig::IOException("could not open index " + file);
+    // appends of other runs wait until the index is compacted, see record()
+    flock(newFd, LOCK_EX);
+    std::ifstream in(file);
+    std::string line;
+    int ignored = 0;
+    while (std::getline(in, line)) {
+        const std::vector<std::string> fields = split(line, '\t');
+        if (fields.size() != 7 || fields[0] != lineTag) {
+            ignored++;
+            continue;
+        }
+        Entry entry;
+        entry.content = fields[2];
+        bool valid = true;
+        for (const std::string &include : splitList(fields[3])) {
+            if (include.size() <= hashLength) {
+                valid = false;
+                break;
+            }
+            const std::string hash = include.substr(0, hashLength);
+            entry.includes[include.substr(hashLength)] = hash == unreadable ? "" : hash;
+        }
+        if (!valid) {
+            ignored++;
+            continue;
+        }
+        entry.slice = fields[4];
+        const std::vector<std::string> items = splitList(fields[5]);
+        entry.items = std::set<std::string>(items.begin(), items.end());
+        entry.reports = splitList(fields[6]);
+        entries[fields[1]] = std::move(entry);
+    }
+    if (ignored > 0)
+        Logging::warn("ignored ", ignored, " lines of the index ", file,
+                      ", they're corrupt or of another version");
+
+    /*
+     * Compact the index, only the last line of each file is kept. It is
+     * rewritten in place, as other runs that opened it before keep
+     * appending to it; lines cut off by a crash are ignored on loading.
+     */
+    std::string compacted;
+    for (const auto &entry : entries)  // pair<string, Entry>
+        compacted += join(entry.first, entry.second.content, entry.second.includes,
+                          entry.second.slice, entry.second.items, entry.second.reports);
+    const bool written = ftruncate(newFd, 0) == 0
+        && write(newFd, compacted.data(), compacted.size()) == (ssize_t) compacted.size();
+    flock(newFd, LOCK_UN);
+    if (!written) {
+        close(newFd);
+        throw kconfig::IOException("could not write index " + file);
+    }
+    fd = newFd;
+    Logging::info("loaded ", entries.size(), " files from index ", file);
+}
+
+bool AnalysisIndex::isUpToDate(const std::string &filename) {
+    Entry entry;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        const auto it = entries.find(filename);
+        if (it == entries.end())
+            return false;
+        entry = it->second;
+    }
+    if (entry.content != contentHash(filename)) {
+        Logging::debug(filename, " changed since the last run");
+        return false;
+    }
+    for (const auto &include : entry.includes)  // pair<string, string>
+        if (include.second != contentHash(include.first)) {
+            Logging::debug("the included file ", include.first, " changed since the last run");
+            return false;
+        }
+    for (const std::string &report : entry.reports)
+        if (!boost::filesystem::exists(report)) {
+            Logging::debug("the report ", report, " is missing");
+            return false;
+        }
+    if (entry.slice != sliceHash(entry.items)) {
+        Logging::debug("the model slice of ", filename, " changed since the last run");
+        return false;
+    }
+    return true;
+}
+
+void AnalysisIndex::record(const std::string &filename, CppFile &file,
+                           const std::vector<std::string> &reports) {
+    ConditionalBlock *top = file.topBlock();
+    Entry entry;
+    entry.content = contentHash(filename);
+    for (const std::string &include : file.getIncludedFiles())
+        entry.includes[include] = contentHash(include);
+    // only looked up once, so it is not cached like in itemsOfString
+    entry.items = kconfig::BoolExp::symbolsOfString(top->getCodeConstraints() + " && "
+                                                    + top->getBuildSystemCondition());
+    entry.slice = sliceHash(entry.items);
+    entry.reports = reports;
+
+    const std::string line
+        = join(filename, entry.content, entry.includes, entry.slice, entry.items, entry.reports);
+    std::lock_guard<std::mutex> guard(lock);
+    entries[filename] = std::move(entry);
+    // a single write with O_APPEND doesn't interleave with the ones of other processes
+    flock(fd, LOCK_SH);
+    if (write(fd, line.data(), line.size()) != (ssize_t) line.size())
+        Logging::warn("could not write to the index");
+    flock(fd, LOCK_UN);
+}
+
+std::string AnalysisIndex::contentHash(const std::string &filename) {
+    std::ifstream in(filename, std::ios_base::binary);
+    if (!in.good())
+        return "";
+    std::ostringstream content;
+    content << in.rdbuf();
+    return toHex(QueryCache::hash(content.str()));
+}
+
+std::string AnalysisIndex::sliceHash(const std::set<std::string> &items) const {
+    QueryCache &cache = QueryCache::getInstance();
+    std::vector<uint64_t> parts{QueryCache::hash(settings)};
+
+    // only the items are taken from the expression
+    StringJoiner sj;
+    sj.insert(sj.end(), items.begin(), items.end());
+    const std::string exp = sj.join(" && ");
+
+    // the crosscheck of defects uses all models
+    for (const auto &entry : ModelContainer::getInstance()) {  // pair<string, ConfigurationModel *>
+        const ConfigurationModel *model = entry.second;
+        std::set<std::string> missing;
+        std::string intersected;
+        model->doIntersect(exp, nullptr, missing, intersected);
+
+        StringJoiner sj_missing;
+        sj_missing.insert(sj_missing.end(), missing.begin(), missing.end());
+        // cnf models aren't sliced, the whole model is part of the key
+        const CnfConfigurationModel *cnf = dynamic_cast<const CnfConfigurationModel *>(model);
+        const QueryCache::Key key = cache.key(cnf ? cnf->getCNF() : nullptr,
+                                              {QueryCache::hash(entry.first),
+                                               QueryCache::hash(intersected),
+                                               QueryCache::hash(sj_missing.join(" ")),
+                                               model->isComplete() ? 1u : 0u});
+        parts.push_back(key.hi);
+        parts.push_back(key.lo);
+    }
+    parts.push_back(QueryCache::hash("main " + ModelContainer::getMainModel()));
+
+    const QueryCache::Key key = cache.key(nullptr, parts);
+    return toHex(key.hi) + toHex(key.lo);
+}
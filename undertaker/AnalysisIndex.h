@@ -0,0 +1,92 @@
+/*
+ *   undertaker - index of analyzed files for incremental runs
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -*- mode: c++ -*-
+#ifndef analysis_index_h__
+#define analysis_index_h__
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+class CppFile;
+
+
+/**
+ * \brief Results of the dead block analysis of previous runs
+ *
+ * For every analyzed file, the index stores the hash of its content and
+ * of the content of each file it #included, the items its code
+ * constraints refer to (like the 'cppsym' job), a hash of the slice of
+ * all loaded models for these items, and the defect reports written for
+ * it. A file needs no new analysis as long as its content, its included
+ * files and the slice of its items stay the same and its reports still
+ * exist. The slice is computed without parsing the file, so
+ * unchanged files of a new tree or of a changed model are only hashed.
+ *
+ * The index is a text file with one tab separated line per file, the
+ * last line of a file wins. It is compacted in place when it is
+ * loaded, under an exclusive flock() that appends of concurrent runs
+ * wait for. New lines are appended with single writes, so that forked
+ * workers and concurrent runs can share it.
+ */
+class AnalysisIndex {
+public:
+    //! the index of this process, disabled until enable() is called
+    static AnalysisIndex &getInstance();
+
+    /**
+     * Loads the index from 'file' and appends new results to it. Results
+     * are only reused if they were stored with the same 'settings'.
+     * @throws kconfig::IOException if 'file' can't be read or written
+     */
+    void enable(const std::string &file, const std::string &settings = "");
+    bool isEnabled() const { return fd >= 0; }
+
+    //! true if the stored reports of 'filename' are valid for the loaded models
+    bool isUpToDate(const std::string &filename);
+    //! stores that 'file', given as 'filename', was analyzed and 'reports' were written
+    void record(const std::string &filename, CppFile &file,
+                const std::vector<std::string> &reports);
+
+    //! hash of the content of 'filename', empty if it can't be read
+    static std::string contentHash(const std::string &filename);
+
+private:
+    struct Entry {
+        std::string content, slice;
+        std::map<std::string, std::string> includes;  // included file -> content hash
+        std::set<std::string> items;
+        std::vector<std::string> reports;
+    };
+
+    AnalysisIndex() = default;
+    ~AnalysisIndex();
+    AnalysisIndex(const AnalysisIndex &) = delete;
+    AnalysisIndex &operator=(const AnalysisIndex &) = delete;
+
+    //! hash of the slices of all loaded models for 'items'
+    std::string sliceHash(const std::set<std::string> &items) const;
+
+    std::map<std::string, Entry> entries;
+    std::mutex lock;
+    std::string settings;
+    int fd = -1;
+};
+#endif
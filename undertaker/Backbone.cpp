@@ -0,0 +1,217 @@
+/*
+ *   boolean framework for undertaker and satyr
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Backbone.h"
+#include "ClauseList.h"
+#include "KconfigWhitelist.h"
+#include "PicosatCNF.h"
+
+#include <utility>
+#include <vector>
+
+using namespace kconfig;
+
+
+const std::string Backbone::metaKey = "BACKBONE";
+
+namespace {
+    enum class Value { FALSE, TRUE, UNKNOWN };
+
+    Value fromBool(bool b) { return b ? Value::TRUE : Value::FALSE; }
+
+    /**
+     * \brief Kleene evaluation of formulas under the backbone and the
+     *        values derived from the formulas so far
+     */
+    class Propagation {
+        const std::unordered_map<std::string, bool> &backbone;
+        std::unordered_map<std::string, bool> derived;
+
+    public:
+        explicit Propagation(const std::unordered_map<std::string, bool> &backbone)
+            : backbone(backbone) {}
+
+        /**
+         * Symbols on the ignorelist are free variables in the SAT checks
+         * (see CNFBuilder), so neither their backbone value nor a value
+         * derived for one of their occurrences applies to the others.
+         */
+        static bool isFree(const std::string &var) {
+            return KconfigWhitelist::getIgnorelist().isWhitelisted(var);
+        }
+
+        void assign(const std::string &var, bool value) { derived[var] = value; }
+
+        Value value(const BoolExp *e) const {
+            if (const BoolExpConst *c = dynamic_cast<const BoolExpConst *>(e))
+                return fromBool(c->value);
+            if (dynamic_cast<const BoolExpVar *>(e)) {
+                if (isFree(e->getName()))
+                    return Value::UNKNOWN;
+                auto it = derived.find(e->getName());
+                if (it != derived.end())
+                    return fromBool(it->second);
+                it = backbone.find(e->getName());
+                return it != backbone.end() ? fromBool(it->second) : Value::UNKNOWN;
+            }
+            if (dynamic_cast<const BoolExpNot *>(e)) {
+                const Value v = value(e->right);
+                return v == Value::UNKNOWN ? v : fromBool(v == Value::FALSE);
+            }
+            const bool isAnd = dynamic_cast<const BoolExpAnd *>(e) != nullptr;
+            const bool isOr = dynamic_cast<const BoolExpOr *>(e) != nullptr;
+            const bool isImpl = dynamic_cast<const BoolExpImpl *>(e) != nullptr;
+            const bool isEq = dynamic_cast<const BoolExpEq *>(e) != nullptr;
+            if (!isAnd && !isOr && !isImpl && !isEq)
+                return Value::UNKNOWN;  // calls and C expressions
+
+            Value l = value(e->left);
+            const Value r = value(e->right);
+            if (isEq)
+                return (l == Value::UNKNOWN || r == Value::UNKNOWN) ? Value::UNKNOWN
+                                                                     : fromBool(l == r);
+            if (isImpl && l != Value::UNKNOWN)  // a -> b == !a || b
+                l = fromBool(l == Value::FALSE);
+            // the value that decides the connective on its own
+            const Value dominant = isAnd ? Value::FALSE : Value::TRUE;
+            if (l == dominant || r == dominant)
+                return dominant;
+            if (l == Value::UNKNOWN || r == Value::UNKNOWN)
+                return Value::UNKNOWN;
+            return fromBool(isAnd);
+        }
+    };
+} // namespace
+
+Backbone::Backbone(const std::deque<std::string> *meta) {
+    if (!meta)
+        return;
+    for (const std::string &lit : *meta) {
+        if (!lit.empty() && lit[0] == '!')
+            values[lit.substr(1)] = false;
+        else
+            values[lit] = true;
+    }
+}
+
+std::deque<std::string> Backbone::compute(const PicosatCNF &cnf) {
+    struct Candidate {
+        std::string name;
+        int lit;
+        bool value;
+        bool fixed;
+    };
+    std::deque<std::string> meta;
+    PicosatCNF work(&cnf, Picosat::SAT_MIN);
+    if (!work.checkSatisfiable())
+        return meta;
+
+    std::vector<Candidate> candidates;
+    for (const PicosatCNF *layer = &cnf; layer; layer = layer->getBase())
+        layer->forEachSymbol([&](const std::string &name, int lit) {
+            candidates.push_back({name, lit, work.deref(lit), true});
+        });
+    for (size_t i = 0; i < candidates.size(); i++) {
+        Candidate &c = candidates[i];
+        if (!c.fixed)
+            continue;
+        work.pushAssumption(c.value ? -c.lit : c.lit);
+        if (!work.checkSatisfiable()) {
+            // as a unit clause it speeds up the remaining checks
+            work.pushVar(c.value ? c.lit : -c.lit);
+            work.pushClause();
+            continue;
+        }
+        for (size_t j = i; j < candidates.size(); j++)
+            if (candidates[j].fixed && work.deref(candidates[j].lit) != candidates[j].value)
+                candidates[j].fixed = false;
+    }
+    for (const Candidate &c : candidates)
+        if (c.fixed)
+            meta.push_back(c.value ? c.name : "!" + c.name);
+    return meta;
+}
+
+bool Backbone::refutes(const ClauseList &clauses) const {
+    if (values.empty())
+        return false;
+    Propagation p(values);
+    // formulas and the value they must have
+    std::vector<std::pair<const BoolExp *, bool>> pending, next;
+    for (const BoolExp *e : clauses)
+        pending.emplace_back(e, true);
+
+    for (bool changed = true; changed;) {
+        changed = false;
+        next.clear();
+        for (const auto &entry : pending) {
+            const BoolExp *e = entry.first;
+            const bool want = entry.second;
+            const Value v = p.value(e);
+            if (v != Value::UNKNOWN) {
+                if ((v == Value::TRUE) != want)
+                    return true;
+                continue;
+            }
+            const size_t before = next.size();
+            if (dynamic_cast<const BoolExpVar *>(e)) {
+                if (!Propagation::isFree(e->getName())) {
+                    p.assign(e->getName(), want);
+                    changed = true;
+                    continue;
+                }
+            } else if (dynamic_cast<const BoolExpNot *>(e)) {
+                next.emplace_back(e->right, !want);
+            } else if (dynamic_cast<const BoolExpAnd *>(e) || dynamic_cast<const BoolExpOr *>(e)) {
+                const bool isAnd = dynamic_cast<const BoolExpAnd *>(e) != nullptr;
+                if (want == isAnd) {
+                    // a && b must be true, a || b must be false
+                    next.emplace_back(e->left, want);
+                    next.emplace_back(e->right, want);
+                } else {
+                    // one side is already neutral, the other one decides
+                    const Value neutral = fromBool(isAnd);
+                    if (p.value(e->left) == neutral)
+                        next.emplace_back(e->right, want);
+                    else if (p.value(e->right) == neutral)
+                        next.emplace_back(e->left, want);
+                }
+            } else if (dynamic_cast<const BoolExpImpl *>(e)) {
+                if (!want) {
+                    next.emplace_back(e->left, true);
+                    next.emplace_back(e->right, false);
+                } else if (p.value(e->left) == Value::TRUE) {
+                    next.emplace_back(e->right, true);
+                } else if (p.value(e->right) == Value::FALSE) {
+                    next.emplace_back(e->left, false);
+                }
+            } else if (dynamic_cast<const BoolExpEq *>(e)) {
+                const Value l = p.value(e->left), r = p.value(e->right);
+                if (l != Value::UNKNOWN)
+                    next.emplace_back(e->right, (l == Value::TRUE) == want);
+                else if (r != Value::UNKNOWN)
+                    next.emplace_back(e->left, (r == Value::TRUE) == want);
+            }
+            if (next.size() != before)
+                changed = true;
+            else
+                next.push_back(entry);  // undecided for now
+        }
+        pending.swap(next);
+    }
+    return false;
+}
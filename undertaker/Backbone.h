@@ -0,0 +1,74 @@
+/*
+ *   boolean framework for undertaker and satyr
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -*- mode: c++ -*-
+#ifndef KCONFIG_BACKBONE_H
+#define KCONFIG_BACKBONE_H
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+
+namespace kconfig {
+    class ClauseList;
+    class PicosatCNF;
+
+    /**
+     * \brief Named variables that have the same value in all solutions
+     *
+     * The backbone of a model is stored in its meta information under
+     * 'BACKBONE', variables that are always false are prefixed with '!'.
+     */
+    class Backbone {
+        std::unordered_map<std::string, bool> values;
+
+    public:
+        //! the key of the backbone in the meta information of models
+        static const std::string metaKey;
+
+        Backbone() = default;
+        //! reads the backbone from the values of the meta information
+        explicit Backbone(const std::deque<std::string> *meta);
+
+        /**
+         * \brief computes the backbone of 'cnf'
+         *
+         * Solves 'cnf' once and then tries to flip each named variable
+         * that wasn't flipped by an earlier solution. Every solution
+         * rules out all variables whose values differ from the first.
+         * Returns the meta values, which are empty if 'cnf' is
+         * unsatisfiable.
+         */
+        static std::deque<std::string> compute(const PicosatCNF &cnf);
+
+        bool empty() const { return values.empty(); }
+        size_t size() const { return values.size(); }
+
+        /**
+         * Returns true if the conjunction of 'clauses' can't be satisfied
+         * together with the backbone. The backbone values are propagated
+         * through the clauses, e.g., 'B1 && (B1 <-> CONFIG_A)' is refuted
+         * if CONFIG_A is always false. Returns false if that isn't enough
+         * to decide, a SAT checker has to be asked then. Nothing is known
+         * about symbols on the ignorelist, as they are free variables in
+         * the SAT checks.
+         */
+        bool refutes(const ClauseList &clauses) const;
+    };
+} // namespace kconfig
+#endif
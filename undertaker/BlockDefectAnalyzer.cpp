@@ -28,12 +28,21 @@
 #include "ModelContainer.h"
 #include "ConfigurationModel.h"
 #include "Logging.h"
+#include "ResultSink.h"
 #include "Tools.h"
 #include "exceptions/CNFBuilderError.h"
+#include "cpp14.h"
 
-#include <fstream>
+#include <sstream>
 
 
+//! checks a single formula with 'sc', nullptr is treated like ""
+static bool checkClause(SatChecker &sc, const kconfig::BoolExp *clause) {
+    kconfig::ClauseList clauses;
+    clauses.push_back(clause);
+    return sc(clauses);
+}
+
 /************************************************************************/
 /* BlockDefectAnalyzer                                                  */
 /************************************************************************/
@@ -65,21 +74,29 @@ std::string BlockDefectAnalyzer::getBlockPrecondition(ConditionalBlock *cb,
 }
 
 static const BlockDefect *analyzeBlock_helper(ConditionalBlock *block,
-                                              ConfigurationModel *main_model) {
-    BlockDefect *defect = new DeadBlockDefect(block);
-
-    // If this is neither an Implementation, Configuration nor Referential *dead*,
-    // then destroy the analysis and retry with an Undead Analysis
-    if (!defect->isDefect(main_model, true)) {
-        delete defect;
+                                              ConfigurationModel *main_model,
+                                              FileDefectFilter *filter) {
+    BlockDefect *defect = nullptr;
+
+    if (!filter || filter->mayBeDead(block)) {
+        defect = new DeadBlockDefect(block);
+        // If this is neither an Implementation, Configuration nor Referential *dead*,
+        // then destroy the analysis and retry with an Undead Analysis
+        if (!defect->isDefect(main_model, true)) {
+            delete defect;
+            defect = nullptr;
+        }
+    }
+    if (!defect && (!filter || filter->mayBeUndead(block))) {
         defect = new UndeadBlockDefect(block);
-
-        // No defect found, block seems OK
         if (!defect->isDefect(main_model, true)) {
             delete defect;
-            return nullptr;
+            defect = nullptr;
         }
     }
+    // No defect found, block seems OK
+    if (!defect)
+        return nullptr;
     assert(defect->defectType() != BlockDefect::DEFECTTYPE::None);
 
     // Check NoKconfig defect after (un)dead analysis
@@ -114,9 +131,10 @@ static const BlockDefect *analyzeBlock_helper(ConditionalBlock *block,
 }
 
 const BlockDefect *BlockDefectAnalyzer::analyzeBlock(ConditionalBlock *block,
-                                                     ConfigurationModel *main_model) {
+                                                     ConfigurationModel *main_model,
+                                                     FileDefectFilter *filter) {
     try {
-        return analyzeBlock_helper(block, main_model);
+        return analyzeBlock_helper(block, main_model, filter);
     } catch (CNFBuilderError &e) {
         Logging::error("Couldn't process ", block->getFile()->getFilename(), ":", block->getName(),
                        ": ", e.what());
@@ -127,6 +145,67 @@ const BlockDefect *BlockDefectAnalyzer::analyzeBlock(ConditionalBlock *block,
     return nullptr;
 }
 
+/************************************************************************/
+/* FileDefectFilter                                                     */
+/************************************************************************/
+
+FileDefectFilter::FileDefectFilter(CppFile *file, const ConfigurationModel *model) {
+    ConditionalBlock *top = file->topBlock();
+    // the same steps as in DeadBlockDefect::isDefect, but for all items of the file
+    try {
+        _sc = make_unique<SatChecker>(model);
+        _sc->sliceModel();
+        _sc->cacheResults();
+        std::string code_formula = top->getCodeConstraints();
+        (*_sc)(top->getCodeClauses());
+
+        if (model) {
+            std::set<std::string> missingSet;
+            std::string kconfig_formula;
+            kconfig::ClauseList kconfig_clauses(false);
+            std::set<std::string> kconfigItems = model->doIntersect(code_formula,
+                                                                    file->getDefineChecker(),
+                                                                    missingSet, kconfig_formula,
+                                                                    nullptr, &kconfig_clauses);
+            (*_sc)(kconfig_clauses);
+
+            std::string precondition = top->getBuildSystemCondition();
+            std::string precondition_formula;
+            kconfig::ClauseList precondition_clauses(false);
+            model->doIntersect(precondition, nullptr, missingSet, precondition_formula,
+                               &kconfigItems, &precondition_clauses);
+            checkClause(*_sc, top->getBuildSystemClause());
+            (*_sc)(precondition_clauses);
+
+            if (model->isComplete())
+                checkClause(*_sc,
+                            ConfigurationModel::getMissingItemsClause(missingSet).get());
+        }
+    } catch (CNFBuilderError &e) {
+        Logging::debug("Analyzing all blocks of ", file->getFilename(), " on their own: ",
+                       e.what());
+        _sc.reset();
+    } catch (std::bad_alloc &) {
+        Logging::debug("Analyzing all blocks of ", file->getFilename(), " on their own: ",
+                       "Out of Memory.");
+        _sc.reset();
+    }
+}
+
+FileDefectFilter::~FileDefectFilter() {}
+
+bool FileDefectFilter::mayBeDead(const ConditionalBlock *block) {
+    return !_sc || !_sc->checkAssuming({{block->getName(), true}});
+}
+
+bool FileDefectFilter::mayBeUndead(const ConditionalBlock *block) {
+    const ConditionalBlock *parent = block->getParent();
+    // B00 can't be undead
+    if (!parent)
+        return false;
+    return !_sc || !_sc->checkAssuming({{parent->getName(), true}, {block->getName(), false}});
+}
+
 /************************************************************************/
 /* BlockDefect                                                          */
 /************************************************************************/
@@ -198,25 +277,21 @@ bool BlockDefect::isNoKconfigDefect(const ConfigurationModel *model) const {
         // Otherwise, take the expression.
         expr = _cb->ifdefExpression();
     }
-    for (const std::string &str : undertaker::itemsOfString(expr))
+    const auto items = undertaker::itemsOfString(expr);
+    for (const std::string &str : *items)
         if (model->inConfigurationSpace(str))
             return false;
 
     return true;
 }
 
-void BlockDefect::writeReportToFile(bool skip_no_kconfig) const {
+bool BlockDefect::writeReportToFile(bool skip_no_kconfig) const {
     if ((skip_no_kconfig && _defectType == DEFECTTYPE::NoKconfig)
         || _defectType == DEFECTTYPE::None)
-        return;
+        return false;
     const std::string filename = getDefectReportFilename();
 
-    std::ofstream out(filename);
-
-    if (!out.good()) {
-        Logging::error("failed to open ", filename, " for writing ");
-        return;
-    }
+    std::ostringstream out;
     Logging::info("creating ", filename);
     out << "#" << _cb->getName() << ":" << _cb->filename() << ":" << _cb->lineStart() << ":"
         << _cb->colStart() << ":" << _cb->filename() << ":" << _cb->lineEnd() << ":"
@@ -234,7 +309,7 @@ void BlockDefect::writeReportToFile(bool skip_no_kconfig) const {
             }
             return retstr;
         }();
-    out.close();
+    return ResultSink::getInstance().write(filename, out.str());
 }
 
 /************************************************************************/
@@ -257,14 +332,11 @@ void DeadBlockDefect::reportMUS(ConfigurationModel *main_model) const {
 
     // create filename for mus-defect report and open the outputfilestream
     std::string filename = this->getDefectReportFilename() + ".mus";
-    std::ofstream ofs(filename);
-    if (!ofs.good()) {
-        Logging::error("Failed to open ", filename, " for writing.");
-        return;
-    }
+    std::ostringstream ofs;
     Logging::info("creating ", filename);
     // print formula and prepend some statistics about the picomus performance
     sc.writeMUS(ofs);
+    ResultSink::getInstance().write(filename, ofs.str());
 }
 
 bool DeadBlockDefect::isDefect(const ConfigurationModel *model, bool is_main_model) {
@@ -275,9 +347,17 @@ bool DeadBlockDefect::isDefect(const ConfigurationModel *model, bool is_main_mod
     formula.push_back(code_formula);
     _formula = formula.join("\n&&\n");
 
+    // the strings are only kept for the reports, the checks use the same formulas in memory
+    const std::unique_ptr<kconfig::BoolExp> block(new kconfig::BoolExpVar(_cb->getName(), false));
+    kconfig::ClauseList clauses(false);
+    clauses.push_back(block.get());
+    clauses.append(_cb->getCodeClauses());
+
     // check for code defect
     SatChecker sc;
-    if (!sc(_formula)) {
+    sc.sliceModel();
+    sc.cacheResults();
+    if (!sc(clauses)) {
         _defectType = DEFECTTYPE::Implementation;
         _isGlobal = true;
         _musFormula = _formula;
@@ -290,15 +370,21 @@ bool DeadBlockDefect::isDefect(const ConfigurationModel *model, bool is_main_mod
     // check for kconfig defect
     std::set<std::string> missingSet;
     std::string kconfig_formula;
+    kconfig::ClauseList kconfig_clauses(false);
     std::set<std::string> kconfigItems = model->doIntersect(code_formula,
                                                             _cb->getFile()->getDefineChecker(),
-                                                            missingSet, kconfig_formula);
+                                                            missingSet, kconfig_formula,
+                                                            nullptr, &kconfig_clauses);
     formula.push_back(kconfig_formula);
 
     // increment sc with kconfig_formula and load model if necessary
     if (model->getModelVersionIdentifier() == "cnf")
         sc.loadCnfModel(model);
-    if (!sc(kconfig_formula)) {
+    // the backbone of the model may rule the block out without asking the solver
+    kconfig::ClauseList checked(false);
+    checked.append(clauses);
+    checked.append(kconfig_clauses);
+    if (model->contradictsBackbone(checked) || !sc(kconfig_clauses)) {
         _formula = formula.join("\n&&\n");
         // save formula for mus analysis when we are analysing the main_model
         if (is_main_model)
@@ -312,12 +398,16 @@ bool DeadBlockDefect::isDefect(const ConfigurationModel *model, bool is_main_mod
     // check for kbuild defect
     std::string precondition = _cb->getBuildSystemCondition();
     std::string precondition_formula;
-    model->doIntersect(precondition, nullptr, missingSet, precondition_formula, &kconfigItems);
+    kconfig::ClauseList precondition_clauses(false);
+    model->doIntersect(precondition, nullptr, missingSet, precondition_formula, &kconfigItems,
+                       &precondition_clauses);
     if (precondition_formula.size() > 0)
         precondition_formula += "\n&& ";
     precondition_formula += precondition;
+    precondition_clauses.push_back(_cb->getBuildSystemClause());
     formula.push_back(precondition_formula);
-    if (!sc(precondition_formula)) {
+    checked.append(precondition_clauses);
+    if (model->contradictsBackbone(checked) || !sc(precondition_clauses)) {
         _formula = formula.join("\n&&\n");
         if (is_main_model)
             _musFormula = _formula;
@@ -332,7 +422,7 @@ bool DeadBlockDefect::isDefect(const ConfigurationModel *model, bool is_main_mod
 
     // check for missing defect
     std::string missing = ConfigurationModel::getMissingItemsConstraints(missingSet);
-    if (!sc(missing)) {
+    if (!checkClause(sc, ConfigurationModel::getMissingItemsClause(missingSet).get())) {
         formula.push_back(missing);
         _formula = formula.join("\n&&\n");
         if (_defectType != DEFECTTYPE::Configuration && _defectType != DEFECTTYPE::BuildSystem)
@@ -367,9 +457,19 @@ bool UndeadBlockDefect::isDefect(const ConfigurationModel *model, bool) {
     formula.push_back(code_formula);
     _formula = formula.join("\n&&\n");
 
+    // the strings are only kept for the reports, the checks use the same formulas in memory
+    const std::unique_ptr<kconfig::BoolExp> block(new kconfig::BoolExpAnd(
+        new kconfig::BoolExpVar(parent->getName(), false),
+        new kconfig::BoolExpNot(new kconfig::BoolExpVar(_cb->getName(), false))));
+    kconfig::ClauseList clauses(false);
+    clauses.push_back(block.get());
+    clauses.append(_cb->getCodeClauses());
+
     // check for code defect
     SatChecker sc;
-    if (!sc(_formula)) {
+    sc.sliceModel();
+    sc.cacheResults();
+    if (!sc(clauses)) {
         _defectType = DEFECTTYPE::Implementation;
         _isGlobal = true;
         return true;
@@ -381,15 +481,21 @@ bool UndeadBlockDefect::isDefect(const ConfigurationModel *model, bool) {
     // check for kconfig defect
     std::set<std::string> missingSet;
     std::string kconfig_formula;
+    kconfig::ClauseList kconfig_clauses(false);
     std::set<std::string> kconfigItems = model->doIntersect(code_formula,
                                                             _cb->getFile()->getDefineChecker(),
-                                                            missingSet, kconfig_formula);
+                                                            missingSet, kconfig_formula,
+                                                            nullptr, &kconfig_clauses);
     formula.push_back(kconfig_formula);
 
     // increment sc with kconfig_formula and load model if necessary
     if (model->getModelVersionIdentifier() == "cnf")
         sc.loadCnfModel(model);
-    if (!sc(kconfig_formula)) {
+    // the backbone of the model may rule the block out without asking the solver
+    kconfig::ClauseList checked(false);
+    checked.append(clauses);
+    checked.append(kconfig_clauses);
+    if (model->contradictsBackbone(checked) || !sc(kconfig_clauses)) {
         _formula = formula.join("\n&&\n");
         if (_defectType != DEFECTTYPE::BuildSystem)
             _defectType = DEFECTTYPE::Configuration;
@@ -400,12 +506,16 @@ bool UndeadBlockDefect::isDefect(const ConfigurationModel *model, bool) {
     // check for kbuild defect
     std::string precondition = _cb->getBuildSystemCondition();
     std::string precondition_formula;
-    model->doIntersect(precondition, nullptr, missingSet, precondition_formula, &kconfigItems);
+    kconfig::ClauseList precondition_clauses(false);
+    model->doIntersect(precondition, nullptr, missingSet, precondition_formula, &kconfigItems,
+                       &precondition_clauses);
     if (precondition_formula.size() > 0)
         precondition_formula += "\n&& ";
     precondition_formula += precondition;
+    precondition_clauses.push_back(_cb->getBuildSystemClause());
     formula.push_back(precondition_formula);
-    if (!sc(precondition_formula)) {
+    checked.append(precondition_clauses);
+    if (model->contradictsBackbone(checked) || !sc(precondition_clauses)) {
         _formula = formula.join("\n&&\n");
         _defectType = DEFECTTYPE::BuildSystem;
         defectMap.emplace(ModelContainer::lookupArch(model), "kbuild");
@@ -418,7 +528,7 @@ bool UndeadBlockDefect::isDefect(const ConfigurationModel *model, bool) {
 
     // check for missing defect
     std::string missing = ConfigurationModel::getMissingItemsConstraints(missingSet);
-    if (!sc(missing)) {
+    if (!checkClause(sc, ConfigurationModel::getMissingItemsClause(missingSet).get())) {
         formula.push_back(missing);
         _formula = formula.join("\n&&\n");
         if (_defectType != DEFECTTYPE::Configuration && _defectType != DEFECTTYPE::BuildSystem)
@@ -36,10 +36,43 @@
 
 #include <string>
 #include <map>
+#include <memory>
 
 class ConditionalBlock;
 class ConfigurationModel;
 class BlockDefect;
+class CppFile;
+class SatChecker;
+
+
+/************************************************************************/
+/* FileDefectFilter                                                     */
+/************************************************************************/
+
+/**
+ * \brief Rules out dead and undead blocks of a whole file with one solver
+ *
+ * The code constraints of the file, its build system condition and the
+ * model slice for all items of the file are encoded only once. Each block
+ * is then checked with assumptions on the block variables.
+ *
+ * The encoded constraints are a superset of those that a DeadBlockDefect
+ * or UndeadBlockDefect builds for a single block. If the check under the
+ * assumptions is satisfiable, the block has no such defect in this model.
+ * Otherwise, the block might be defective and has to be analyzed (and
+ * classified) in detail.
+ */
+class FileDefectFilter {
+public:
+    FileDefectFilter(CppFile *, const ConfigurationModel *);
+    ~FileDefectFilter();
+
+    bool mayBeDead(const ConditionalBlock *);    //!< false if the block can be selected
+    bool mayBeUndead(const ConditionalBlock *);  //!< false if the block can be deselected
+
+private:
+    std::unique_ptr<SatChecker> _sc;  // nullptr if the file could not be encoded
+};
 
 
 /************************************************************************/
@@ -47,7 +80,12 @@ class BlockDefect;
 /************************************************************************/
 
 namespace BlockDefectAnalyzer {
-    const BlockDefect *analyzeBlock(ConditionalBlock *, ConfigurationModel *);
+    /**
+     * Checks 'block' for a dead or undead defect. If a filter for the
+     * block's file is given, blocks it rules out are not analyzed.
+     */
+    const BlockDefect *analyzeBlock(ConditionalBlock *, ConfigurationModel *,
+                                    FileDefectFilter * = nullptr);
     std::string getBlockPrecondition(ConditionalBlock *, const ConfigurationModel *);
 } // namespace BlockDefectAnalyzer
 
@@ -91,8 +129,10 @@ public:
      * $block.globally.dead      -> dead on every checked arch
      * $block.locally.dead       -> dead on a few architectures but not all
      * \endverbatim
+     *
+     * \return true if a report was written
      */
-    void writeReportToFile(bool skip_no_kconfig) const;
+    bool writeReportToFile(bool skip_no_kconfig) const;
 
 protected:
     explicit BlockDefect(ConditionalBlock *cb) : _cb(cb) {}
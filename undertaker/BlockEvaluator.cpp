@@ -0,0 +1,233 @@
+/*
+ *   undertaker - evaluation of blocks for concrete configurations
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BlockEvaluator.h"
+#include "ConditionalBlock.h"
+#include "bool.h"
+#include "Tools.h"
+#include "exceptions/CNFBuilderError.h"
+#include "exceptions/IOException.h"
+
+#include <fstream>
+#include <limits>
+
+
+/************************************************************************/
+/* ConfigurationSet                                                     */
+/************************************************************************/
+
+void ConfigurationSet::add(const std::string &filename) {
+    std::ifstream in(filename);
+    if (!in.good())
+        throw kconfig::IOException("could not read configuration " + filename);
+
+    const size_t config = names.size();
+    names.push_back(filename);
+
+    std::string line;
+    while (std::getline(in, line)) {
+        // '# CONFIG_A is not set' and other comments leave the symbol undefined
+        const std::string::size_type eq = line.find('=');
+        if (!undertaker::starts_with(line, "CONFIG_") || eq == std::string::npos)
+            continue;
+        const std::string value = line.substr(eq + 1);
+        if (value == "n")
+            continue;
+        const std::string symbol = line.substr(0, eq) + (value == "m" ? "_MODULE" : "");
+
+        std::vector<Word> &bits = symbols[symbol];
+        if (bits.size() <= config / 64)
+            bits.resize(config / 64 + 1);
+        bits[config / 64] |= Word(1) << (config % 64);
+    }
+}
+
+ConfigurationSet::Word ConfigurationSet::getWord(const std::string &symbol, size_t word) const {
+    const auto it = symbols.find(symbol);
+    if (it == symbols.end() || word >= it->second.size())
+        return 0;
+    return it->second[word];
+}
+
+
+/************************************************************************/
+/* BlockEvaluator                                                       */
+/************************************************************************/
+
+namespace {
+    // marks symbols that are being compiled, a definition must not depend on itself
+    const size_t compiling = std::numeric_limits<size_t>::max();
+} // namespace
+
+BlockEvaluator::BlockEvaluator(CppFile &file) {
+    for (ConditionalBlock *block : file)
+        definitions[block->getName()] = {block->getConstraintClause()->right, "", false, ""};
+    for (const auto &entry : *file.getDefines())  // pair<string, CppDefine *>
+        for (const CppDefine::Rewrite &rewrite : entry.second->getRewrites())
+            definitions[rewrite.symbol]
+                = {nullptr, rewrite.block->getName(), rewrite.define, rewrite.previous};
+
+    for (ConditionalBlock *block : file) {
+        const size_t index = block->getIndex() - 1;  // B0 is the first one
+        if (_blocks.size() <= index)
+            _blocks.resize(index + 1, compiling);
+        _blocks[index] = compileSymbol(block->getName());
+    }
+    // there are no gaps in the numbers of the blocks, but be safe
+    for (size_t &reg : _blocks)
+        if (reg == compiling)
+            reg = emit(Op::UNKNOWN);
+    definitions.clear();
+}
+
+size_t BlockEvaluator::emit(Op op, size_t a, size_t b) {
+    program.push_back({op, a, b});
+    return program.size() - 1;
+}
+
+size_t BlockEvaluator::compileSymbol(const std::string &symbol) {
+    const auto it = compiled.find(symbol);
+    if (it != compiled.end()) {
+        if (it->second == compiling)
+            throw CNFBuilderError("BlockEvaluator: " + symbol + " depends on itself");
+        return it->second;
+    }
+    compiled[symbol] = compiling;
+
+    size_t reg;
+    const auto def = definitions.find(symbol);
+    if (symbol == "B00") {
+        reg = emit(Op::CONST, 1);
+    } else if (def != definitions.end() && def->second.exp) {
+        reg = compile(def->second.exp);
+    } else if (def != definitions.end()) {
+        // a disabled block keeps the previous value, which the enabled one may not change
+        const Definition &d = def->second;
+        const size_t block = compileSymbol(d.block), previous = compileSymbol(d.previous);
+        reg = d.define ? emit(Op::OR, block, previous)
+                       : emit(Op::AND, emit(Op::NOT, block), previous);
+    } else if (undertaker::starts_with(symbol, "CONFIG_")) {
+        inputs.push_back(symbol);
+        reg = emit(Op::INPUT, inputs.size() - 1);
+    } else {
+        reg = emit(Op::UNKNOWN);
+    }
+    compiled[symbol] = reg;
+    return reg;
+}
+
+size_t BlockEvaluator::compile(const kconfig::BoolExp *exp) {
+    using namespace kconfig;
+    if (const BoolExpVar *var = dynamic_cast<const BoolExpVar *>(exp))
+        return compileSymbol(var->getName());
+    if (const BoolExpConst *c = dynamic_cast<const BoolExpConst *>(exp))
+        return emit(Op::CONST, c->value);
+    if (dynamic_cast<const BoolExpNot *>(exp))
+        return emit(Op::NOT, compile(exp->right));
+    if (dynamic_cast<const BoolExpAnd *>(exp))
+        return emit(Op::AND, compile(exp->left), compile(exp->right));
+    if (dynamic_cast<const BoolExpOr *>(exp))
+        return emit(Op::OR, compile(exp->left), compile(exp->right));
+    if (dynamic_cast<const BoolExpImpl *>(exp))
+        return emit(Op::OR, emit(Op::NOT, compile(exp->left)), compile(exp->right));
+    if (dynamic_cast<const BoolExpEq *>(exp))
+        return emit(Op::EQ, compile(exp->left), compile(exp->right));
+    // arithmetic comparisons and macro calls, they're free variables for the solver as well
+    return emit(Op::UNKNOWN);
+}
+
+void BlockEvaluator::evaluate(const ConfigurationSet &configs) {
+    const size_t words = (configs.size() + 63) / 64;
+    enabled.assign(_blocks.size(), std::vector<Word>(words));
+    known.assign(_blocks.size(), std::vector<Word>(words));
+
+    // value and known bits of each register; a value bit is only set if it is known
+    std::vector<Word> value(program.size() * Words), isKnown(program.size() * Words);
+    for (size_t first = 0; first < words; first += Words) {
+        for (size_t i = 0; i < program.size(); i++) {
+            const Instruction &ins = program[i];
+            Word *v = &value[i * Words], *k = &isKnown[i * Words];
+            const Word *av = &value[ins.a * Words], *ak = &isKnown[ins.a * Words];
+            const Word *bv = &value[ins.b * Words], *bk = &isKnown[ins.b * Words];
+            switch (ins.op) {
+            case Op::CONST:
+                for (size_t w = 0; w < Words; w++) {
+                    v[w] = ins.a ? ~Word(0) : 0;
+                    k[w] = ~Word(0);
+                }
+                break;
+            case Op::INPUT:
+                for (size_t w = 0; w < Words; w++) {
+                    v[w] = configs.getWord(inputs[ins.a], first + w);
+                    k[w] = ~Word(0);
+                }
+                break;
+            case Op::UNKNOWN:
+                for (size_t w = 0; w < Words; w++)
+                    v[w] = k[w] = 0;
+                break;
+            case Op::NOT:
+                for (size_t w = 0; w < Words; w++) {
+                    v[w] = ~av[w] & ak[w];
+                    k[w] = ak[w];
+                }
+                break;
+            case Op::AND:  // known if both are known or one is known to be false
+                for (size_t w = 0; w < Words; w++) {
+                    v[w] = av[w] & bv[w];
+                    k[w] = (ak[w] & bk[w]) | (ak[w] & ~av[w]) | (bk[w] & ~bv[w]);
+                }
+                break;
+            case Op::OR:  // known if both are known or one is known to be true
+                for (size_t w = 0; w < Words; w++) {
+                    v[w] = av[w] | bv[w];
+                    k[w] = (ak[w] & bk[w]) | av[w] | bv[w];
+                }
+                break;
+            case Op::EQ:
+                for (size_t w = 0; w < Words; w++) {
+                    k[w] = ak[w] & bk[w];
+                    v[w] = ~(av[w] ^ bv[w]) & k[w];
+                }
+                break;
+            }
+        }
+        for (size_t block = 0; block < _blocks.size(); block++)
+            for (size_t w = 0; w < Words && first + w < words; w++) {
+                enabled[block][first + w] = value[_blocks[block] * Words + w];
+                known[block][first + w] = isKnown[_blocks[block] * Words + w];
+            }
+    }
+}
+
+BlockEvaluator::State BlockEvaluator::getState(size_t block, size_t config) const {
+    const Word bit = Word(1) << (config % 64);
+    if (!(known[block][config / 64] & bit))
+        return State::UNKNOWN;
+    return (enabled[block][config / 64] & bit) ? State::ENABLED : State::DISABLED;
+}
+
+std::string BlockEvaluator::getBitmap(size_t config) const {
+    std::string bitmap;
+    for (size_t block = 0; block < _blocks.size(); block++)
+        switch (getState(block, config)) {
+        case State::ENABLED:  bitmap += '1'; break;
+        case State::DISABLED: bitmap += '0'; break;
+        case State::UNKNOWN:  bitmap += '?'; break;
+        }
+    return bitmap;
+}
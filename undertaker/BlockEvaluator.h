@@ -0,0 +1,140 @@
+/*
+ *   undertaker - evaluation of blocks for concrete configurations
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -*- mode: c++ -*-
+#ifndef block_evaluator_h__
+#define block_evaluator_h__
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class CppFile;
+namespace kconfig {
+    class BoolExp;
+} // namespace kconfig
+
+
+/************************************************************************/
+/* ConfigurationSet                                                     */
+/************************************************************************/
+
+/**
+ * \brief Concrete configurations (.config files), stored per symbol
+ *
+ * For each symbol, bit i of its bit vector is set if the symbol is
+ * defined for the C preprocessor in configuration i. Like in the
+ * kernel's autoconf.h, 'CONFIG_A=y' defines CONFIG_A, 'CONFIG_A=m'
+ * defines CONFIG_A_MODULE, and other values define CONFIG_A as well.
+ */
+class ConfigurationSet {
+public:
+    typedef uint64_t Word;
+
+    /**
+     * Adds the configuration in 'filename'.
+     * @throws kconfig::IOException if 'filename' can't be read
+     */
+    void add(const std::string &filename);
+
+    size_t size() const { return names.size(); }
+    const std::string &getName(size_t config) const { return names[config]; }
+
+    //! word 'word' of the bit vector of 'symbol', configurations 64 * word to 64 * word + 63
+    Word getWord(const std::string &symbol, size_t word) const;
+
+private:
+    std::vector<std::string> names;
+    std::unordered_map<std::string, std::vector<Word>> symbols;
+};
+
+
+/************************************************************************/
+/* BlockEvaluator                                                       */
+/************************************************************************/
+
+/**
+ * \brief Enabled blocks of a file for many concrete configurations
+ *
+ * The conditions of all blocks and the rewritings of #defines (see
+ * CppDefine) are compiled once into a straight-line program of
+ * boolean operations. The program is then run on machine words, so
+ * that each operation decides 64 configurations per word; 'Words'
+ * words are processed together in loops the compiler can vectorize.
+ * No solver is involved.
+ *
+ * The blocks are evaluated in the three valued logic of Kleene: CONFIG_
+ * symbols are known from the configurations (unset symbols are false),
+ * but other symbols (e.g., __KERNEL__), arithmetic comparisons and
+ * macro calls are unknown, and so is every block that depends on them.
+ * The file itself (B00) is assumed to be built.
+ */
+class BlockEvaluator {
+public:
+    typedef ConfigurationSet::Word Word;
+    static const size_t Words = 4;
+
+    enum class State { DISABLED, ENABLED, UNKNOWN };
+
+    /**
+     * Compiles the blocks of 'file'.
+     * @throws CNFBuilderError if a condition can't be parsed
+     */
+    explicit BlockEvaluator(CppFile &file);
+
+    //! evaluates all blocks for all 'configs'
+    void evaluate(const ConfigurationSet &configs);
+
+    //! the number of blocks, i.e., the largest ConditionalBlock::getIndex()
+    size_t blocks() const { return _blocks.size(); }
+
+    //! state of block "B<block>" in configuration 'config', after evaluate()
+    State getState(size_t block, size_t config) const;
+
+    //! the states of all blocks, '1' enabled, '0' disabled, '?' unknown, one char per block
+    std::string getBitmap(size_t config) const;
+
+private:
+    enum class Op { CONST, INPUT, UNKNOWN, NOT, AND, OR, EQ };
+    struct Instruction {
+        Op op;
+        size_t a, b;  // registers, the input or the value of a constant
+    };
+    //! what a block or a rewritten symbol is defined as
+    struct Definition {
+        const kconfig::BoolExp *exp;  // the condition of a block, or for a rewritten symbol:
+        std::string block;            // block ? define : previous
+        bool define;
+        std::string previous;
+    };
+
+    size_t emit(Op op, size_t a = 0, size_t b = 0);
+    size_t compile(const kconfig::BoolExp *exp);
+    size_t compileSymbol(const std::string &symbol);
+
+    std::vector<Instruction> program;  // instruction i writes register i
+    std::vector<std::string> inputs;
+    std::map<std::string, Definition> definitions;  // only while compiling
+    std::map<std::string, size_t> compiled;  // register of each compiled symbol
+    std::vector<size_t> _blocks;             // register of block "B<i>"
+
+    // after evaluate(), per block: enabled and known bit of each configuration
+    std::vector<std::vector<Word>> enabled, known;
+};
+#endif
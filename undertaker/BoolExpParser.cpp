@@ -0,0 +1,341 @@
+/*
+ *   boolean framework for undertaker and satyr
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "bool.h"
+#include "exceptions/BoolExpParserException.h"
+
+#include <list>
+#include <memory>
+#include <set>
+#include <string>
+
+
+using namespace kconfig;
+
+namespace {
+    /**
+     * \brief Recursive descent parser for the formulas of BoolExp::parseString()
+     *
+     * Grammar, all binary operators are left-associative:
+     *
+     *   Expr    := Expr '<->' Impl | Impl
+     *   Impl    := Impl '->' Or | Or
+     *   Or      := Or '||' And | And
+     *   And     := And '&&' CExpr | CExpr
+     *   CExpr   := CExpr COp Literal | Literal
+     *   Literal := '!' Literal | Atom
+     *   Atom    := Const | Name '(' Params ')' | Name | '(' Expr ')'
+     *   Params  := <empty> | Expr | Params ',' Expr
+     *
+     * COp is one of ? : & | >= <= == != >> << <<< > < * / + - %. Integer
+     * and character literals are constants, 0 is false and every other
+     * value true. Names consist of [A-Za-z0-9_.] and don't start with a
+     * digit.
+     *
+     * Tokens only point into the input, memory is solely allocated for the
+     * nodes (and their names) of the resulting tree. If a symbol set is
+     * given, no tree is built at all: the input is only checked and the
+     * names of the variables are collected. Input nested deeper than
+     * max_depth is rejected like a syntax error.
+     */
+    class Parser {
+        enum class Token { END, NAME, CONST_TRUE, CONST_FALSE, OR, AND, EQ, IMPL, COP, NOT,
+                           LPAREN, RPAREN, COMMA, INVALID };
+
+        const char *pos, *const end;
+        Token token;
+        const char *text;  // the characters of the current token
+        size_t length;
+        std::set<std::string> *symbols;
+        //! nesting of '!', '(' and calls, limited so that deep input can't overflow the stack
+        unsigned int depth = 0;
+        static const unsigned int max_depth = 1000;
+
+        typedef std::unique_ptr<BoolExp> Node;
+
+        static bool isNameChar(char c) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+                   || c == '_' || c == '.';
+        }
+        static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+        static bool isHexDigit(char c) {
+            return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+        }
+        bool lookingAt(const char *s) const {
+            const char *p = pos;
+            for (; *s; s++, p++)
+                if (p == end || *p != *s)
+                    return false;
+            return true;
+        }
+        Token take(Token t, size_t n) {
+            pos += n;
+            return t;
+        }
+
+        void next() {
+            while (pos != end && (*pos == ' ' || *pos == '\t' || *pos == '\r' || *pos == '\n'))
+                pos++;
+            text = pos;
+            token = lex();
+            length = pos - text;
+        }
+
+        Token lex() {
+            if (pos == end || *pos == '\0')
+                return Token::END;
+            const char c = *pos;
+
+            if (isDigit(c)) {
+                Token t;
+                if (lookingAt("0x") && pos + 2 != end && isHexDigit(pos[2])) {
+                    for (pos += 2; pos != end && isHexDigit(*pos);)
+                        pos++;
+                    t = Token::CONST_TRUE;
+                } else {
+                    while (pos != end && isDigit(*pos))
+                        pos++;
+                    t = (pos - text == 1 && c == '0') ? Token::CONST_FALSE : Token::CONST_TRUE;
+                }
+                // integer suffix: u?[lL]{0,2}
+                if (pos != end && *pos == 'u')
+                    pos++;
+                for (int i = 0; i < 2 && pos != end && (*pos == 'l' || *pos == 'L'); i++)
+                    pos++;
+                return t;
+            }
+            if (isNameChar(c)) {
+                while (pos != end && isNameChar(*pos))
+                    pos++;
+                return Token::NAME;
+            }
+            switch (c) {
+            case '\'':
+                // a character literal
+                if (end - pos >= 3 && pos[1] != '\n' && pos[2] == '\'')
+                    return take(Token::CONST_TRUE, 3);
+                break;
+            case '|':
+                return lookingAt("||") ? take(Token::OR, 2) : take(Token::COP, 1);
+            case '&':
+                return lookingAt("&&") ? take(Token::AND, 2) : take(Token::COP, 1);
+            case '<':
+                if (lookingAt("<->"))
+                    return take(Token::EQ, 3);
+                if (lookingAt("<<<"))
+                    return take(Token::COP, 3);
+                return take(Token::COP, (lookingAt("<<") || lookingAt("<=")) ? 2 : 1);
+            case '>':
+                return take(Token::COP, (lookingAt(">>") || lookingAt(">=")) ? 2 : 1);
+            case '-':
+                return lookingAt("->") ? take(Token::IMPL, 2) : take(Token::COP, 1);
+            case '=':
+                if (lookingAt("=="))
+                    return take(Token::COP, 2);
+                break;
+            case '!':
+                return lookingAt("!=") ? take(Token::COP, 2) : take(Token::NOT, 1);
+            case '?': case ':': case '*': case '/': case '+': case '%':
+                return take(Token::COP, 1);
+            case '(':
+                return take(Token::LPAREN, 1);
+            case ')':
+                return take(Token::RPAREN, 1);
+            case ',':
+                return take(Token::COMMA, 1);
+            }
+            return take(Token::INVALID, 1);
+        }
+
+        [[noreturn]] void error() const {
+            if (token == Token::END)
+                throw BoolExpParserException("syntax error, unexpected end of input");
+            throw BoolExpParserException("syntax error, unexpected '" + std::string(text, length)
+                                         + "'");
+        }
+
+        void expect(Token t) {
+            if (token != t)
+                error();
+            next();
+        }
+
+        //! a new 'T' node of 'args', or nothing if only symbols are collected
+        template <typename T, typename... Args> Node make(Args &&... args) {
+            if (symbols)
+                return Node();
+            return Node(new T(std::forward<Args>(args)...));
+        }
+
+        Node parseEq() {
+            Node left = parseImpl();
+            while (token == Token::EQ) {
+                next();
+                Node right = parseImpl();
+                left = make<BoolExpEq>(left.release(), right.release());
+            }
+            return left;
+        }
+
+        Node parseImpl() {
+            Node left = parseOr();
+            while (token == Token::IMPL) {
+                next();
+                Node right = parseOr();
+                left = make<BoolExpImpl>(left.release(), right.release());
+            }
+            return left;
+        }
+
+        Node parseOr() {
+            Node left = parseAnd();
+            while (token == Token::OR) {
+                next();
+                Node right = parseAnd();
+                left = make<BoolExpOr>(left.release(), right.release());
+            }
+            return left;
+        }
+
+        Node parseAnd() {
+            Node left = parseCExpr();
+            while (token == Token::AND) {
+                next();
+                Node right = parseCExpr();
+                left = make<BoolExpAnd>(left.release(), right.release());
+            }
+            return left;
+        }
+
+        Node parseCExpr() {
+            Node left = parseLiteral();
+            while (token == Token::COP) {
+                const std::string op = symbols ? std::string() : std::string(text, length);
+                next();
+                Node right = parseLiteral();
+                left = make<BoolExpAny>(op, left.release(), right.release());
+            }
+            return left;
+        }
+
+        Node parseLiteral() {
+            if (++depth > max_depth)
+                throw BoolExpParserException("expression nested too deeply");
+            Node result;
+            if (token != Token::NOT) {
+                result = parseAtom();
+            } else {
+                next();
+                Node operand = parseLiteral();
+                result = make<BoolExpNot>(operand.release());
+            }
+            depth--;
+            return result;
+        }
+
+        Node parseAtom() {
+            switch (token) {
+            case Token::CONST_TRUE:
+            case Token::CONST_FALSE: {
+                const bool value = token == Token::CONST_TRUE;
+                next();
+                return symbols ? Node() : Node(B_CONST(value));
+            }
+            case Token::NAME: {
+                const std::string name(text, length);
+                next();
+                if (token != Token::LPAREN) {
+                    if (symbols) {
+                        symbols->insert(name);
+                        return Node();
+                    }
+                    return Node(new BoolExpVar(name, false));
+                }
+                next();
+                std::unique_ptr<std::list<BoolExp *>, ParamsDeleter> params(
+                    symbols ? nullptr : new std::list<BoolExp *>());
+                // the first parameter may be omitted: "f(, a)"
+                if (token != Token::COMMA && token != Token::RPAREN)
+                    addParam(params.get(), parseEq());
+                while (token == Token::COMMA) {
+                    next();
+                    addParam(params.get(), parseEq());
+                }
+                expect(Token::RPAREN);
+                if (symbols)
+                    return Node();
+                return Node(new BoolExpCall(name, params.release()));
+            }
+            case Token::LPAREN: {
+                next();
+                Node e = parseEq();
+                expect(Token::RPAREN);
+                return e;
+            }
+            default:
+                error();
+            }
+        }
+
+        static void addParam(std::list<BoolExp *> *params, Node param) {
+            if (params)
+                params->push_back(param.release());
+        }
+
+        //! frees the parameters of a call that couldn't be parsed completely
+        struct ParamsDeleter {
+            void operator()(std::list<BoolExp *> *params) const {
+                for (BoolExp *e : *params)
+                    delete e;
+                delete params;
+            }
+        };
+
+    public:
+        Parser(const char *begin, const char *end, std::set<std::string> *symbols = nullptr)
+            : pos(begin), end(end), symbols(symbols) {
+            next();
+        }
+
+        //! \throws BoolExpParserException on syntax errors and too deeply nested input
+        BoolExp *parse() {
+            Node e = parseEq();
+            if (token != Token::END)
+                error();
+            return e.release();
+        }
+    };
+} // namespace
+
+kconfig::BoolExp *kconfig::BoolExp::parseString(const std::string &s) {
+    try {
+        return Parser(s.data(), s.data() + s.size()).parse();
+    } catch (BoolExpParserException &) {
+        return nullptr;
+    }
+}
+
+std::set<std::string> kconfig::BoolExp::symbolsOfString(const std::string &s) {
+    std::set<std::string> symbols;
+    try {
+        Parser(s.data(), s.data() + s.size(), &symbols).parse();
+    } catch (BoolExpParserException &) {
+        symbols.clear();
+    }
+    return symbols;
+}
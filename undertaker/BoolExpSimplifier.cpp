@@ -39,7 +39,7 @@ void kconfig::BoolExpSimplifier::visit(BoolExpNot *) {
         this->result = notExpr->right;
         return;
     }
-    this->result = new BoolExpNot(node);
+    this->result = B_NOT(node);
 }
 
 void kconfig::BoolExpSimplifier::visit(BoolExpAnd *) {
@@ -171,13 +171,13 @@ void kconfig::BoolExpSimplifier::visit(BoolExpImpl *) {
             return;
         }
     }
-    this->result = new BoolExpImpl(sl, sr);
+    this->result = B_IMPL(sl, sr);
 }
 
 void kconfig::BoolExpSimplifier::visit(BoolExpEq *) {
     BoolExp *sr = static_cast<BoolExp *>(this->right);
     BoolExp *sl = static_cast<BoolExp *>(this->left);
-    this->result = new BoolExpEq(sl, sr);
+    this->result = B_EQ(sl, sr);
 }
 
 void kconfig::BoolExpSimplifier::visit(BoolExpAny *) {
@@ -189,7 +189,8 @@ void kconfig::BoolExpSimplifier::visit(BoolExpCall *) {
 }
 
 void kconfig::BoolExpSimplifier::visit(BoolExpConst *e) {
-    this->result = new BoolExpConst(*e);
+    // shared nodes are never modified, there is no need to copy them
+    this->result = BoolExpFactory::current() ? e : new BoolExpConst(*e);
 }
 
 void kconfig::BoolExpSimplifier::visit(BoolExpVar *e) {
@@ -197,5 +198,5 @@ void kconfig::BoolExpSimplifier::visit(BoolExpVar *e) {
         this->result = B_CONST(false);
         return;
     }
-    this->result = new BoolExpVar(*e);
+    this->result = BoolExpFactory::current() ? e : new BoolExpVar(*e);
 }
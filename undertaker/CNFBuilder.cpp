@@ -20,16 +20,21 @@
  */
 
 #include "CNFBuilder.h"
+#include "ClauseList.h"
 #include "PicosatCNF.h"
 #include "KconfigWhitelist.h"
 #include "exceptions/CNFBuilderError.h"
 
+#include <algorithm>
+
 using namespace kconfig;
 
 
 CNFBuilder::CNFBuilder(PicosatCNF *cnf, std::string sat, bool useKconfigWhitelist,
-                       ConstantPolicy constPolicy)
-        : cnf(cnf), constPolicy(constPolicy), useKconfigWhitelist(useKconfigWhitelist) {
+                       ConstantPolicy constPolicy, Encoding encoding)
+        : cnf(cnf), constPolicy(constPolicy), useKconfigWhitelist(useKconfigWhitelist),
+          encoding(encoding), initialVars(cnf->getVarCount()),
+          initialClauses(cnf->getClauseCount()) {
     if (sat != "") {
         BoolExp *exp = BoolExp::parseString(sat);
         if (!exp) {
@@ -42,6 +47,8 @@ CNFBuilder::CNFBuilder(PicosatCNF *cnf, std::string sat, bool useKconfigWhitelis
 
 void CNFBuilder::pushClause(BoolExp *e) {
     visited.clear();
+    if (!keepVars)
+        vars.clear();
     BoolExpConst *constant = dynamic_cast<BoolExpConst*>(e);
 
     if (constant) {
@@ -59,11 +66,35 @@ void CNFBuilder::pushClause(BoolExp *e) {
         const std::string always_on("ALWAYS_ON");
         cnf->addMetaValue(always_on, variable->str());
     }
+    if (encoding == Encoding::COMPACT) {
+        encoded.clear();
+        assertFormula(e);
+        return;
+    }
     e->accept(this);
-    cnf->pushVar(e->CNFVar);
+    cnf->pushVar(vars[e]);
     cnf->pushClause();
 }
 
+void CNFBuilder::pushClauses(const ClauseList &clauses) {
+    if (clauses.empty())
+        return;
+    // "a && b && c" is parsed left-associative: ((a && b) && c)
+    BoolExp *conjunction = const_cast<BoolExp *>(clauses.front());
+    std::vector<BoolExp *> connectives;
+    for (auto it = clauses.begin() + 1; it != clauses.end(); ++it) {
+        conjunction = new BoolExpAnd(conjunction, const_cast<BoolExp *>(*it));
+        connectives.push_back(conjunction);
+    }
+    pushClause(conjunction);
+    // the formulas belong to the caller, only free the connectives
+    for (BoolExp *e : connectives) {
+        vars.erase(e);
+        e->gcMarked = true;
+        delete e;
+    }
+}
+
 int CNFBuilder::addVar(std::string symname) {
     int cv = cnf->getCNFVar(symname);
 
@@ -79,20 +110,159 @@ int CNFBuilder::addVar(std::string symname) {
     return cv;
 }
 
+CNFBuilder::Stats CNFBuilder::getStats() const {
+    return {cnf->getVarCount() - initialVars, cnf->getClauseCount() - initialClauses};
+}
+
+/************************************************************************/
+/* Compact encoding                                                     */
+/************************************************************************/
+
+void CNFBuilder::assertFormula(BoolExp *e) {
+    if (dynamic_cast<BoolExpAnd *>(e)) {
+        // each conjunct becomes clauses of its own, no variable is needed
+        assertFormula(e->left);
+        assertFormula(e->right);
+    } else if (dynamic_cast<BoolExpOr *>(e) || dynamic_cast<BoolExpImpl *>(e)) {
+        std::vector<int> lits;
+        collect(e, false, 1, lits);
+        emit(lits);
+    } else {
+        emit({encode(e, 1)});
+    }
+}
+
+/**
+ * Returns a literal for 'e'. A positive polarity only requires the
+ * literal to imply 'e', a negative one only requires 'e' to imply the
+ * literal and 0 requires both.
+ */
+int CNFBuilder::encode(BoolExp *e, int polarity) {
+    const auto key = std::make_pair(e, polarity);
+    const auto it = encoded.find(key);
+    if (it != encoded.end())
+        return it->second;
+
+    int lit;
+    if (dynamic_cast<BoolExpNot *>(e)) {
+        lit = -encode(e->right, -polarity);
+    } else if (dynamic_cast<BoolExpAnd *>(e)) {
+        std::vector<int> lits;
+        collect(e, true, polarity, lits);
+        lit = andGate(lits, polarity);
+    } else if (dynamic_cast<BoolExpOr *>(e) || dynamic_cast<BoolExpImpl *>(e)) {
+        // a || b == !(!a && !b)
+        std::vector<int> lits;
+        collect(e, false, polarity, lits);
+        for (int &l : lits)
+            l = -l;
+        lit = -andGate(lits, -polarity);
+    } else if (dynamic_cast<BoolExpEq *>(e)) {
+        lit = eqGate(encode(e->left, 0), encode(e->right, 0), polarity);
+    } else if (BoolExpVar *var = dynamic_cast<BoolExpVar *>(e)) {
+        visit(var);
+        lit = vars[e];
+    } else if (BoolExpConst *constant = dynamic_cast<BoolExpConst *>(e)) {
+        visit(constant);
+        lit = vars[e];
+    } else {
+        // arithmetic operators and function calls are free variables
+        int &var = vars[e];
+        if (!var)
+            var = this->cnf->newVar();
+        lit = var;
+    }
+    encoded.emplace(key, lit);
+    return lit;
+}
+
+//! collects the operands of a chain of '&&' (or '||' and '->') in 'lits'
+void CNFBuilder::collect(BoolExp *e, bool conjunction, int polarity, std::vector<int> &lits) {
+    if (conjunction ? dynamic_cast<BoolExpAnd *>(e) != nullptr
+                    : dynamic_cast<BoolExpOr *>(e) != nullptr) {
+        collect(e->left, conjunction, polarity, lits);
+        collect(e->right, conjunction, polarity, lits);
+    } else if (!conjunction && dynamic_cast<BoolExpImpl *>(e)) {
+        // a -> b == !a || b
+        lits.push_back(-encode(e->left, -polarity));
+        collect(e->right, conjunction, polarity, lits);
+    } else {
+        lits.push_back(encode(e, polarity));
+    }
+}
+
+int CNFBuilder::andGate(std::vector<int> lits, int polarity) {
+    std::sort(lits.begin(), lits.end());
+    lits.erase(std::unique(lits.begin(), lits.end()), lits.end());
+    if (lits.size() == 1)
+        return lits[0];
+
+    Gate &gate = andGates[lits];
+    if (!gate.var)
+        gate.var = this->cnf->newVar();
+    const int h = gate.var;
+    if (polarity >= 0 && !gate.pos) {
+        // H -> (A && B && ...)
+        for (int l : lits)
+            emit({-h, l});
+        gate.pos = true;
+    }
+    if (polarity <= 0 && !gate.neg) {
+        // (A && B && ...) -> H
+        std::vector<int> clause{h};
+        for (int l : lits)
+            clause.push_back(-l);
+        emit(clause);
+        gate.neg = true;
+    }
+    return h;
+}
+
+int CNFBuilder::eqGate(int a, int b, int polarity) {
+    Gate &gate = eqGates[std::minmax(a, b)];
+    if (!gate.var)
+        gate.var = this->cnf->newVar();
+    const int h = gate.var;
+    if (polarity >= 0 && !gate.pos) {
+        // H -> (A <-> B)
+        emit({-h, -a, b});
+        emit({-h, a, -b});
+        gate.pos = true;
+    }
+    if (polarity <= 0 && !gate.neg) {
+        // (A <-> B) -> H
+        emit({h, a, b});
+        emit({h, -a, -b});
+        gate.neg = true;
+    }
+    return h;
+}
+
+void CNFBuilder::emit(const std::vector<int> &lits) {
+    for (int l : lits)
+        cnf->pushVar(l);
+    cnf->pushClause();
+}
+
+/************************************************************************/
+/* Tseitin encoding                                                     */
+/************************************************************************/
+
 void CNFBuilder::visit(BoolExp *) {
     throw "CNF ERROR";
 }
 
 void CNFBuilder::visit(BoolExpAnd *e) {
-    if (e->CNFVar)
+    int &var = vars[e];
+    if (var)
         return;
 
-    e->CNFVar = this->cnf->newVar();
+    var = this->cnf->newVar();
 
     // add clauses
-    int h = e->CNFVar;
-    int a = e->left->CNFVar;
-    int b = e->right->CNFVar;
+    int h = var;
+    int a = vars[e->left];
+    int b = vars[e->right];
     // H <-> (A && B)
     // (!H || A) && ( !H || B) && ( H || !A || !B)
     cnf->pushVar(-h);
@@ -110,15 +280,16 @@ void CNFBuilder::visit(BoolExpAnd *e) {
 }
 
 void CNFBuilder::visit(BoolExpOr *e) {
-    if (e->CNFVar)
+    int &var = vars[e];
+    if (var)
         return;
 
-    e->CNFVar = this->cnf->newVar();
+    var = this->cnf->newVar();
 
     // add clauses
-    int h = e->CNFVar;
-    int a = e->left->CNFVar;
-    int b = e->right->CNFVar;
+    int h = var;
+    int a = vars[e->left];
+    int b = vars[e->right];
 
     // H <-> (A || B)
     // (H || !A) && ( H || !B) && ( !H || A || B)
@@ -137,15 +308,16 @@ void CNFBuilder::visit(BoolExpOr *e) {
 }
 
 void CNFBuilder::visit(BoolExpImpl *e) {
-    if (e->CNFVar)
+    int &var = vars[e];
+    if (var)
         return;
 
-    e->CNFVar = this->cnf->newVar();
+    var = this->cnf->newVar();
 
     // add clauses
-    int h = e->CNFVar;
-    int a = e->left->CNFVar;
-    int b = e->right->CNFVar;
+    int h = var;
+    int a = vars[e->left];
+    int b = vars[e->right];
     // H <-> (A -> B)
     // (H ||  A) && (H || !B ) && (!H || !A || B)
     cnf->pushVar(h);
@@ -163,15 +335,16 @@ void CNFBuilder::visit(BoolExpImpl *e) {
 }
 
 void CNFBuilder::visit(BoolExpEq *e) {
-    if (e->CNFVar)
+    int &var = vars[e];
+    if (var)
         return;
 
-    e->CNFVar = this->cnf->newVar();
+    var = this->cnf->newVar();
 
     // add clauses
-    int h = e->CNFVar;
-    int a = e->left->CNFVar;
-    int b = e->right->CNFVar;
+    int h = var;
+    int a = vars[e->left];
+    int b = vars[e->right];
     // H <-> (A <-> B)
     // (H || !A || !B) && (H || A || B) && (!H || A || !B) && (!H || !A || B)
     cnf->pushVar(h);
@@ -197,28 +370,30 @@ void CNFBuilder::visit(BoolExpEq *e) {
 
 void CNFBuilder::visit(BoolExpAny *e) {
     // add free variable for arith. Operators (ie, handle them later..)
-    e->CNFVar = this->cnf->newVar();
+    vars[e] = this->cnf->newVar();
 }
 
 void CNFBuilder::visit(BoolExpCall *e) {
     // add free variable for function calls (i.e., handle them later..)
-    e->CNFVar = this->cnf->newVar();
+    vars[e] = this->cnf->newVar();
 }
 
 void CNFBuilder::visit(BoolExpNot *e) {
-    if (e->CNFVar)
+    int &var = vars[e];
+    if (var)
         return;
 
-    e->CNFVar = -(e->right->CNFVar);
+    var = -vars[e->right];
 }
 
 void CNFBuilder::visit(BoolExpConst *e) {
-    if (e->CNFVar)
+    int &var = vars[e];
+    if (var)
         return;
 
     if (constPolicy == ConstantPolicy::FREE){
         //handle consts as free var
-        e->CNFVar = this->cnf->newVar();
+        var = this->cnf->newVar();
         return;
     }
     if (!this->boolvar) {
@@ -226,17 +401,18 @@ void CNFBuilder::visit(BoolExpConst *e) {
         cnf->pushVar(boolvar);
         cnf->pushClause();
     }
-    e->CNFVar = e->value ? boolvar : -boolvar;
+    var = e->value ? boolvar : -boolvar;
 }
 
 void CNFBuilder::visit(BoolExpVar *e) {
-    std::string symname = e->str();
-    if (e->CNFVar)
+    int &var = vars[e];
+    if (var)
         return;
 
+    std::string symname = e->str();
     if (useKconfigWhitelist && KconfigWhitelist::getIgnorelist().isWhitelisted(symname))
         // use free variables for symbols in wl
-        e->CNFVar = this->cnf->newVar();
+        var = this->cnf->newVar();
     else
-        e->CNFVar = this->addVar(symname);
+        var = this->addVar(symname);
 }
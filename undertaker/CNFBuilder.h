@@ -26,25 +26,69 @@
 #include "bool.h"
 #include "BoolVisitor.h"
 
+#include <map>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 
 namespace kconfig {
     class PicosatCNF;
+    class ClauseList;
 
     class CNFBuilder : public BoolVisitor {
     public:
         enum class ConstantPolicy {BOUND, FREE};
+        /**
+         * TSEITIN: every operator node gets a variable that is equivalent
+         *          to the subformula, the variable numbering of the
+         *          written models depends on this encoding.
+         * COMPACT: polarity aware (Plaisted-Greenbaum) encoding. Only the
+         *          implications needed for the polarity in which a
+         *          subformula occurs are emitted, chains of '&&' and '||'
+         *          share a single variable and structurally identical
+         *          subformulas reuse the variable of their first
+         *          occurrence. The CNF is equisatisfiable, the values
+         *          of all named variables in a solution remain valid.
+         */
+        enum class Encoding {TSEITIN, COMPACT};
+        //! variables and clauses added to the CNF by a CNFBuilder
+        struct Stats {
+            int vars;
+            int clauses;
+        };
         PicosatCNF *cnf = nullptr;
     private:
+        //! a helper variable and the directions of its definition emitted so far
+        struct Gate {
+            int var = 0;
+            bool pos = false, neg = false;
+        };
         int boolvar = 0;
         ConstantPolicy constPolicy;
         bool useKconfigWhitelist = false;
+        Encoding encoding;
+        int initialVars, initialClauses;
+        bool keepVars = false;
+        // the literal of each visited node, the nodes themselves are never modified
+        std::unordered_map<const BoolExp *, int> vars;
+        std::map<std::vector<int>, Gate> andGates;  // sorted operand literals
+        std::map<std::pair<int, int>, Gate> eqGates;
+        std::map<std::pair<BoolExp *, int>, int> encoded;  // (node, polarity), per clause
+
+        void assertFormula(BoolExp *e);
+        int encode(BoolExp *e, int polarity);
+        void collect(BoolExp *e, bool conjunction, int polarity, std::vector<int> &lits);
+        int andGate(std::vector<int> lits, int polarity);
+        int eqGate(int a, int b, int polarity);
+        void emit(const std::vector<int> &lits);
 
     public:
         explicit CNFBuilder(PicosatCNF *cnf, std::string sat = "",
                             bool useKconfigWhitelist = false,
-                            ConstantPolicy constPolicy = ConstantPolicy::BOUND);
+                            ConstantPolicy constPolicy = ConstantPolicy::BOUND,
+                            Encoding encoding = Encoding::TSEITIN);
 
         //! Add clauses from the parsed boolean expression e
         /**
@@ -52,10 +96,26 @@ namespace kconfig {
          *
          * Note that this triggers the traversal on the tree e,
          * which (as every visitor), and therefrore potentially
-         * modifies the CNF variable assignment.
+         * modifies the CNF variable assignment. The tree itself
+         * is left untouched.
          */
         void pushClause(BoolExp *e);
 
+        /**
+         * Adds the conjunction of all formulas in 'clauses', exactly as
+         * if their string representations joined by " && " were parsed
+         * and pushed. The formulas are only read.
+         */
+        void pushClauses(const ClauseList &clauses);
+
+        /**
+         * By default the variables of the nodes are forgotten after each
+         * pushClause(), as the caller may free and reallocate the nodes.
+         * If all pushed nodes outlive the builder, keeping them lets nodes
+         * shared between several clauses be encoded only once.
+         */
+        void keepVariables() { keepVars = true; }
+
         //! Add new variable to the CNF and returns associated var number
         /**
          * @param[in] the name of the variable
@@ -67,6 +127,9 @@ namespace kconfig {
          */
         int addVar(std::string s);
 
+        //! number of variables and clauses this builder has added so far
+        Stats getStats() const;
+
     protected:
         void visit(BoolExp *e)      final override;
         void visit(BoolExpAnd *e)   final override;
@@ -0,0 +1,498 @@
+/*
+ *   boolean framework for undertaker and satyr
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CNFPreprocessor.h"
+#include "PicosatCNF.h"
+#include "Logging.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace kconfig;
+
+
+namespace {
+    // (self-)subsumption skips literals that occur more often than this
+    const size_t maxOccurrences = 1000;
+    // variable elimination skips variables that occur more often than this
+    const size_t maxEliminationOccurrences = 32;
+    // and gives up on variables whose resolvents get longer than this
+    const size_t maxResolventSize = 16;
+
+    // orders by variable, the negative literal first
+    bool litLess(int a, int b) {
+        return abs(a) < abs(b) || (abs(a) == abs(b) && a < b);
+    }
+
+    // index of a literal in lists over all literals
+    size_t idx(int lit) { return 2 * abs(lit) + (lit < 0); }
+
+    struct Clause {
+        std::vector<int> lits;  // ordered by litLess, each variable at most once
+        uint64_t signature;     // one bit per variable (modulo 64)
+        bool deleted;
+
+        bool contains(int lit) const {
+            const auto it = std::lower_bound(lits.begin(), lits.end(), lit, litLess);
+            return it != lits.end() && *it == lit;
+        }
+        void sign() {
+            signature = 0;
+            for (int lit : lits)
+                signature |= uint64_t(1) << (abs(lit) % 64);
+        }
+    };
+
+    class Formula {
+        std::vector<Clause> clauses;
+        //! clauses of each literal, may contain clauses that lost the literal
+        std::vector<std::vector<int>> occurrences;
+        std::vector<signed char> values;  // variable -> 1, -1 or 0 if unassigned
+        std::vector<int> queue;           // assigned literals not propagated yet
+        std::vector<bool> frozen;
+
+        int value(int lit) const { return lit > 0 ? values[lit] : -values[-lit]; }
+        void assign(int lit);
+        void remove(int c) { clauses[c].deleted = true; }
+        void strengthen(int c, int lit);
+        const std::vector<int> &occurring(int lit);
+
+        bool propagate();
+        bool substituteEquivalences();
+        bool subsume();
+        bool eliminate();
+
+    public:
+        CNFPreprocessor::Stats stats;
+        bool unsat = false;
+
+        explicit Formula(int vars)
+            : occurrences(2 * vars + 2), values(vars + 1, 0), frozen(vars + 1, false) {}
+
+        void freeze(int var) { frozen[var] = true; }
+        void add(std::vector<int> lits);
+        void simplify();
+        //! calls 'f' for each remaining clause, fixed named variables are unit clauses
+        template <typename F> void forEachClause(F f) const;
+    };
+
+    void Formula::assign(int lit) {
+        const int var = abs(lit);
+        const signed char val = lit > 0 ? 1 : -1;
+        if (values[var]) {
+            if (values[var] != val)
+                unsat = true;
+            return;
+        }
+        values[var] = val;
+        queue.push_back(lit);
+        if (!frozen[var])
+            stats.units++;
+    }
+
+    void Formula::add(std::vector<int> lits) {
+        std::sort(lits.begin(), lits.end(), litLess);
+        lits.erase(std::unique(lits.begin(), lits.end()), lits.end());
+        size_t n = 0;
+        for (size_t i = 0; i < lits.size(); i++) {
+            const int lit = lits[i];
+            if (i + 1 < lits.size() && lits[i + 1] == -lit)
+                return;  // tautology
+            if (value(lit) > 0)
+                return;  // satisfied
+            if (value(lit) == 0)
+                lits[n++] = lit;
+        }
+        lits.resize(n);
+        if (lits.empty()) {
+            unsat = true;
+        } else if (lits.size() == 1) {
+            assign(lits[0]);
+        } else {
+            const int c = clauses.size();
+            for (int lit : lits)
+                occurrences[idx(lit)].push_back(c);
+            clauses.push_back({std::move(lits), 0, false});
+            clauses.back().sign();
+        }
+    }
+
+    void Formula::strengthen(int c, int lit) {
+        Clause &clause = clauses[c];
+        clause.lits.erase(std::lower_bound(clause.lits.begin(), clause.lits.end(), lit, litLess));
+        clause.sign();
+        if (clause.lits.size() == 1) {
+            assign(clause.lits[0]);
+            remove(c);
+        }
+    }
+
+    const std::vector<int> &Formula::occurring(int lit) {
+        std::vector<int> &occ = occurrences[idx(lit)];
+        occ.erase(std::remove_if(occ.begin(), occ.end(),
+                                 [this, lit](int c) {
+                                     return clauses[c].deleted || !clauses[c].contains(lit);
+                                 }),
+                  occ.end());
+        return occ;
+    }
+
+    bool Formula::propagate() {
+        const bool changed = !queue.empty();
+        while (!queue.empty() && !unsat) {
+            const int lit = queue.back();
+            queue.pop_back();
+            for (int c : occurring(lit))
+                remove(c);
+            for (int c : occurring(-lit))
+                strengthen(c, -lit);
+            // the variable can't occur in new clauses anymore
+            occurrences[idx(lit)].clear();
+            occurrences[idx(-lit)].clear();
+        }
+        return changed;
+    }
+
+    bool Formula::substituteEquivalences() {
+        // implication graph of the binary clauses: a || b gives !a -> b and !b -> a
+        const int n = occurrences.size();
+        std::vector<std::vector<int>> edges(n);
+        for (const Clause &clause : clauses) {
+            if (clause.deleted || clause.lits.size() != 2)
+                continue;
+            const int a = clause.lits[0], b = clause.lits[1];
+            edges[idx(-a)].push_back(b);
+            edges[idx(-b)].push_back(a);
+        }
+
+        // iterative Tarjan as in DependencyGraph, nodes are literal indices
+        std::vector<int> index(n, -1), lowlink(n), component(n, -1), stack;
+        std::vector<bool> onStack(n, false);
+        std::vector<std::pair<int, size_t>> work;  // literal, next edge
+        std::vector<int> representative;           // component -> literal
+        int counter = 0;
+        auto visit = [&](int lit) {
+            const size_t v = idx(lit);
+            index[v] = lowlink[v] = counter++;
+            stack.push_back(lit);
+            onStack[v] = true;
+            work.emplace_back(lit, 0);
+        };
+        for (int root = 2; root < n; root++) {
+            const int rootLit = (root % 2) ? -(root / 2) : root / 2;
+            if (index[root] != -1 || edges[root].empty())
+                continue;
+            visit(rootLit);
+            while (!work.empty()) {
+                const int lit = work.back().first;
+                const size_t v = idx(lit);
+                if (work.back().second < edges[v].size()) {
+                    const int next = edges[v][work.back().second++];
+                    const size_t w = idx(next);
+                    if (index[w] == -1)
+                        visit(next);
+                    else if (onStack[w])
+                        lowlink[v] = std::min(lowlink[v], index[w]);
+                    continue;
+                }
+                work.pop_back();
+                if (!work.empty()) {
+                    const size_t u = idx(work.back().first);
+                    lowlink[u] = std::min(lowlink[u], lowlink[v]);
+                }
+                if (lowlink[v] != index[v])
+                    continue;
+                // prefer a frozen variable, then the lowest one, so that
+                // the component of the negated literals picks the same one
+                const int c = representative.size();
+                int rep = 0, member;
+                do {
+                    member = stack.back();
+                    stack.pop_back();
+                    onStack[idx(member)] = false;
+                    component[idx(member)] = c;
+                    const bool better = !rep
+                        || (frozen[abs(member)] && !frozen[abs(rep)])
+                        || (frozen[abs(member)] == frozen[abs(rep)] && abs(member) < abs(rep));
+                    if (better)
+                        rep = member;
+                } while (member != lit);
+                representative.push_back(rep);
+            }
+        }
+
+        std::vector<int> replacement(values.size(), 0);
+        std::vector<int> affected;
+        for (int var = 1; var < (int) values.size(); var++) {
+            if (component[idx(var)] == -1)
+                continue;
+            if (component[idx(var)] == component[idx(-var)]) {
+                unsat = true;  // var <-> !var
+                return true;
+            }
+            const int rep = representative[component[idx(var)]];
+            if (frozen[var] || abs(rep) == var)
+                continue;
+            replacement[var] = rep;
+            stats.equivalences++;
+            for (int sign : {1, -1})
+                for (int c : occurring(sign * var))
+                    affected.push_back(c);
+        }
+        std::sort(affected.begin(), affected.end());
+        affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+        for (int c : affected) {
+            std::vector<int> lits = clauses[c].lits;
+            for (int &lit : lits)
+                if (int rep = replacement[abs(lit)])
+                    lit = lit > 0 ? rep : -rep;
+            remove(c);
+            add(std::move(lits));
+        }
+        return !affected.empty();
+    }
+
+    bool Formula::subsume() {
+        std::vector<int> order;
+        for (size_t c = 0; c < clauses.size(); c++)
+            if (!clauses[c].deleted)
+                order.push_back(c);
+        std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+            return clauses[a].lits.size() < clauses[b].lits.size();
+        });
+
+        bool changed = false;
+        // does 'clause' contain all of 'lits', with 'flipped' negated?
+        auto covers = [](const Clause &clause, const Clause &lits, int flipped) {
+            if (clause.lits.size() < lits.lits.size()
+                || (lits.signature & ~clause.signature))
+                return false;
+            for (int lit : lits.lits)
+                if (!clause.contains(lit == flipped ? -lit : lit))
+                    return false;
+            return true;
+        };
+        for (int c : order) {
+            // only other clauses are modified, so 'clause' stays valid
+            const Clause &clause = clauses[c];
+            if (clause.deleted)
+                continue;
+            // a subsumed clause contains the rarest literal of this one
+            int rarest = clause.lits[0];
+            for (int lit : clause.lits)
+                if (occurring(lit).size() < occurring(rarest).size())
+                    rarest = lit;
+            std::vector<int> candidates = occurring(rarest);
+            if (candidates.size() <= maxOccurrences) {
+                for (int d : candidates) {
+                    if (d != c && !clauses[d].deleted && covers(clauses[d], clause, 0)) {
+                        remove(d);
+                        stats.subsumed++;
+                        changed = true;
+                    }
+                }
+            }
+            // with 'lit' negated this clause subsumes 'd', so '-lit' can be dropped from 'd'
+            for (int lit : clause.lits) {
+                candidates = occurring(-lit);
+                if (candidates.size() > maxOccurrences)
+                    continue;
+                for (int d : candidates) {
+                    if (d != c && !clauses[d].deleted && covers(clauses[d], clause, lit)) {
+                        strengthen(d, -lit);
+                        stats.strengthened++;
+                        changed = true;
+                    }
+                }
+            }
+        }
+        return changed;
+    }
+
+    bool Formula::eliminate() {
+        std::vector<std::pair<size_t, int>> candidates;  // cost, variable
+        for (int var = 1; var < (int) values.size(); var++) {
+            if (frozen[var] || values[var])
+                continue;
+            const size_t pos = occurring(var).size(), neg = occurring(-var).size();
+            if (pos + neg > 0 && pos + neg <= maxEliminationOccurrences)
+                candidates.emplace_back(pos * neg, var);
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        bool changed = false;
+        std::vector<std::vector<int>> resolvents;
+        for (const auto &candidate : candidates) {
+            const int var = candidate.second;
+            if (values[var])
+                continue;
+            const std::vector<int> pos = occurring(var), neg = occurring(-var);
+            if (pos.size() + neg.size() == 0 || pos.size() + neg.size() > maxEliminationOccurrences)
+                continue;
+            resolvents.clear();
+            bool bounded = true;
+            for (size_t i = 0; bounded && i < pos.size(); i++) {
+                for (size_t j = 0; bounded && j < neg.size(); j++) {
+                    std::vector<int> lits;
+                    for (int lit : clauses[pos[i]].lits)
+                        if (lit != var)
+                            lits.push_back(lit);
+                    for (int lit : clauses[neg[j]].lits)
+                        if (lit != -var)
+                            lits.push_back(lit);
+                    std::sort(lits.begin(), lits.end(), litLess);
+                    lits.erase(std::unique(lits.begin(), lits.end()), lits.end());
+                    bool tautology = false;
+                    for (size_t k = 0; k + 1 < lits.size(); k++)
+                        if (lits[k + 1] == -lits[k])
+                            tautology = true;
+                    if (tautology)
+                        continue;
+                    resolvents.push_back(std::move(lits));
+                    bounded = resolvents.back().size() <= maxResolventSize
+                        && resolvents.size() <= pos.size() + neg.size();
+                }
+            }
+            if (!bounded)
+                continue;
+            for (int c : pos)
+                remove(c);
+            for (int c : neg)
+                remove(c);
+            for (std::vector<int> &lits : resolvents)
+                add(std::move(lits));
+            stats.eliminated++;
+            changed = true;
+            if (unsat)
+                break;
+        }
+        return changed;
+    }
+
+    void Formula::simplify() {
+        bool changed = true;
+        while (changed && !unsat) {
+            changed = propagate();
+            if (!unsat)
+                changed |= substituteEquivalences();
+            if (!unsat)
+                changed |= propagate();
+            if (!unsat)
+                changed |= subsume();
+            if (!unsat)
+                changed |= propagate();
+            if (!unsat)
+                changed |= eliminate();
+        }
+    }
+
+    template <typename F> void Formula::forEachClause(F f) const {
+        for (int var = 1; var < (int) values.size(); var++)
+            if (frozen[var] && values[var])
+                f(std::vector<int>{values[var] * var});
+        for (const Clause &clause : clauses)
+            if (!clause.deleted)
+                f(clause.lits);
+    }
+
+    //! calls 'f' for each clause of 'layers'
+    template <typename F>
+    void forEachClause(const std::vector<const PicosatCNF *> &layers, F f) {
+        std::vector<int> lits;
+        for (const PicosatCNF *layer : layers) {
+            for (int lit : layer->getClauses()) {
+                if (lit) {
+                    lits.push_back(lit);
+                    continue;
+                }
+                f(lits);
+                lits.clear();
+            }
+        }
+    }
+} // namespace
+
+CNFPreprocessor::Stats CNFPreprocessor::simplify(const PicosatCNF &in, PicosatCNF &out) {
+    std::vector<const PicosatCNF *> layers;  // the base first
+    for (const PicosatCNF *layer = &in; layer; layer = layer->getBase())
+        layers.insert(layers.begin(), layer);
+
+    const int vars = in.getVarCount();
+    Formula formula(vars);
+    for (const PicosatCNF *layer : layers)
+        layer->forEachSymbol([&formula, vars](const std::string &, int lit) {
+            if (lit && abs(lit) <= vars)
+                formula.freeze(abs(lit));
+        });
+    forEachClause(layers, [&formula](const std::vector<int> &lits) { formula.add(lits); });
+    formula.simplify();
+
+    // named variables are kept even if they don't occur anymore
+    std::vector<int> renumbered(vars + 1, 0);
+    for (const PicosatCNF *layer : layers)
+        layer->forEachSymbol([&](const std::string &, int lit) {
+            if (lit && abs(lit) <= vars)
+                renumbered[abs(lit)] = 1;
+        });
+    auto mark = [&renumbered](const std::vector<int> &lits) {
+        for (int lit : lits)
+            renumbered[abs(lit)] = 1;
+    };
+    if (formula.unsat) {
+        Logging::warn("the formula is unsatisfiable, it is written without simplifications");
+        forEachClause(layers, mark);
+    } else {
+        formula.forEachClause(mark);
+    }
+    for (int var = 1; var <= vars; var++)
+        if (renumbered[var])
+            renumbered[var] = out.newVar();
+
+    std::set<std::string> keys;
+    for (const PicosatCNF *layer : layers) {
+        layer->forEachSymbol([&](const std::string &name, int lit) {
+            if (lit && abs(lit) <= vars)
+                out.setCNFVar(name, lit > 0 ? renumbered[lit] : -renumbered[-lit]);
+        });
+        layer->forEachSymbolType([&out](const std::string &name, kconfig_symbol_type type) {
+            out.setSymbolType(name, type);
+        });
+        for (const auto &entry : layer->getMetaInformation())  // pair<string, deque<string>>
+            keys.insert(entry.first);
+    }
+    // the values of the topmost layer that has the key, like getMetaValue
+    for (const std::string &key : keys)
+        for (const std::string &value : *in.getMetaValue(key))
+            out.addMetaValue(key, value);
+
+    auto write = [&out, &renumbered](const std::vector<int> &lits) {
+        for (int lit : lits)
+            out.pushVar(lit > 0 ? renumbered[lit] : -renumbered[-lit]);
+        out.pushClause();
+    };
+    if (formula.unsat) {
+        forEachClause(layers, write);
+        return Stats();
+    }
+    formula.forEachClause(write);
+    return formula.stats;
+}
@@ -0,0 +1,65 @@
+/*
+ *   boolean framework for undertaker and satyr
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -*- mode: c++ -*-
+#ifndef KCONFIG_CNFPREPROCESSOR_H
+#define KCONFIG_CNFPREPROCESSOR_H
+
+
+namespace kconfig {
+    class PicosatCNF;
+
+    /**
+     * \brief shrinks generated models without changing their answers
+     *
+     * Named variables (CONFIG_*, FILE_*, ...) are frozen: they are kept
+     * with their names and every check with assumptions on them has the
+     * same result on the simplified formula. Unnamed helper variables,
+     * e.g., from the Tseitin encoding, may disappear. The passes are
+     * repeated until none of them changes the formula anymore:
+     *  - unit propagation,
+     *  - substitution of equivalent literals, found as strongly connected
+     *    components of the implications of the binary clauses,
+     *  - removal of subsumed clauses and of literals by self-subsuming
+     *    resolution,
+     *  - bounded variable elimination of helper variables, i.e., only if
+     *    it doesn't increase the number of clauses.
+     * The solutions found for the named variables may differ from the
+     * ones of the original formula, their satisfiability doesn't.
+     */
+    class CNFPreprocessor {
+    public:
+        struct Stats {
+            int units = 0;         //!< helper variables fixed by unit propagation
+            int equivalences = 0;  //!< helper variables replaced by an equivalent literal
+            int subsumed = 0;      //!< removed clauses
+            int strengthened = 0;  //!< literals removed by self-subsuming resolution
+            int eliminated = 0;    //!< helper variables removed by variable elimination
+        };
+
+        /**
+         * \brief writes the simplified formula 'in' to the empty formula 'out'
+         *
+         * The variables of 'out' are renumbered densely, named variables
+         * keep their names, symbol types and meta information are copied.
+         * If 'in' is layered on a base, the whole formula is written.
+         * An unsatisfiable formula is copied without simplifications.
+         */
+        static Stats simplify(const PicosatCNF &in, PicosatCNF &out);
+    };
+} // namespace kconfig
+#endif
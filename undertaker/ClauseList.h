@@ -0,0 +1,77 @@
+/*
+ *   boolean framework for undertaker and satyr
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -*- mode: c++ -*-
+#ifndef KCONFIG_CLAUSELIST_H
+#define KCONFIG_CLAUSELIST_H
+
+#include "bool.h"
+
+#include <unordered_set>
+#include <vector>
+
+
+namespace kconfig {
+    /**
+     * \brief Conjunction of already built formulas
+     *
+     * The in-memory counterpart of a (Unique)StringJoiner joined with
+     * " && ": the formulas are collected in order and, as long as the
+     * list is unique, each node is only added once. The list doesn't
+     * own the formulas, they have to outlive every use of the list.
+     *
+     * Pushing the list with CNFBuilder::pushClauses() yields the same
+     * CNF as parsing the joined string, provided each formula has the
+     * shape the parser would have built for its string.
+     */
+    class ClauseList {
+        std::vector<const BoolExp *> clauses;
+        std::unordered_set<const BoolExp *> unique;
+        bool uniqueFlag = true;
+
+    public:
+        typedef std::vector<const BoolExp *>::const_iterator const_iterator;
+
+        explicit ClauseList(bool unique = true) : uniqueFlag(unique) {}
+
+        //! appends 'e', a nullptr is ignored (like "" in a StringJoiner)
+        void push_back(const BoolExp *e) {
+            if (!e)
+                return;
+            if (uniqueFlag && !unique.insert(e).second)
+                return;
+            clauses.push_back(e);
+        }
+
+        void append(const ClauseList &other) {
+            for (const BoolExp *e : other)
+                push_back(e);
+        }
+
+        void disableUniqueness() {
+            uniqueFlag = false;
+            unique.clear();
+        }
+
+        size_t size() const { return clauses.size(); }
+        bool empty() const { return clauses.empty(); }
+        const BoolExp *front() const { return clauses.front(); }
+        const_iterator begin() const { return clauses.begin(); }
+        const_iterator end() const { return clauses.end(); }
+    };
+} // namespace kconfig
+#endif
@@ -47,6 +47,9 @@ CnfConfigurationModel::CnfConfigurationModel(const std::string &filename) {
     } else {
         _inConfigurationSpace_regexp = boost::regex("^CONFIG_[^ ]+$");
     }
+    _backbone = kconfig::Backbone(_cnf->getMetaValue(kconfig::Backbone::metaKey));
+    if (!_backbone.empty())
+        Logging::debug("Loaded backbone of ", _backbone.size(), " variables");
     if (_cnf->getVarCount() == 0) {
         // if the model is empty (e.g., if /dev/null was loaded), it cannot possibly be complete
         _cnf->addMetaValue("CONFIGURATION_SPACE_INCOMPLETE", "1");
@@ -78,7 +81,7 @@ std::string CnfConfigurationModel::getType(const std::string &feature_name) cons
 }
 
 bool CnfConfigurationModel::containsSymbol(const std::string &symbol) const {
-    return undertaker::starts_with(symbol, "FILE_") || _cnf->getAssociatedSymbol(symbol) != nullptr;
+    return undertaker::starts_with(symbol, "FILE_") || !_cnf->getAssociatedSymbol(symbol).empty();
 }
 
 void CnfConfigurationModel::addMetaValue(const std::string &key, const std::string &val) const {
@@ -88,3 +91,7 @@ void CnfConfigurationModel::addMetaValue(const std::string &key, const std::stri
 const StringList *CnfConfigurationModel::getMetaValue(const std::string &key) const {
     return _cnf->getMetaValue(key);
 }
+
+bool CnfConfigurationModel::contradictsBackbone(const kconfig::ClauseList &clauses) const {
+    return _backbone.refutes(clauses);
+}
@@ -23,6 +23,7 @@
 #define cnf_configuration_model_h__
 
 #include "ConfigurationModel.h"
+#include "Backbone.h"
 
 namespace kconfig {
     class PicosatCNF;
@@ -31,9 +32,11 @@ namespace kconfig {
 
 class CnfConfigurationModel: public ConfigurationModel {
     kconfig::PicosatCNF *_cnf = nullptr;
+    kconfig::Backbone _backbone;
 
     void doIntersectPreprocess(std::set<std::string> &, StringJoiner &,
-                               std::set<std::string> *) const final override {}
+                               std::set<std::string> *,
+                               kconfig::ClauseList *) const final override {}
 
     void addMetaValue(const std::string &key, const std::string &val) const final override;
 
@@ -61,5 +64,6 @@ public:
 
     bool containsSymbol(const std::string &symbol)         const final override;
     const StringList *getMetaValue(const std::string &key) const final override;
+    bool contradictsBackbone(const kconfig::ClauseList &clauses) const final override;
 };
 #endif
@@ -26,9 +26,12 @@
 
 #include "ConditionalBlock.h"
 #include "StringJoiner.h"
+#include "ClauseList.h"
 #include "ModelContainer.h"
 #include "Logging.h"
+#include "exceptions/CNFBuilderError.h"
 #include "PumaConditionalBlock.h"
+#include "CppFileSnapshot.h"
 typedef PumaConditionalBlock ConditionalBlockImpl;
 #include "cpp14.h"
 
@@ -55,8 +58,23 @@ static int lineFromPosition(std::string line) {
     }
 }
 
-static ConditionalBlockImpl *createDummyElseBlock(ConditionalBlock *i, ConditionalBlock *parent,
-                                                  ConditionalBlock *prev) {
+static kconfig::BoolExp *var(const std::string &name) {
+    return new kconfig::BoolExpVar(name, false);
+}
+
+//! the formula "B00", shared by all files
+static const kconfig::BoolExp *fileClause() {
+    // never freed, the destructor of a BoolExp would free the node itself
+    static const kconfig::BoolExp *const b00 = var("B00");
+    return b00;
+}
+
+static ConditionalBlock *createDummyElseBlock(ConditionalBlock *i, ConditionalBlock *parent,
+                                              ConditionalBlock *prev) {
+    // files restored from snapshots have no Puma tokens
+    if (SnapshotConditionalBlock *block = dynamic_cast<SnapshotConditionalBlock *>(i))
+        return block->createDummyElseBlock(parent, prev);
+
     ConditionalBlockImpl *superblock = dynamic_cast<ConditionalBlockImpl *>(i);
     if (!superblock) {
         Logging::error("failed to access the super-class of Conditionalblock");
@@ -86,15 +104,26 @@ static ConditionalBlockImpl *createDummyElseBlock(ConditionalBlock *i, Condition
 // initialize static filename_regex at startup
 const boost::regex CppFile::filename_regex(R"(^.*/arch/([A-Za-z0-9]+)/.*$)");
 
-CppFile::CppFile(const std::string &f) {
+CppFile::CppFile(const std::string &f, bool useSnapshot) {
     if (!boost::filesystem::exists(f))
         return;
     if (f[0] != '.' && f[1] != '/')
         filename = f;
     else
         filename = f.substr(2); // skip leading "./"
-    _builder = make_unique<PumaConditionalBlockBuilder>(this, f);
-    top_block = _builder->topBlock();
+
+    useSnapshot = useSnapshot && CppFileSnapshot::isEnabled();
+    if (useSnapshot)
+        top_block = CppFileSnapshot::load(this, f, included_files);
+    if (!top_block) {
+        std::lock_guard<std::mutex> guard(PumaConditionalBlockBuilder::pumaLock);
+        _builder = make_unique<PumaConditionalBlockBuilder>(this, f);
+        top_block = _builder->topBlock();
+        included_files = _builder->getIncludedFiles();
+        if (top_block && useSnapshot)
+            CppFileSnapshot::store(this, f, _builder->getIncludedFiles(),
+                                   _builder->getUnresolvedIncludes(), _builder->getDefines());
+    }
 
     boost::filesystem::path filepath(filename);
     // check if the 'absolute path' to the given file matches the regex
@@ -106,6 +135,7 @@ CppFile::CppFile(const std::string &f) {
 }
 
 CppFile::~CppFile() {
+    std::lock_guard<std::mutex> guard(PumaConditionalBlockBuilder::pumaLock);
     /* Delete the toplevel block */
     delete topBlock();
 
@@ -116,6 +146,13 @@ CppFile::~CppFile() {
     // Remove also all defines
     for (auto &entry : *getDefines())  // pair<string, CppDefine *>
         delete entry.second;
+
+    // free the Puma syntax tree while still holding the lock
+    _builder.reset();
+}
+
+std::unique_lock<std::mutex> CppFile::lockParser() {
+    return std::unique_lock<std::mutex>(PumaConditionalBlockBuilder::pumaLock);
 }
 
 ConditionalBlock *CppFile::getBlockAtPosition(const std::string &position) {
@@ -150,6 +187,8 @@ const std::string &CppFile::getFileVar() {
 }
 
 void CppFile::decisionCoverage() {
+    // the transformation creates Puma tokens for the inserted else blocks
+    std::lock_guard<std::mutex> guard(PumaConditionalBlockBuilder::pumaLock);
 #if 0
     Logging::debug("======== before TRANSFORMATION ========");
     this->topBlock()->printConditionalBlocks(0);
@@ -203,7 +242,7 @@ void ConditionalBlock::processForDecisionCoverage() {
         if (prev != this->end() && (*i)->isIfBlock() &&
                 ((*prev)->isIfBlock() || (*prev)->isElseIfBlock())) {
             ConditionalBlock *parent = const_cast<ConditionalBlock *>((*i)->_parent);
-            ConditionalBlockImpl *nblock = createDummyElseBlock(*i, parent, *prev);
+            ConditionalBlock *nblock = createDummyElseBlock(*i, parent, *prev);
             parent->insert(i, nblock);
             // this inserts the Block also into the correct position in the CppFile List
             insertBlockIntoFile(*i, nblock);
@@ -211,7 +250,7 @@ void ConditionalBlock::processForDecisionCoverage() {
         // when the last element of the list is an if-expression
         if (*i == this->back() && ((*i)->isIfBlock() || (*i)->isElseIfBlock())) {
             ConditionalBlock *parent = const_cast<ConditionalBlock *>((*i)->_parent);
-            ConditionalBlockImpl *nblock = createDummyElseBlock(*i, parent, *i);
+            ConditionalBlock *nblock = createDummyElseBlock(*i, parent, *i);
             parent->push_back(nblock);
             // this inserts the Block also into the correct position in the CppFile List
             if (*i == this->getFile()->back())
@@ -242,6 +281,13 @@ void ConditionalBlock::printConditionalBlocks(int indent) {
     }
 }
 
+ConditionalBlock::~ConditionalBlock() {
+    delete cached_code_expression;
+    delete cached_code_clauses;
+    delete constraint_clause;
+    delete build_system_clause;
+}
+
 void ConditionalBlock::lateConstructor() {
     if (!_parent) // The toplevel block
         return;
@@ -295,6 +341,47 @@ std::string ConditionalBlock::getConstraintsHelper(UniqueStringJoiner *and_claus
     return join ? and_clause->join(" && ") : "";
 }
 
+const kconfig::BoolExp *ConditionalBlock::getConstraintClause() {
+    if (!_parent)
+        return nullptr;
+    if (constraint_clause)
+        return constraint_clause;
+
+    // the formula the parser builds for the string of getConstraintsHelper()
+    std::vector<kconfig::BoolExp *> inner;
+    if (_parent != cpp_file->topBlock())
+        inner.push_back(var(_parent->getName()));
+
+    if (ifdefExpression() != "") {
+        kconfig::BoolExp *exp = kconfig::BoolExp::parseString(ifdefExpression());
+        if (!exp) {
+            for (kconfig::BoolExp *e : inner)
+                delete e;
+            throw CNFBuilderError("ConditionalBlock: Couldn't parse: " + ifdefExpression());
+        }
+        inner.push_back(exp);
+    }
+
+    kconfig::BoolExp *predecessors = nullptr;
+    for (const ConditionalBlock *block = this; !block->isIfBlock();) {
+        block = block->getPrev();
+        kconfig::BoolExp *pred = var(block->getName());
+        predecessors = predecessors ? new kconfig::BoolExpOr(predecessors, pred) : pred;
+    }
+    if (predecessors)
+        inner.push_back(new kconfig::BoolExpNot(predecessors));
+
+    if (inner.empty())
+        throw CNFBuilderError("ConditionalBlock: " + getName() + " has no condition");
+
+    kconfig::BoolExp *conjunction = inner[0];
+    for (size_t i = 1; i < inner.size(); i++)
+        conjunction = new kconfig::BoolExpAnd(conjunction, inner[i]);
+
+    constraint_clause = new kconfig::BoolExpEq(var(getName()), conjunction);
+    return constraint_clause;
+}
+
 std::string ConditionalBlock::getCodeConstraints(UniqueStringJoiner *and_clause,
                                                  std::set<ConditionalBlock *> *visited) {
     UniqueStringJoiner sj; // on our stack
@@ -363,10 +450,77 @@ std::string ConditionalBlock::getCodeConstraints(UniqueStringJoiner *and_clause,
     return join ? and_clause->join("\n&& ") : "";
 }
 
+const kconfig::ClauseList &ConditionalBlock::getCodeClauses(kconfig::ClauseList *and_clause,
+                                                            std::set<ConditionalBlock *> *visited) {
+    // mirrors getCodeConstraints(), including what is cached when
+    kconfig::ClauseList sj; // on our stack
+
+    if (!and_clause) {
+        if (cached_code_clauses)
+            return *cached_code_clauses;
+        and_clause = &sj; // We are the toplevel call
+    }
+
+    std::set<ConditionalBlock *> vs;
+    if (!visited)
+        visited = &vs;
+
+    if (visited->count(this) == 0) {
+        // Mark our node as visited
+        visited->insert(this);
+
+        if (!_parent) { // Toplevel block
+            // no formula is added twice, see getCodeConstraints()
+            if (and_clause == &sj)
+                and_clause->disableUniqueness();
+
+            // Add formulas for all blocks
+            for (auto &block : *cpp_file)  // ConditionalBlock *
+                and_clause->push_back(block->getConstraintClause());
+
+            /* Get all used defines */
+            for (auto &entry : *cpp_file->getDefines())  // pair<string, CppDefine *>
+                entry.second->getClausesHelper(and_clause);
+
+            and_clause->push_back(fileClause());
+        } else {
+            const ConditionalBlock *block = this;
+            and_clause->push_back(getConstraintClause());
+
+            if (block->isIfBlock())
+                block = block->getParent();
+            else
+                block = block->getPrev();
+
+            if (block && block != cpp_file->topBlock())
+                const_cast<ConditionalBlock *>(block)->getCodeClauses(and_clause, visited);
+
+            and_clause->push_back(fileClause());
+            for (auto &entry : *cpp_file->getDefines()) {  // pair<string, CppDefine *>
+                CppDefine *define = entry.second;
+                if (define->containsDefinedSymbol(ExpressionStr()))
+                    define->getClauses(and_clause, visited);
+            }
+        }
+    }
+
+    if (!cached_code_clauses)
+        cached_code_clauses = new kconfig::ClauseList(*and_clause);
+
+    // a toplevel call has just cached its result
+    return *cached_code_clauses;
+}
+
 std::string ConditionalBlock::getBuildSystemCondition() const {
     return "( B00 <-> " + fileVar() + " )";
 }
 
+const kconfig::BoolExp *ConditionalBlock::getBuildSystemClause() {
+    if (!build_system_clause)
+        build_system_clause = new kconfig::BoolExpEq(var("B00"), var(fileVar()));
+    return build_system_clause;
+}
+
 /************************************************************************/
 /* CppDefine                                                            */
 /************************************************************************/
@@ -376,6 +530,11 @@ CppDefine::CppDefine(ConditionalBlock *defined_in, bool define, const std::strin
     newDefine(defined_in, define);
 }
 
+CppDefine::~CppDefine() {
+    for (kconfig::BoolExp *clause : defineClauses)
+        delete clause;
+}
+
 void CppDefine::newDefine(ConditionalBlock *parent, bool define) {
     const char *rewriteToken = ".";
     std::string new_symbol = actual_symbol + rewriteToken;
@@ -393,9 +552,18 @@ void CppDefine::newDefine(ConditionalBlock *parent, bool define) {
 
     // Block defined -> new_symbol is active
     defineExpressions.push_back("(" + parent->getName() + " -> " + right_side + ")");
+    kconfig::BoolExp *value = var(new_symbol);
+    if (!define)
+        value = new kconfig::BoolExpNot(value);
+    defineClauses.push_back(new kconfig::BoolExpImpl(var(parent->getName()), value));
 
     // !block defined -> old symbol == new_symbol
     defineExpressions.push_back("(!" + parent->getName() + " -> (" + actual_symbol + " <-> " + new_symbol + "))");
+    defineClauses.push_back(new kconfig::BoolExpImpl(
+        new kconfig::BoolExpNot(var(parent->getName())),
+        new kconfig::BoolExpEq(var(actual_symbol), var(new_symbol))));
+
+    rewrites.push_back({parent, define, actual_symbol, new_symbol});
 
     /* B --> B. */
     actual_symbol = new_symbol;
@@ -449,3 +617,20 @@ std::string CppDefine::getConstraints(UniqueStringJoiner *and_clause,
     }
     return join ? and_clause->join("\n&& ") : "";
 }
+
+void CppDefine::getClausesHelper(kconfig::ClauseList *and_clause) const {
+    for (const kconfig::BoolExp *clause : defineClauses)
+        and_clause->push_back(clause);
+}
+
+void CppDefine::getClauses(kconfig::ClauseList *and_clause,
+                           std::set<ConditionalBlock *> *visited) const {
+    getClausesHelper(and_clause);
+
+    for (auto &block : defined_in) {  // ConditionalBlock *
+        // Not yet visited and not the toplevel block
+        if (visited->count(block) == 0 && block->getParent() != nullptr) {
+            block->getCodeClauses(and_clause, visited);
+        }
+    }
+}
@@ -26,6 +26,9 @@
 
 #include "BlockDefectAnalyzer.h"
 
+#include <mutex>
+#include <set>
+#include <string>
 #include <boost/regex.hpp>
 
 class ConditionalBlock;
@@ -33,6 +36,11 @@ class CppDefine;
 class PumaConditionalBlockBuilder;
 struct UniqueStringJoiner;
 
+namespace kconfig {
+    class BoolExp;
+    class ClauseList;
+} // namespace kconfig
+
 typedef std::list<ConditionalBlock *> CondBlockList;
 
 
@@ -47,14 +55,19 @@ class CppFile : public CondBlockList {
     ConditionalBlock *top_block = nullptr;
     std::map<std::string, CppDefine *> define_map;
     std::unique_ptr<PumaConditionalBlockBuilder> _builder;
+    std::set<std::string> included_files;
 
     void printCppFile();
 
     static const boost::regex filename_regex;
 
 public:
-    //! \param filename file with cpp expressions to parse
-    explicit CppFile(const std::string &filename);
+    /**
+     * \param filename file with cpp expressions to parse
+     * \param useSnapshot restore the file from its snapshot if possible
+     *        (see CppFileSnapshot), the blocks have no Puma tokens then
+     */
+    explicit CppFile(const std::string &filename, bool useSnapshot = true);
     ~CppFile();
 
     //! Check if the file was correctly parsed
@@ -91,6 +104,15 @@ public:
     //! get specific_arch string
     const std::string &getSpecificArch() const { return specific_arch; }
 
+    //! the files #included while parsing, also if the file was restored from its snapshot
+    const std::set<std::string> &getIncludedFiles() const { return included_files; }
+
+    /**
+     * Locks the parser, which isn't thread-safe, until the returned lock
+     * is released. Needed to use the Puma tokens of the blocks.
+     */
+    static std::unique_lock<std::mutex> lockParser();
+
     const std::function<bool(std::string)> getDefineChecker() const {
         return [this](std::string item) {
             const std::map<std::string, CppDefine *> &defines = define_map;
@@ -106,6 +128,10 @@ public:
 class ConditionalBlock : public CondBlockList {
     std::string _exp;
     std::string *cached_code_expression = nullptr;
+    kconfig::ClauseList *cached_code_clauses = nullptr;
+    // the formulas of getConstraintsHelper() and getBuildSystemCondition(), built on first use
+    kconfig::BoolExp *constraint_clause = nullptr;
+    kconfig::BoolExp *build_system_clause = nullptr;
 
     void insertBlockIntoFile(ConditionalBlock *prevBlock, ConditionalBlock *nblock,
                              bool insertAfter = false);
@@ -129,6 +155,12 @@ public:
     virtual bool isDummyBlock()         const = 0; //!< is Dummy-Block
     virtual void setDummyBlock()              = 0; //!< set Block to dummy state
     virtual const std::string getName() const = 0; //!< unique identifier for block
+    /**
+     * Dense id of the block in its file: 0 for the top level block
+     * ("B00"), 1 + n for block "B<n>". It identifies blocks without
+     * building or matching their names.
+     */
+    virtual unsigned long getIndex()    const = 0;
 
     /**
      * This function doesn't affect the logic of the CPPPC algorithm, but changes
@@ -150,7 +182,7 @@ public:
     //! Has to be called after constructing a ConditionalBlock
     void lateConstructor();
 
-    virtual ~ConditionalBlock() { delete cached_code_expression; };
+    virtual ~ConditionalBlock();
 
     //! \return name of the file containing this block
     const std::string &filename() const { return cpp_file->getFilename(); };
@@ -172,11 +204,24 @@ public:
     std::string getCodeConstraints(UniqueStringJoiner *and_clause = nullptr,
                                    std::set<ConditionalBlock *> *visited = nullptr);
 
+    /**
+     * The formulas of getCodeConstraints() as a list instead of a joined
+     * string, checking them doesn't need the parser. The formulas are
+     * owned by the blocks and defines of the file.
+     * \throws CNFBuilderError if an expression of a block can't be parsed
+     */
+    const kconfig::ClauseList &getCodeClauses(kconfig::ClauseList *and_clause = nullptr,
+                                              std::set<ConditionalBlock *> *visited = nullptr);
+
     std::string getBuildSystemCondition() const;
+    //! the formula of getBuildSystemCondition()
+    const kconfig::BoolExp *getBuildSystemClause();
 
     void addDefine(CppDefine *define) { _defines.push_back(define); }
 
     std::string getConstraintsHelper(UniqueStringJoiner *and_clause = nullptr) const;
+    //! the formula added by getConstraintsHelper(), nullptr for the top block
+    const kconfig::BoolExp *getConstraintClause();
     const std::deque<CppDefine *> &getDefines() const { return _defines; };
 
     //! the following functions have to be public because decisionCoverage() is
@@ -190,6 +235,9 @@ public:
     void printConditionalBlocks(int indent);
 
 protected:
+    //! for blocks that don't call lateConstructor()
+    void setIfdefExpression(const std::string &exp) { _exp = exp; }
+
     CppFile *cpp_file = nullptr;
     const ConditionalBlock *_parent = nullptr, *_prev = nullptr;
     std::deque<CppDefine *> _defines;
@@ -202,17 +250,29 @@ protected:
 /************************************************************************/
 
 class CppDefine {
+public:
+    //! a #define or #undef: 'symbol' is set in 'block', it is 'previous' if 'block' is disabled
+    struct Rewrite {
+        const ConditionalBlock *block;
+        bool define;
+        std::string previous, symbol;
+    };
+
+private:
     std::set<std::string> isUndef;
     std::string actual_symbol;  // The defined symbol will be replaced by this
     std::string defined_symbol;  // The defined symbol
 
     std::deque<ConditionalBlock *> defined_in;
     std::deque<std::string> defineExpressions;
+    std::deque<kconfig::BoolExp *> defineClauses;  // the parsed defineExpressions
+    std::deque<Rewrite> rewrites;  // in the order of the file
 
     boost::regex replaceRegex;
 
 public:
     CppDefine(ConditionalBlock *parent, bool define, const std::string &id);
+    ~CppDefine();
     void newDefine(ConditionalBlock *parent, bool define);
 
     void replaceDefinedSymbol(std::string &exp);
@@ -222,6 +282,14 @@ public:
 
     void getConstraintsHelper(UniqueStringJoiner *and_clause) const;
 
+    //! like getConstraints(), but collects the formulas, see ConditionalBlock::getCodeClauses()
+    void getClauses(kconfig::ClauseList *and_clause, std::set<ConditionalBlock *> *visited) const;
+
+    void getClausesHelper(kconfig::ClauseList *and_clause) const;
+
     bool containsDefinedSymbol(const std::string &exp);
+
+    //! the symbols the defined symbol is rewritten to, see newDefine()
+    const std::deque<Rewrite> &getRewrites() const { return rewrites; }
 };
 #endif /* _CONDITIONALBLOCK_H_ */
@@ -21,8 +21,10 @@
 
 #include "ConfigurationModel.h"
 #include "StringJoiner.h"
+#include "ClauseList.h"
 #include "Tools.h"
 #include "Logging.h"
+#include "exceptions/CNFBuilderError.h"
 
 
 std::string ConfigurationModel::getMissingItemsConstraints(const std::set<std::string> &missing) {
@@ -35,15 +37,48 @@ std::string ConfigurationModel::getMissingItemsConstraints(const std::set<std::s
     return {};
 }
 
+ConfigurationModel::~ConfigurationModel() {
+    for (auto &entry : _clauses)  // pair<string, BoolExp *>
+        delete entry.second;
+}
+
+std::unique_ptr<kconfig::BoolExp>
+ConfigurationModel::getMissingItemsClause(const std::set<std::string> &missing) {
+    // ( ! ( A || B || C ) ) is parsed as !((A || B) || C)
+    kconfig::BoolExp *disjunction = nullptr;
+    for (const std::string &str : missing) {
+        kconfig::BoolExp *var = new kconfig::BoolExpVar(str, false);
+        disjunction = disjunction ? new kconfig::BoolExpOr(disjunction, var) : var;
+    }
+    if (!disjunction)
+        return nullptr;
+    return std::unique_ptr<kconfig::BoolExp>(new kconfig::BoolExpNot(disjunction));
+}
+
+const kconfig::BoolExp *ConfigurationModel::getClause(const std::string &formula) const {
+    std::lock_guard<std::mutex> guard(_clauses_lock);
+    kconfig::BoolExp *&clause = _clauses[formula];
+    if (!clause) {
+        clause = kconfig::BoolExp::parseString(formula);
+        if (!clause) {
+            _clauses.erase(formula);
+            throw CNFBuilderError("ConfigurationModel: Couldn't parse: " + formula);
+        }
+    }
+    return clause;
+}
+
 std::set<std::string> ConfigurationModel::doIntersect(const std::string exp,
                                                       const std::function<bool(std::string)> &c,
                                                       std::set<std::string> &missing,
                                                       std::string &intersected,
-                                                      std::set<std::string> *exclude_set) const {
-    std::set<std::string> start_items = undertaker::itemsOfString(exp);
+                                                      std::set<std::string> *exclude_set,
+                                                      kconfig::ClauseList *clauses) const {
+    std::set<std::string> start_items = *undertaker::itemsOfString(exp);
 
     StringJoiner sj;
-    doIntersectPreprocess(start_items, sj, exclude_set);  // preprocess depending on model type
+    // preprocess depending on model type
+    doIntersectPreprocess(start_items, sj, exclude_set, clauses);
 
     // add all items from start_items into 'sj' if they are in the model && in ALWAYS_{ON,OFF}
     // and if they are not in the model, check if they could be missing
@@ -53,13 +88,19 @@ std::set<std::string> ConfigurationModel::doIntersect(const std::string exp,
         if (containsSymbol(str)) {
             if (always_on) {
                 const auto &cit = std::find(always_on->begin(), always_on->end(), str);
-                if (cit != always_on->end())  // str is found
+                if (cit != always_on->end()) {  // str is found
                     sj.push_back(str);
+                    if (clauses)
+                        clauses->push_back(getClause(str));
+                }
             }
             if (always_off) {
                 const auto &cit = std::find(always_off->begin(), always_off->end(), str);
-                if (cit != always_off->end())  // str is found
+                if (cit != always_off->end()) {  // str is found
                     sj.push_back("!" + str);
+                    if (clauses)
+                        clauses->push_back(getClause("!" + str));
+                }
             }
         } else {
             // check if the symbol might be in the model space. if not it can't be missing!
@@ -27,21 +27,31 @@
 #include <string>
 #include <set>
 #include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <boost/regex.hpp>
 
 using StringList = std::deque<std::string>;
 struct StringJoiner;
 
+namespace kconfig {
+    class BoolExp;
+    class ClauseList;
+} // namespace kconfig
+
 
 class ConfigurationModel {
     virtual void doIntersectPreprocess(std::set<std::string> &start_items, StringJoiner &sj,
-                                       std::set<std::string> *exclude_set) const = 0;
+                                       std::set<std::string> *exclude_set,
+                                       kconfig::ClauseList *clauses) const = 0;
 
     virtual void addMetaValue(const std::string &key, const std::string &feature) const = 0;
 
 public:
     //! destructor
-    virtual ~ConfigurationModel(){};
+    virtual ~ConfigurationModel();
 
     //! returns the version identifier for the current model
     virtual const std::string getModelVersionIdentifier() const = 0;
@@ -64,14 +74,28 @@ public:
 
     virtual const StringList *getMetaValue(const std::string &key) const = 0;
 
+    /**
+     * Returns true if the backbone of the model (see kconfig::Backbone)
+     * shows that 'clauses' can't be satisfied together with the whole
+     * model, which makes a SAT check unnecessary. Only models that are
+     * checked as a whole, not sliced, can use their backbone.
+     */
+    virtual bool contradictsBackbone(const kconfig::ClauseList &) const { return false; }
+
 /************************************************************************/
 /* non virtual methods                                                  */
 /************************************************************************/
 
+    /**
+     * If 'clauses' is given, the formulas joined in 'intersected' are
+     * additionally appended to it. They are built once per model and
+     * stay valid as long as the model.
+     */
     std::set<std::string> doIntersect(const std::string exp,
                                       const std::function<bool(std::string)> &c,
                                       std::set<std::string> &missing, std::string &intersected,
-                                      std::set<std::string> *exclude_set = nullptr) const;
+                                      std::set<std::string> *exclude_set = nullptr,
+                                      kconfig::ClauseList *clauses = nullptr) const;
 
     //! add feature to whitelist ('ALWAYS_ON')
     void addFeatureToWhitelist(const std::string &feature);
@@ -94,11 +118,25 @@ public:
     std::string getName() const { return _name; }
 
     static std::string getMissingItemsConstraints(const std::set<std::string> &missing);
+    //! the formula of getMissingItemsConstraints(), nullptr if 'missing' is empty
+    static std::unique_ptr<kconfig::BoolExp>
+    getMissingItemsClause(const std::set<std::string> &missing);
 
 protected:
     ConfigurationModel() = default;
 
+    /**
+     * Returns the parsed 'formula', each distinct formula is only parsed once.
+     * \throws CNFBuilderError if 'formula' can't be parsed
+     */
+    const kconfig::BoolExp *getClause(const std::string &formula) const;
+
     std::string _name;
     boost::regex _inConfigurationSpace_regexp;
+
+private:
+    // models are shared by the worker threads
+    mutable std::mutex _clauses_lock;
+    mutable std::map<std::string, kconfig::BoolExp *> _clauses;
 };
 #endif
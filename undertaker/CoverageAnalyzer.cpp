@@ -25,6 +25,11 @@
 #include "ConfigurationModel.h"
 #include "exceptions/CNFBuilderError.h"
 #include "Logging.h"
+#include "Tools.h"
+
+#include <chrono>
+#include <map>
+#include <unordered_set>
 
 
 /************************************************************************/
@@ -74,16 +79,22 @@ std::string CoverageAnalyzer::baseFileExpression(const ConfigurationModel *model
 /************************************************************************/
 
 std::list<SatChecker::AssignmentMap> SimpleCoverageAnalyzer::blockCoverage(ConfigurationModel *model) {
-    std::set<std::string> blocks_set;
+    // indexed by ConditionalBlock::getIndex()
+    std::vector<bool> blocks_set(file->size() + 1);
     std::list<SatChecker::AssignmentMap> ret;
-    std::set<SatChecker::AssignmentMap> found_solutions;
+    // the solutions projected onto the configuration space
+    SatChecker::AssignmentProjection projection([model](const std::string &name) {
+        return !model || model->inConfigurationSpace(name);
+    });
+    std::unordered_set<SatChecker::AssignmentProjection::Bits,
+                       SatChecker::AssignmentProjection::Hash> found_solutions;
     try {
         BaseExpressionSatChecker sc(baseFileExpression(model), model);
 
         for (const auto &block : *file) {      // ConditionalBlock *
-            SatChecker::AssignmentMap current_solution;
+            SatChecker::AssignmentProjection::Bits current_solution;
 
-            if (blocks_set.find(block->getName()) == blocks_set.end()) {
+            if (!blocks_set[block->getIndex()]) {
                 /* does this block contribute to the set of configurations? */
                 bool new_solution = false;
 
@@ -91,16 +102,17 @@ std::list<SatChecker::AssignmentMap> SimpleCoverageAnalyzer::blockCoverage(Confi
                 if (!sc( { block->getName() } ))
                     continue;
 
-                static const boost::regex block_regexp("^B\\d+$");
                 for (const auto &assignment : sc.getAssignment()) { // pair<string, bool>
                     const std::string &name = assignment.first;
                     const bool enabled = assignment.second;
+                    const long index = undertaker::blockIndex(name);
 
-                    if (boost::regex_match(name, block_regexp)) {
+                    if (index >= 0) {
                         // if a block is enabled, and not already in the block set, we enable it
                         // with this configuration and get a new solution
-                        if (enabled && blocks_set.find(name) == blocks_set.end()) {
-                            blocks_set.insert(name);
+                        if (enabled && (unsigned long) index < blocks_set.size()
+                            && !blocks_set[index]) {
+                            blocks_set[index] = true;
                             new_solution = true;
                         }
                         // No blocks in the assignment maps
@@ -109,16 +121,11 @@ std::list<SatChecker::AssignmentMap> SimpleCoverageAnalyzer::blockCoverage(Confi
 
                     // If no model is given or the symbol is in the model space we can push the
                     // assignment to the current solution.
-                    if (!model || model->inConfigurationSpace(name))
-                        current_solution.emplace(name, enabled);
+                    current_solution.set(projection.bit(name), enabled);
                 }
 
-                if (found_solutions.find(current_solution) == found_solutions.end()) {
-                    found_solutions.insert(current_solution);
-
-                    if (new_solution)
-                        ret.push_back(sc.getAssignment());
-                }
+                if (found_solutions.insert(current_solution).second && new_solution)
+                    ret.push_back(sc.getAssignment());
             }
         }
     } catch (CNFBuilderError &e) {
@@ -134,7 +141,15 @@ std::list<SatChecker::AssignmentMap> SimpleCoverageAnalyzer::blockCoverage(Confi
 /************************************************************************/
 
 std::list<SatChecker::AssignmentMap> MinimizeCoverageAnalyzer::blockCoverage(ConfigurationModel *model) {
-    std::set<std::string> blocks_set;
+    // indexed by ConditionalBlock::getIndex()
+    std::vector<bool> blocks_set(file->size() + 1);
+    size_t covered = 0;
+    auto cover = [&blocks_set, &covered](unsigned long index) {
+        if (index < blocks_set.size() && !blocks_set[index]) {
+            blocks_set[index] = true;
+            covered++;
+        }
+    };
     std::list<SatChecker::AssignmentMap> ret;
 
     try {
@@ -146,25 +161,23 @@ std::list<SatChecker::AssignmentMap> MinimizeCoverageAnalyzer::blockCoverage(Con
         BaseExpressionSatChecker sc(baseFileExpression(model), model);
 
         if(sc(configuration)) { // Configuration is an empty list here
-            static const boost::regex block_regexp("^B\\d+$");
             for (const auto &assignment : sc.getAssignment()) {  // pair<string, bool>
                 if (assignment.second == false) continue; // Not enabled
                 const std::string &block_name = assignment.first;
-                if (boost::regex_match(block_name, block_regexp)) {
+                const long index = undertaker::blockIndex(block_name);
+                if (index >= 0) {
                     configuration.insert(block_name);
-                    blocks_set.insert(block_name);
+                    cover(index);
                 }
             }
             goto dump_configuration;
         }
 
         // For the first round, configuration size will be non-zero at this point
-        while (blocks_set.size() < file->size()) {
+        while (covered < file->size()) {
             for(const auto &block : *file) {  // ConditionalBlock *
-                std::string block_name = block->getName();
-
                 // Was already enabled in an other configuration
-                if (blocks_set.count(block_name) > 0) continue;
+                if (blocks_set[block->getIndex()]) continue;
 
                 // We check here if the selected block is surely in conflict with another block
                 // already in the current configuration.
@@ -190,7 +203,7 @@ std::list<SatChecker::AssignmentMap> MinimizeCoverageAnalyzer::blockCoverage(Con
                     // Block couldn't be enabled
                     if (configuration.size() == 1) {
                         // dead block; just ignore it
-                        blocks_set.insert(block->getName());
+                        cover(block->getIndex());
                         configuration.clear();
                     }
                     configuration.erase(block->getName());
@@ -198,7 +211,7 @@ std::list<SatChecker::AssignmentMap> MinimizeCoverageAnalyzer::blockCoverage(Con
                     continue;
                 } else {
                     // Block will be enabled with this configuration
-                    blocks_set.insert(block_name);
+                    cover(block->getIndex());
                 }
             }
         dump_configuration:
@@ -219,3 +232,124 @@ std::list<SatChecker::AssignmentMap> MinimizeCoverageAnalyzer::blockCoverage(Con
     }
     return ret;
 }
+
+/************************************************************************/
+/* MaxSatCoverageAnalyzer                                               */
+/************************************************************************/
+
+std::list<SatChecker::AssignmentMap> MaxSatCoverageAnalyzer::blockCoverage(ConfigurationModel *model) {
+    // indexed by ConditionalBlock::getIndex()
+    std::vector<bool> blocks_set(file->size() + 1);
+    size_t covered = 0;
+    auto cover = [&blocks_set, &covered](unsigned long index) {
+        if (index < blocks_set.size() && !blocks_set[index]) {
+            blocks_set[index] = true;
+            covered++;
+        }
+    };
+    std::map<std::string, unsigned long> indices;
+    for (const auto &block : *file)  // ConditionalBlock *
+        indices[block->getName()] = block->getIndex();
+    std::list<SatChecker::AssignmentMap> ret;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    bool exhausted = false;
+
+    try {
+        BaseExpressionSatChecker sc(baseFileExpression(model), model);
+
+        while (covered < file->size()) {
+            std::set<std::string> assumed;
+            for (const auto &entry : indices)  // pair<string, unsigned long>
+                if (!blocks_set[entry.second])
+                    assumed.insert(entry.first);
+
+            // relax the blocks of each conflict until the remaining ones can be enabled together
+            std::vector<std::string> relaxed;
+            size_t conflicts = 0;
+            bool satisfiable;
+            while (!(satisfiable = sc(assumed))) {
+                const std::set<std::string> core = sc.getFailedAssumptions();
+                if (core.empty())
+                    break;
+                if (std::chrono::steady_clock::now() >= deadline) {
+                    // no more conflicts are searched for, the blocks are tried one by one below
+                    exhausted = true;
+                    relaxed.insert(relaxed.end(), assumed.begin(), assumed.end());
+                    assumed.clear();
+                    continue;
+                }
+                if (core.size() == 1) {
+                    // dead block; just ignore it
+                    cover(indices.at(*core.begin()));
+                    assumed.erase(*core.begin());
+                    continue;
+                }
+                conflicts++;
+                for (const std::string &block : core) {
+                    assumed.erase(block);
+                    relaxed.push_back(block);
+                }
+            }
+            if (!satisfiable) {
+                // the file itself can't be enabled, all remaining blocks are dead
+                for (const auto &entry : indices)  // pair<string, unsigned long>
+                    cover(entry.second);
+                break;
+            }
+
+            // the candidates are pairwise disjoint, one block of each conflict has to stay off
+            const size_t round_bound = assumed.size() + relaxed.size() - conflicts;
+            SatChecker::AssignmentMap best = sc.getAssignment();
+            std::set<std::string> enabled;
+            auto collect = [&]() {
+                enabled = assumed;
+                for (const std::string &block : relaxed)
+                    if (best[block])
+                        enabled.insert(block);
+            };
+            collect();
+
+            for (const std::string &block : relaxed) {
+                if (enabled.size() >= round_bound)
+                    break;
+                if (enabled.count(block) > 0)
+                    continue;
+                // each configuration has to cover at least one block, whatever the budget
+                if (!enabled.empty() && std::chrono::steady_clock::now() >= deadline) {
+                    exhausted = true;
+                    break;
+                }
+                std::set<std::string> configuration(enabled);
+                configuration.insert(block);
+                if (sc(configuration)) {
+                    best = sc.getAssignment();
+                    collect();
+                } else if (enabled.empty()) {
+                    // dead block; just ignore it
+                    cover(indices.at(block));
+                }
+            }
+            if (enabled.empty())
+                continue;
+
+            for (const std::string &block : enabled)
+                cover(indices.at(block));
+            ret.push_back(best);
+            Logging::debug("configuration ", ret.size(), " covers ", enabled.size(),
+                           " new blocks, at most ", round_bound, " are possible");
+            covered_blocks += enabled.size();
+            bound += round_bound;
+            if (enabled.size() == round_bound)
+                optimal++;
+        }
+    } catch (CNFBuilderError &e) {
+        Logging::error("Couldn't process ", file->getFilename(), ": ", e.what());
+    } catch (std::bad_alloc &) {
+        Logging::error("Couldn't process ", file->getFilename(), ": Out of Memory.");
+    }
+    // each configuration is bounded given the blocks covered by the ones found before
+    Logging::info(file->getFilename(), ", Covered Blocks: ", covered_blocks, ", Bound: ", bound,
+                  ", Optimal Solutions: ", optimal, "/", ret.size(),
+                  exhausted ? ", Time Budget Exhausted" : "");
+    return ret;
+}
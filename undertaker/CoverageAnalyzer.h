@@ -72,4 +72,39 @@ public:
     explicit MinimizeCoverageAnalyzer(CppFile *f) : CoverageAnalyzer(f){};
     std::list<SatChecker::AssignmentMap> blockCoverage(ConfigurationModel *) final override;
 };
+
+/************************************************************************/
+/* MaxSatCoverageAnalyzer                                               */
+/************************************************************************/
+
+/**
+ * \brief Covers as many new blocks as possible with each configuration
+ *
+ * Each configuration is searched for by assuming all uncovered blocks
+ * at once. While this fails, the blocks in the conflict reported by the
+ * solver are relaxed (no longer assumed). As the conflicts are disjoint,
+ * at least one block of each one can't be covered, which bounds the
+ * number of blocks the configuration can cover. The relaxed blocks are
+ * then tried one by one on top of the blocks covered so far, until this
+ * bound is reached or the time budget is used up. Once it is used up,
+ * all uncovered blocks are relaxed without searching for conflicts.
+ */
+class MaxSatCoverageAnalyzer : public CoverageAnalyzer {
+public:
+    //! 'seconds' is the time budget for improving the configurations of one file
+    MaxSatCoverageAnalyzer(CppFile *f, unsigned int seconds)
+        : CoverageAnalyzer(f), seconds(seconds){};
+    std::list<SatChecker::AssignmentMap> blockCoverage(ConfigurationModel *) final override;
+
+    // NB: filled during blockCoverage run, summed up over all configurations
+    size_t getCovered() const { return covered_blocks; }
+    size_t getBound() const { return bound; }
+    size_t getOptimal() const { return optimal; }
+
+private:
+    unsigned int seconds;
+    size_t covered_blocks = 0;  // newly covered blocks
+    size_t bound = 0;           // proven upper bound of covered_blocks
+    size_t optimal = 0;         // configurations that reached their bound
+};
 #endif /* _COVERAGEANALYZER_H_ */
@@ -0,0 +1,291 @@
+/*
+ *   undertaker - snapshots of parsed files
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppFileSnapshot.h"
+#include "AnalysisIndex.h"
+#include "PumaConditionalBlock.h"
+#include "QueryCache.h"
+#include "Logging.h"
+#include "exceptions/IOException.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <unistd.h>
+#include <boost/filesystem.hpp>
+
+
+namespace {
+    // XXX do not modify without changing the tag, snapshots of other versions are ignored then
+    const std::string snapshotTag = "UCS1";
+
+    // expressions may contain any character but the separators of the fields
+    std::string escape(const std::string &str) {
+        std::string result;
+        for (char c : str)
+            if (c == '\\')
+                result += "\\\\";
+            else if (c == '\t')
+                result += "\\t";
+            else if (c == '\n')
+                result += "\\n";
+            else
+                result += c;
+        return result;
+    }
+
+    std::string unescape(const std::string &str) {
+        std::string result;
+        for (size_t i = 0; i < str.size(); i++)
+            if (str[i] == '\\' && i + 1 < str.size()) {
+                i++;
+                result += str[i] == 't' ? '\t' : str[i] == 'n' ? '\n' : str[i];
+            } else {
+                result += str[i];
+            }
+        return result;
+    }
+
+    std::vector<std::string> split(const std::string &str) {
+        std::vector<std::string> fields;
+        size_t start = 0, end;
+        while ((end = str.find('\t', start)) != std::string::npos) {
+            fields.push_back(str.substr(start, end - start));
+            start = end + 1;
+        }
+        fields.push_back(str.substr(start));
+        return fields;
+    }
+} // namespace
+
+/************************************************************************/
+/* SnapshotConditionalBlock                                             */
+/************************************************************************/
+
+SnapshotConditionalBlock::SnapshotConditionalBlock(CppFile *file, ConditionalBlock *parent,
+                                                   ConditionalBlock *prev, unsigned long number,
+                                                   int flags, const Location &location,
+                                                   const std::string &expression,
+                                                   const std::string &rewritten)
+        : ConditionalBlock(file, parent, prev), _number(number), _flags(flags),
+          _location(location), _expression(expression) {
+    // the rewriting of lateConstructor() depends on the defines seen so far
+    setIfdefExpression(rewritten);
+}
+
+const std::string SnapshotConditionalBlock::getName() const {
+    if (!_parent)
+        return "B00";  // top level block, represents file
+    std::string s("B");
+    s += std::to_string(_number);
+    if (useBlockWithFilename)
+        // get the normalized file variable without "FILE" prefix and append to the block name
+        s += &fileVar()[4];
+    return s;
+}
+
+SnapshotConditionalBlock *SnapshotConditionalBlock::createDummyElseBlock(ConditionalBlock *parent,
+                                                                         ConditionalBlock *prev) {
+    SnapshotConditionalBlock *top = static_cast<SnapshotConditionalBlock *>(cpp_file->topBlock());
+    return new SnapshotConditionalBlock(cpp_file, parent, prev, top->_nextNumber++, ELSE | DUMMY,
+                                        Location{0, 0, 0, 0}, "", "");
+}
+
+/************************************************************************/
+/* CppFileSnapshot                                                      */
+/************************************************************************/
+
+std::string CppFileSnapshot::_directory;
+
+void CppFileSnapshot::enable(const std::string &directory) {
+    boost::system::error_code error;
+    boost::filesystem::create_directories(directory, error);
+    if (!boost::filesystem::is_directory(directory))
+        throw kconfig::IOException("could not create the snapshot directory " + directory);
+    _directory = directory;
+}
+
+std::string CppFileSnapshot::snapshotFile(const std::string &filename, std::string &content) {
+    content = AnalysisIndex::contentHash(filename);
+    if (content.empty())
+        return "";
+    // relative #includes depend on the name of the file
+    std::string key = snapshotTag + "\t" + filename + "\t" + content;
+    for (const std::string &path : PumaConditionalBlockBuilder::getIncludePaths())
+        key += "\t" + path;
+    const QueryCache::Key hash = QueryCache::getInstance().key(nullptr, {QueryCache::hash(key)});
+    char name[34];
+    snprintf(name, sizeof(name), "%016" PRIx64 "%016" PRIx64, hash.hi, hash.lo);
+    return _directory + "/" + name;
+}
+
+ConditionalBlock *CppFileSnapshot::load(CppFile *file, const std::string &filename,
+                                        std::set<std::string> &includes) {
+    std::string content;
+    const std::string snapshot = snapshotFile(filename, content);
+    std::ifstream in(snapshot);
+    std::string line;
+    if (snapshot.empty() || !std::getline(in, line)
+        || line != snapshotTag + "\t" + escape(filename) + "\t" + content)
+        return nullptr;
+
+    std::vector<ConditionalBlock *> blocks;
+    std::vector<std::pair<size_t, std::string>> defines;  // block and (!)symbol
+    bool complete = false;
+    try {
+        while (!complete && std::getline(in, line)) {
+            const std::vector<std::string> fields = split(line);
+            if (fields[0] == "I" && fields.size() == 3) {
+                if (AnalysisIndex::contentHash(unescape(fields[2])) != fields[1]) {
+                    Logging::debug("the included file ", unescape(fields[2]), " changed");
+                    break;
+                }
+                includes.insert(unescape(fields[2]));
+            } else if (fields[0] == "U" && fields.size() == 3) {
+                const std::string includer = unescape(fields[2]);
+                if (!PumaConditionalBlockBuilder::locateInclude(
+                         unescape(fields[1]), includer.empty() ? nullptr : includer.c_str())
+                         .empty()) {
+                    Logging::debug("the include ", unescape(fields[1]), " resolves now");
+                    break;
+                }
+            } else if (fields[0] == "B" && fields.size() == 11) {
+                const size_t parent = std::stoul(fields[2]), prev = std::stoul(fields[3]);
+                // the top block has no parent, all others are preceded by their parent
+                if (blocks.empty() != (parent == 0) || parent > blocks.size()
+                    || prev > blocks.size())
+                    break;
+                SnapshotConditionalBlock::Location location{
+                    (unsigned int) std::stoul(fields[5]), (unsigned int) std::stoul(fields[6]),
+                    (unsigned int) std::stoul(fields[7]), (unsigned int) std::stoul(fields[8])};
+                ConditionalBlock *parentBlock = parent ? blocks[parent - 1] : nullptr;
+                auto block = new SnapshotConditionalBlock(
+                    file, parentBlock, prev ? blocks[prev - 1] : nullptr, std::stoul(fields[1]),
+                    std::stoi(fields[4]), location, unescape(fields[9]), unescape(fields[10]));
+                blocks.push_back(block);
+                if (parentBlock) {
+                    file->push_back(block);
+                    parentBlock->push_back(block);
+                }
+            } else if (fields[0] == "D" && fields.size() == 4) {
+                const size_t block = std::stoul(fields[1]);
+                if (block == 0 || block > blocks.size())
+                    break;
+                defines.emplace_back(block - 1, (fields[2] == "1" ? "" : "!") + fields[3]);
+            } else if (fields[0] == "E" && fields.size() == 2 && !blocks.empty()) {
+                static_cast<SnapshotConditionalBlock *>(blocks[0])->_nextNumber
+                    = std::stoul(fields[1]);
+                complete = true;
+            } else {
+                break;
+            }
+        }
+    } catch (std::logic_error &) {  // std::stoul() failed
+        complete = false;
+    }
+    if (!complete) {
+        Logging::debug("the snapshot of ", filename, " is outdated or corrupt");
+        // the caller parses the file, it must be empty then
+        file->clear();
+        includes.clear();
+        for (ConditionalBlock *block : blocks)
+            delete block;
+        return nullptr;
+    }
+
+    // the defines are replayed in the order of the file, like the builder creates them
+    CppFile::DefineMap &map = *file->getDefines();
+    for (const auto &entry : defines) {  // pair<size_t, string>
+        ConditionalBlock *block = blocks[entry.first];
+        const bool define = entry.second[0] != '!';
+        const std::string symbol = define ? entry.second : entry.second.substr(1);
+        auto i = map.find(symbol);
+        if (i == map.end())
+            map[symbol] = new CppDefine(block, define, symbol);
+        else
+            (*i).second->newDefine(block, define);
+        block->addDefine(map[symbol]);
+    }
+    Logging::debug("restored ", filename, " from its snapshot");
+    return blocks[0];
+}
+
+void CppFileSnapshot::store(CppFile *file, const std::string &filename,
+                            const std::set<std::string> &includes,
+                            const std::vector<UnresolvedInclude> &unresolved,
+                            const std::vector<Define> &defines) {
+    for (const UnresolvedInclude &include : unresolved) {
+        bool computed;
+        PumaConditionalBlockBuilder::locateInclude(include.directive, nullptr, &computed);
+        if (computed)
+            return;
+    }
+    std::string content;
+    const std::string snapshot = snapshotFile(filename, content);
+    if (snapshot.empty())
+        return;
+
+    std::ostringstream out;
+    out << snapshotTag << "\t" << escape(filename) << "\t" << content << "\n";
+    for (const std::string &include : includes)
+        out << "I\t" << AnalysisIndex::contentHash(include) << "\t" << escape(include) << "\n";
+    for (const UnresolvedInclude &include : unresolved)
+        out << "U\t" << escape(include.directive) << "\t" << escape(include.includer) << "\n";
+
+    // blocks are referred to by their position, counted from 1, 0 is none
+    std::map<const ConditionalBlock *, size_t> index{{nullptr, 0}};
+    unsigned long nextNumber = 0;
+    auto storeBlock = [&](const ConditionalBlock *block) {
+        index.emplace(block, index.size());
+        const int flags = (block->isIfBlock() ? SnapshotConditionalBlock::IF : 0)
+            | (block->isIfndefine() ? SnapshotConditionalBlock::IFNDEF : 0)
+            | (block->isElseIfBlock() ? SnapshotConditionalBlock::ELIF : 0)
+            | (block->isElseBlock() ? SnapshotConditionalBlock::ELSE : 0)
+            | (block->isDummyBlock() ? SnapshotConditionalBlock::DUMMY : 0);
+        const bool top = !block->getParent();
+        const unsigned long number = top ? 0 : block->getIndex() - 1;
+        nextNumber = std::max(nextNumber, number + 1);
+        out << "B\t" << number << "\t" << index.at(block->getParent()) << "\t"
+            << index.at(block->getPrev()) << "\t" << flags << "\t" << block->lineStart() << "\t"
+            << block->colStart() << "\t" << block->lineEnd() << "\t" << block->colEnd() << "\t"
+            << (top ? "" : escape(block->ExpressionStr())) << "\t"
+            << escape(block->ifdefExpression()) << "\n";
+    };
+    storeBlock(file->topBlock());
+    for (const ConditionalBlock *block : *file)
+        storeBlock(block);
+    for (const Define &define : defines)
+        out << "D\t" << index.at(define.block) << "\t" << define.define << "\t" << define.symbol
+            << "\n";
+    out << "E\t" << nextNumber << "\n";
+
+    // concurrent workers and threads may store the same snapshot, each one renames a complete file
+    static std::atomic<unsigned long> stored(0);
+    const std::string tmp
+        = snapshot + "." + std::to_string(getpid()) + "." + std::to_string(stored++) + ".tmp";
+    std::ofstream outfile(tmp, std::ios_base::trunc);
+    outfile << out.str();
+    outfile.close();
+    if (!outfile.good() || rename(tmp.c_str(), snapshot.c_str()) != 0) {
+        Logging::warn("could not store the snapshot of ", filename);
+        unlink(tmp.c_str());
+    }
+}
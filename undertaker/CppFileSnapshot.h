@@ -0,0 +1,144 @@
+/*
+ *   undertaker - snapshots of parsed files
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -*- mode: c++ -*-
+#ifndef cppfile_snapshot_h__
+#define cppfile_snapshot_h__
+
+#include "ConditionalBlock.h"
+
+#include <set>
+#include <string>
+#include <vector>
+
+
+/************************************************************************/
+/* SnapshotConditionalBlock                                             */
+/************************************************************************/
+
+//! a block restored from a snapshot, it has no Puma tokens
+class SnapshotConditionalBlock : public ConditionalBlock {
+public:
+    enum Flags { IF = 1, IFNDEF = 2, ELIF = 4, ELSE = 8, DUMMY = 16 };
+    struct Location {
+        unsigned int lineStart, colStart, lineEnd, colEnd;
+    };
+
+    SnapshotConditionalBlock(CppFile *file, ConditionalBlock *parent, ConditionalBlock *prev,
+                             unsigned long number, int flags, const Location &location,
+                             const std::string &expression, const std::string &rewritten);
+
+    //! location related accessors
+    unsigned int lineStart()     const final override { return _location.lineStart; }
+    unsigned int colStart()      const final override { return _location.colStart; }
+    unsigned int lineEnd()       const final override { return _location.lineEnd; }
+    unsigned int colEnd()        const final override { return _location.colEnd; }
+    /// @}
+
+    //! \return original untouched expression
+    const char *ExpressionStr()  const final override { return _expression.c_str(); }
+    bool isIfBlock()             const final override { return _flags & IF; }
+    bool isIfndefine()           const final override { return _flags & IFNDEF; }
+    bool isElseIfBlock()         const final override { return _flags & ELIF; }
+    bool isElseBlock()           const final override { return _flags & ELSE; }
+    bool isDummyBlock()          const final override { return _flags & DUMMY; }
+    void setDummyBlock()               final override { _flags |= DUMMY; }
+    const std::string getName()  const final override;
+    unsigned long getIndex()     const final override { return _parent ? _number + 1 : 0; }
+
+    //! a new #else block for decision coverage, see ConditionalBlock::processForDecisionCoverage()
+    SnapshotConditionalBlock *createDummyElseBlock(ConditionalBlock *parent,
+                                                   ConditionalBlock *prev);
+
+private:
+    unsigned long _number;
+    int _flags;
+    Location _location;
+    std::string _expression;
+    // only used by the top block, the number of the next block of the file
+    unsigned long _nextNumber = 0;
+
+    friend class CppFileSnapshot;
+};
+
+
+/************************************************************************/
+/* CppFileSnapshot                                                      */
+/************************************************************************/
+
+/**
+ * \brief Snapshots of the blocks and defines of parsed files
+ *
+ * Parsing a file with Puma (resolving includes, the normalizations and
+ * macro expansion) is the most expensive part of many jobs, but only
+ * the block tree, the expressions, the defines and the line ranges are
+ * used afterwards. A snapshot keeps exactly this data. It is stored in
+ * a directory under a key built from the name and the content of the
+ * file and from the include paths, and it is only used as long as all
+ * files that were included while parsing are unchanged and no #include
+ * that wasn't found then can be resolved now.
+ *
+ * Files restored from snapshots have no Puma tokens, so they can't be
+ * used to print commented sources (see SatChecker::AssignmentMap).
+ */
+class CppFileSnapshot {
+public:
+    //! a #define or #undef, in the order of the file
+    struct Define {
+        ConditionalBlock *block;
+        bool define;
+        std::string symbol;
+    };
+    //! an #include directive whose file wasn't found
+    struct UnresolvedInclude {
+        std::string directive;  // the text after #include
+        std::string includer;   // the file containing it, where "file.h" is looked up first
+    };
+
+    /**
+     * Stores snapshots in 'directory' and uses them, the directory is created if needed.
+     * @throws kconfig::IOException if 'directory' can't be created
+     */
+    static void enable(const std::string &directory);
+    static bool isEnabled() { return !_directory.empty(); }
+
+    /**
+     * Restores the blocks and defines of 'filename' into 'file', and the
+     * files it included into 'includes'.
+     * \return the top block, nullptr if there is no valid snapshot
+     */
+    static ConditionalBlock *load(CppFile *file, const std::string &filename,
+                                  std::set<std::string> &includes);
+
+    /**
+     * Stores the snapshot of the just parsed 'file', which included
+     * 'includes' and failed to include 'unresolved'. Files with computed
+     * includes that weren't found get no snapshot, as it can't be told
+     * when they would resolve.
+     */
+    static void store(CppFile *file, const std::string &filename,
+                      const std::set<std::string> &includes,
+                      const std::vector<UnresolvedInclude> &unresolved,
+                      const std::vector<Define> &defines);
+
+private:
+    //! the name of the snapshot of 'filename', empty if 'filename' can't be read
+    static std::string snapshotFile(const std::string &filename, std::string &content);
+
+    static std::string _directory;
+};
+#endif
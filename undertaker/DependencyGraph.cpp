@@ -0,0 +1,153 @@
+/*
+ *   undertaker - item dependency graph of rsf models
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DependencyGraph.h"
+#include "RsfReader.h"
+#include "bool.h"
+
+#include <algorithm>
+
+
+DependencyGraph::DependencyGraph(const RsfReader &model) {
+    std::vector<std::vector<int>> edges;
+    for (const auto &entry : model) {  // pair<string, string>
+        const int from = node(entry.first);
+        if (entry.second.empty())
+            continue;
+        std::vector<int> dependencies;
+        for (const std::string &item : kconfig::BoolExp::symbolsOfString(entry.second))
+            dependencies.push_back(node(item));
+        edges.resize(names.size());
+        edges[from] = std::move(dependencies);
+    }
+    edges.resize(names.size());
+    condense(edges);
+}
+
+int DependencyGraph::node(const std::string &name) {
+    const auto it = ids.emplace(name, names.size());
+    if (it.second)
+        names.push_back(name);
+    return it.first->second;
+}
+
+void DependencyGraph::condense(const std::vector<std::vector<int>> &edges) {
+    // iterative Tarjan, dependency chains of large models are too deep for recursion
+    const int n = names.size();
+    std::vector<int> index(n, -1), lowlink(n), stack;
+    std::vector<bool> onStack(n, false);
+    std::vector<std::pair<int, size_t>> work;  // item, next edge
+    int counter = 0;
+
+    component.assign(n, -1);
+    auto visit = [&](int v) {
+        index[v] = lowlink[v] = counter++;
+        stack.push_back(v);
+        onStack[v] = true;
+        work.emplace_back(v, 0);
+    };
+    for (int root = 0; root < n; root++) {
+        if (index[root] != -1)
+            continue;
+        visit(root);
+        while (!work.empty()) {
+            const int v = work.back().first;
+            if (work.back().second < edges[v].size()) {
+                const int w = edges[v][work.back().second++];
+                if (index[w] == -1)
+                    visit(w);
+                else if (onStack[w])
+                    lowlink[v] = std::min(lowlink[v], index[w]);
+                continue;
+            }
+            work.pop_back();
+            if (!work.empty()) {
+                const int u = work.back().first;
+                lowlink[u] = std::min(lowlink[u], lowlink[v]);
+            }
+            if (lowlink[v] != index[v])
+                continue;
+            const int c = members.size();
+            members.emplace_back();
+            int w;
+            do {
+                w = stack.back();
+                stack.pop_back();
+                onStack[w] = false;
+                component[w] = c;
+                members[c].push_back(w);
+            } while (w != v);
+        }
+    }
+
+    successors.resize(members.size());
+    for (int v = 0; v < n; v++)
+        for (int w : edges[v])
+            if (component[v] != component[w])
+                successors[component[v]].push_back(component[w]);
+    for (std::vector<int> &succ : successors) {
+        std::sort(succ.begin(), succ.end());
+        succ.erase(std::unique(succ.begin(), succ.end()), succ.end());
+    }
+}
+
+const boost::dynamic_bitset<> &DependencyGraph::closure(int c) const {
+    boost::dynamic_bitset<> reached(members.size());
+    {
+        boost::shared_lock<boost::shared_mutex> guard(closures_lock);
+        const auto it = closures.find(c);
+        if (it != closures.end())
+            return it->second;
+
+        // A component is only marked if its closure is already contained
+        // or if it is about to be explored, so marked ones are skipped.
+        std::vector<int> stack{c};
+        reached.set(c);
+        while (!stack.empty()) {
+            const int top = stack.back();
+            stack.pop_back();
+            for (int succ : successors[top]) {
+                if (reached[succ])
+                    continue;
+                const auto cached = closures.find(succ);
+                if (cached != closures.end()) {
+                    reached |= cached->second;
+                    continue;
+                }
+                reached.set(succ);
+                stack.push_back(succ);
+            }
+        }
+    }
+    boost::unique_lock<boost::shared_mutex> guard(closures_lock);
+    return closures.emplace(c, std::move(reached)).first->second;
+}
+
+void DependencyGraph::extend(std::set<std::string> &items) const {
+    boost::dynamic_bitset<> reached(members.size());
+    for (const std::string &item : items) {
+        const auto it = ids.find(item);
+        if (it == ids.end())
+            continue;
+        const int c = component[it->second];
+        if (!reached[c])
+            reached |= closure(c);
+    }
+    for (size_t c = reached.find_first(); c != reached.npos; c = reached.find_next(c))
+        for (int v : members[c])
+            items.insert(names[v]);
+}
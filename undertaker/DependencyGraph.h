@@ -0,0 +1,67 @@
+/*
+ *   undertaker - item dependency graph of rsf models
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -*- mode: c++ -*-
+#ifndef dependency_graph_h__
+#define dependency_graph_h__
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <boost/dynamic_bitset.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
+class RsfReader;
+
+
+/**
+ * \brief Integer graph of the items referenced by the formulas of a model
+ *
+ * Each item of the model has an edge to every item in its formula. The
+ * graph is condensed into its strongly connected components, so that
+ * items depending on each other share a single node. The transitive
+ * closures of the components are bitsets over the components. The
+ * closure of each queried component is cached and reused by all later
+ * queries that reach it.
+ */
+class DependencyGraph {
+    std::vector<std::string> names;            // item -> name
+    std::unordered_map<std::string, int> ids;  // name -> item
+    std::vector<int> component;                // item -> component
+    std::vector<std::vector<int>> members;     // component -> items
+    std::vector<std::vector<int>> successors;  // component -> components
+
+    mutable std::unordered_map<int, boost::dynamic_bitset<>> closures;
+    mutable boost::shared_mutex closures_lock;
+
+    int node(const std::string &name);
+    void condense(const std::vector<std::vector<int>> &edges);
+    const boost::dynamic_bitset<> &closure(int c) const;
+
+public:
+    //! compiles the formulas of 'model'
+    explicit DependencyGraph(const RsfReader &model);
+
+    //! adds every item that the items in 'items' (transitively) depend on
+    void extend(std::set<std::string> &items) const;
+
+    //! number of items and of strongly connected components
+    size_t size() const { return names.size(); }
+    size_t components() const { return members.size(); }
+};
+#endif
@@ -24,10 +24,17 @@
 #include "KconfigWhitelist.h"
 
 #include <fstream>
-#include <algorithm>
 
 bool KconfigWhitelist::isWhitelisted(const std::string &item) const {
-    return std::find(begin(), end(), item) != end();
+    if (empty())
+        return false;
+    SymbolId id = SymbolTable::lookup(item);
+    return id && items.contains(id);
+}
+
+void KconfigWhitelist::addItem(const std::string &item) {
+    if (items.insert(SymbolTable::intern(item)))
+        emplace_back(item);
 }
 
 KconfigWhitelist &KconfigWhitelist::getIgnorelist() {
@@ -58,8 +65,7 @@ int KconfigWhitelist::loadWhitelist(const char *file) {
         if (line[0] == '#')
             continue;
 
-        if (!isWhitelisted(line))
-            emplace_back(line);
+        addItem(line);
     }
     return size() - n;
 }
@@ -25,6 +25,8 @@
 #ifndef kconfigwhitelist_h__
 #define kconfigwhitelist_h__
 
+#include "SymbolTable.h"
+
 #include <vector>
 #include <string>
 
@@ -39,12 +41,15 @@
  */
 class KconfigWhitelist : public std::vector<std::string> {
     KconfigWhitelist() = default;      //!< private c'tor
+    SymbolSet items;                   //!< the same items, for fast lookups
 public:
     static KconfigWhitelist &getIgnorelist();  //!< ignorelist
     static KconfigWhitelist &getWhitelist();   //!< whitelist
     static KconfigWhitelist &getBlacklist();   //!< blacklist
     //!< checks if the given item is in the whitelist
     bool isWhitelisted(const std::string &s) const;
+    //!< adds an item to the list unless it's already in there
+    void addItem(const std::string &s);
     /**
      * \brief load Kconfig Items from a textfile into the whitelist
      * \param file the filename to load items from
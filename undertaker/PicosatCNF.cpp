@@ -24,8 +24,19 @@
 #include "exceptions/IOException.h"
 #include "Logging.h"
 
+#include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <numeric>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace Picosat {
 // include picosat header as C
@@ -36,20 +47,145 @@ namespace Picosat {
 
 using namespace kconfig;
 
+static const char binary_magic[8] = {'U', 'N', 'D', 'C', 'N', 'F', '\n', '\0'};
+static const uint32_t binary_version = 1;
+static const uint32_t binary_byte_order = 0x01020304;
+
+struct PicosatCNF::Image {
+    struct Header {
+        char magic[8];
+        uint32_t version, byte_order;
+        int32_t varcount, clausecount;
+        // number of entries of each section
+        uint32_t literals, vars, syms, metas, strings;
+    };
+    //! 'name' is an offset into the string table
+    struct Entry {
+        uint32_t name;
+        int32_t value;
+    };
+
+    void *data = MAP_FAILED;
+    size_t length = 0;
+    const Header *header = nullptr;
+    const int32_t *literals = nullptr;
+    const Entry *vars = nullptr;
+    const uint32_t *var_by_id = nullptr;  // indices into 'vars'
+    const Entry *syms = nullptr;
+    const Entry *metas = nullptr;
+    const char *strings = nullptr;
+
+    explicit Image(const std::string &filename);
+    ~Image() {
+        if (data != MAP_FAILED)
+            munmap(data, length);
+    }
+    const char *str(uint32_t offset) const { return strings + offset; }
 
-static bool picosatIsInitalized = false;
-static PicosatCNF *currentContext = nullptr;
+    //! binary search in 'table' (sorted by name), returns nullptr if 'name' is not found
+    const Entry *find(const Entry *table, uint32_t n, const std::string &name) const {
+        const Entry *it = std::lower_bound(table, table + n, name,
+            [this](const Entry &e, const std::string &key) { return key.compare(str(e.name)) > 0; });
+        return (it != table + n && name == str(it->name)) ? it : nullptr;
+    }
+    const Entry *findVar(int cnfvar) const {
+        const uint32_t *it = std::lower_bound(var_by_id, var_by_id + header->vars, cnfvar,
+            [this](uint32_t i, int key) { return vars[i].value < key; });
+        return (it != var_by_id + header->vars && vars[*it].value == cnfvar) ? &vars[*it]
+                                                                             : nullptr;
+    }
+};
+
+PicosatCNF::Image::Image(const std::string &filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0)
+            close(fd);
+        throw IOException("Could not open CNF-File");
+    }
+    length = st.st_size;
+    if (length >= sizeof(Header))
+        data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        throw IOException("Could not map CNF-File");
+
+    // the destructor doesn't run if the constructor throws
+    auto reject = [this](const std::string &reason) {
+        munmap(data, length);
+        data = MAP_FAILED;
+        throw IOException(reason);
+    };
+    header = static_cast<const Header *>(data);
+    if (memcmp(header->magic, binary_magic, sizeof(binary_magic)) != 0)
+        reject("not a binary CNF file");
+    if (header->version != binary_version || header->byte_order != binary_byte_order)
+        reject("unsupported version or byte order of binary CNF file");
+
+    // the sections follow the header in this order, see PicosatCNF::toBinaryStream
+    size_t expected = sizeof(Header) + header->literals * sizeof(int32_t)
+                      + header->vars * (sizeof(Entry) + sizeof(uint32_t))
+                      + (header->syms + header->metas) * sizeof(Entry) + header->strings;
+    if (expected != length || (header->strings > 0 && ((const char *)data)[length - 1] != '\0'))
+        reject("truncated or corrupt binary CNF file");
+
+    literals = reinterpret_cast<const int32_t *>(header + 1);
+    vars = reinterpret_cast<const Entry *>(literals + header->literals);
+    var_by_id = reinterpret_cast<const uint32_t *>(vars + header->vars);
+    syms = reinterpret_cast<const Entry *>(var_by_id + header->vars);
+    metas = syms + header->syms;
+    strings = reinterpret_cast<const char *>(metas + header->metas);
+
+    // everything is used without further checks, so nothing may point out of the mapping
+    if (header->varcount < 0 || header->clausecount < 0)
+        reject("corrupt header in binary CNF file");
+    if (header->literals > 0 && literals[header->literals - 1] != 0)
+        reject("unterminated clause in binary CNF file");
+    // solvers and Formula are sized by varcount and index them with abs(literal)
+    const int32_t varcount = header->varcount;
+    for (uint32_t i = 0; i < header->literals; i++)
+        if (literals[i] < -varcount || literals[i] > varcount)
+            reject("corrupt literal in binary CNF file");
+    for (uint32_t i = 0; i < header->vars; i++)
+        if (vars[i].name >= header->strings || var_by_id[i] >= header->vars
+            || vars[i].value < -varcount || vars[i].value > varcount)
+            reject("corrupt variable table in binary CNF file");
+    for (uint32_t i = 0; i < header->syms; i++)
+        if (syms[i].name >= header->strings)
+            reject("corrupt symbol table in binary CNF file");
+    for (uint32_t i = 0; i < header->metas; i++)
+        if (metas[i].name >= header->strings || (uint32_t) metas[i].value >= header->strings)
+            reject("corrupt meta information in binary CNF file");
+}
 
-PicosatCNF::PicosatCNF(Picosat::SATMode defaultPhase) : defaultPhase(defaultPhase) {}
+static uint64_t nextSerial() {
+    static std::atomic<uint64_t> serials(0);
+    return ++serials;
+}
+
+PicosatCNF::PicosatCNF(Picosat::SATMode defaultPhase)
+    : serial(nextSerial()), defaultPhase(defaultPhase) {}
+
+// the solver instance is not shared, the copy creates its own on first use
+PicosatCNF::PicosatCNF(const PicosatCNF &cnf)
+    : base(cnf.base), image(cnf.image), clauses(cnf.clauses), assumptions(cnf.assumptions),
+      serial(nextSerial()),
+      symboltypes(cnf.symboltypes), cnfvars(cnf.cnfvars), associatedSymbols(cnf.associatedSymbols), boolvars(cnf.boolvars),
+      meta_information(cnf.meta_information), defaultPhase(cnf.defaultPhase),
+      varcount(cnf.varcount), clausecount(cnf.clausecount) {}
 
 // copy delegate constructor with initializing _picosat and setting default_phase
 PicosatCNF::PicosatCNF(const PicosatCNF &cnf, Picosat::SATMode defaultPhase) : PicosatCNF(cnf) {
     this->defaultPhase = defaultPhase;
 }
 
+PicosatCNF::PicosatCNF(const PicosatCNF *base, Picosat::SATMode defaultPhase)
+    : base(base), serial(nextSerial()), defaultPhase(defaultPhase),
+      varcount(base->getVarCount()) {}
+
 PicosatCNF::~PicosatCNF() {
-    if (this == currentContext)
-        currentContext = nullptr;
+    resetSolver();
 }
 
 void PicosatCNF::readFromFile(const std::string &filename) {
@@ -57,10 +193,39 @@ void PicosatCNF::readFromFile(const std::string &filename) {
     if (!i.good()) {
         throw IOException("Could not open CNF-File");
     }
-    readFromStream(i);
+    char magic[sizeof(binary_magic)];
+    if (!i.read(magic, sizeof(magic)) || memcmp(magic, binary_magic, sizeof(magic)) != 0) {
+        // text format
+        i.clear();
+        i.seekg(0);
+        readFromStream(i);
+        return;
+    }
+    i.close();
+    if (image || varcount > 0 || !clauses.empty())
+        throw IOException("binary CNF files can only be read into an empty formula");
+    image = std::make_shared<const Image>(filename);
+    varcount = image->header->varcount;
+    clausecount = image->header->clausecount;
+    // meta information is small and may be extended, so it is copied
+    for (uint32_t m = 0; m < image->header->metas; m++)
+        addMetaValue(image->str(image->metas[m].name), image->str(image->metas[m].value));
+}
+
+void PicosatCNF::materialize() {
+    if (!image)
+        return;
+    std::shared_ptr<const Image> img;
+    img.swap(image);
+    for (uint32_t v = 0; v < img->header->vars; v++)
+        setCNFVar_fast(img->str(img->vars[v].name), img->vars[v].value);
+    for (uint32_t t = 0; t < img->header->syms; t++)
+        setSymbolType(img->str(img->syms[t].name), (kconfig_symbol_type) img->syms[t].value);
+    clauses.assign(img->literals, img->literals + img->header->literals);
 }
 
 void PicosatCNF::readFromStream(std::istream &i) {
+    materialize();
     std::string tmp;
     while (i >> tmp) {
         if (tmp == "c") {
@@ -109,13 +274,16 @@ void PicosatCNF::readFromStream(std::istream &i) {
     }
 }
 
-void PicosatCNF::toFile(const std::string &filename) const {
-    std::ofstream out(filename);
+void PicosatCNF::toFile(const std::string &filename, bool binary) const {
+    std::ofstream out(filename, binary ? std::ios::binary : std::ios::out);
     if (!out.good()) {
         Logging::error("Couldn't write to ", filename);
         return;
     }
-    toStream(out);
+    if (binary)
+        toBinaryStream(out);
+    else
+        toStream(out);
 }
 
 // XXX do not modify the output format without adjusting: readFromStream
@@ -139,28 +307,75 @@ void PicosatCNF::toStream(std::ostream &out) const {
 
         out << sj.str() << std::endl;
     }
-    for (const auto &entry : this->symboltypes) {  // pair<string, kconfig_symbol_type>
-        const std::string &sym = entry.first;
-        int type = entry.second;
+    forEachSymbolType([&out](const std::string &sym, int type) {
         out << "c sym " << sym << " " << type << std::endl;
-    }
-    for (const auto &entry : this->cnfvars) {  // pair<string, int>
-        const std::string &sym = entry.first;
-        int var = entry.second;
+    });
+    forEachSymbol([&out](const std::string &sym, int var) {
         out << "c var " << sym << " " << var << std::endl;
-    }
+    });
     out << "p cnf " << varcount << " " << this->clausecount << std::endl;
 
-    for (const int &clause : clauses) {
+    for (const int &clause : getClauses()) {
         char sep = (clause == 0) ? '\n' : ' ';
         out << clause << sep;
     }
 }
 
+// XXX do not modify the output format without adjusting: Image and binary_version
+void PicosatCNF::toBinaryStream(std::ostream &out) const {
+    std::string strings;
+    std::map<std::string, uint32_t> offsets;
+    auto offset = [&](const std::string &str) {
+        auto it = offsets.emplace(str, strings.size());
+        if (it.second)
+            strings.append(str.c_str(), str.size() + 1);
+        return it.first->second;
+    };
+    std::vector<Image::Entry> vars, syms, metas;
+    forEachSymbol([&](const std::string &sym, int var) {
+        vars.push_back({offset(sym), var});
+    });
+    forEachSymbolType([&](const std::string &sym, kconfig_symbol_type type) {
+        syms.push_back({offset(sym), type});
+    });
+    for (const auto &entry : meta_information)  // pair<string, deque<string>>
+        for (const std::string &value : entry.second)
+            metas.push_back({offset(entry.first), (int32_t) offset(value)});
+
+    std::vector<uint32_t> var_by_id(vars.size());
+    for (uint32_t i = 0; i < var_by_id.size(); i++)
+        var_by_id[i] = i;
+    std::sort(var_by_id.begin(), var_by_id.end(),
+              [&vars](uint32_t a, uint32_t b) { return vars[a].value < vars[b].value; });
+
+    const LiteralRange literals = getClauses();
+    Image::Header header;
+    memcpy(header.magic, binary_magic, sizeof(binary_magic));
+    header.version = binary_version;
+    header.byte_order = binary_byte_order;
+    header.varcount = varcount;
+    header.clausecount = clausecount;
+    header.literals = literals.size();
+    header.vars = vars.size();
+    header.syms = syms.size();
+    header.metas = metas.size();
+    header.strings = strings.size();
+
+    out.write((const char *) &header, sizeof(header));
+    out.write((const char *) literals.begin(), literals.size() * sizeof(int32_t));
+    out.write((const char *) vars.data(), vars.size() * sizeof(Image::Entry));
+    out.write((const char *) var_by_id.data(), var_by_id.size() * sizeof(uint32_t));
+    out.write((const char *) syms.data(), syms.size() * sizeof(Image::Entry));
+    out.write((const char *) metas.data(), metas.size() * sizeof(Image::Entry));
+    out.write(strings.data(), strings.size());
+}
+
 // this method transfers the the state from other to 'this'
 void PicosatCNF::incrementWith(const PicosatCNF &other) {
-    for (const auto &entry : other.getSymbolTypes())  // pair<string, kconfig_symbol_type>
-        setSymbolType(entry.first, entry.second);
+    materialize();
+    other.forEachSymbolType([this](const std::string &sym, kconfig_symbol_type type) {
+        setSymbolType(sym, type);
+    });
 
     for (const auto &entry : other.getMetaInformation())  // pair<string, deque<string>>
         for (const std::string &item : entry.second)
@@ -174,23 +389,23 @@ void PicosatCNF::incrementWith(const PicosatCNF &other) {
     // if 'other' has fewer variables than the current cnf-object, we have to take the maximum
     int counter = std::max(other.getVarCount(), varcount);
     const int oldvarcount = varcount;
-    for (const auto &entry : other.getSymbolMap()) {  // pair<string, int>
-        int cnfvar = getCNFVar(entry.first);
+    other.forEachSymbol([&](const std::string &sym, int var) {
+        int cnfvar = getCNFVar(sym);
         if (cnfvar) {
-            // if 'this' already has the symbol 'entry.first' we need to replace the variable-id
+            // if 'this' already has the symbol 'sym' we need to replace the variable-id
             // from 'other' with the id from 'this'
-            inferenced.emplace(entry.second, cnfvar);
-            inferenced.emplace(-entry.second, -cnfvar);
-        } else if (entry.second <= oldvarcount) {
-            // if the variable from entry wasn't already mentioned but the id is smaller than
+            inferenced.emplace(var, cnfvar);
+            inferenced.emplace(-var, -cnfvar);
+        } else if (var <= oldvarcount) {
+            // if the variable 'sym' wasn't already mentioned but the id is smaller than
             // varcount, we have to give it a new id to avoid conflicts
-            setCNFVar_fast(entry.first, ++counter);
-            inferenced.emplace(entry.second, counter);
-            inferenced.emplace(-entry.second, -counter);
+            setCNFVar_fast(sym, ++counter);
+            inferenced.emplace(var, counter);
+            inferenced.emplace(-var, -counter);
         } else {
-            setCNFVar_fast(entry.first, entry.second);
+            setCNFVar_fast(sym, var);
         }
-    }
+    });
     // there are variables in the model which don't have symbols but to avoid conflicts, they need
     // a new variable
     for (int i = 1; i <= oldvarcount; i++)
@@ -223,44 +438,154 @@ void PicosatCNF::incrementWith(const PicosatCNF &other) {
     }
 }
 
+void PicosatCNF::setBase(const PicosatCNF *newBase) {
+    assert(!base);
+    materialize();
+    // own variable i becomes renamed[i], named ones may already exist in the base
+    std::vector<int> renamed(varcount + 1);
+    for (int i = 1; i <= varcount; i++)
+        renamed[i] = newBase->getVarCount() + i;
+
+    SymbolMap<int> ownvars;
+    boolvars.clear();
+    cnfvars.forEach([&](SymbolId sym, int oldvar) {
+        int basevar = newBase->getCNFVar(SymbolTable::name(sym));
+        if (basevar) {
+            renamed[abs(oldvar)] = oldvar < 0 ? -basevar : basevar;
+        } else {
+            int var = oldvar < 0 ? -renamed[-oldvar] : renamed[oldvar];
+            ownvars[sym] = var;
+            if (var > 0) {
+                if ((size_t) var >= boolvars.size())
+                    boolvars.resize(var + 1, 0);
+                boolvars[var] = sym;
+            }
+        }
+    });
+    cnfvars.swap(ownvars);
+
+    auto rename = [&renamed](int &v) { v = v < 0 ? -renamed[-v] : renamed[v]; };
+    for (int &v : clauses)
+        rename(v);
+    for (int &v : assumptions)
+        rename(v);
+    varcount += newBase->getVarCount();
+    base = newBase;
+
+    // the solver only knows the old numbering
+    resetSolver();
+}
+
 kconfig_symbol_type PicosatCNF::getSymbolType(const std::string &name) const {
-    const auto &it = this->symboltypes.find(name); // pair<string, kconfig_symbol_type>
-    return (it == this->symboltypes.end()) ? K_S_UNKNOWN : it->second;
+    if (image) {
+        if (const Image::Entry *e = image->find(image->syms, image->header->syms, name))
+            return (kconfig_symbol_type) e->value;
+    } else if (SymbolId id = SymbolTable::lookup(name)) {
+        if (const kconfig_symbol_type *type = this->symboltypes.find(id))
+            return *type;
+    }
+    return base ? base->getSymbolType(name) : K_S_UNKNOWN;
+}
+
+void PicosatCNF::forEachSymbolType(
+    const std::function<void(const std::string &, kconfig_symbol_type)> &f) const {
+    if (image) {
+        for (uint32_t t = 0; t < image->header->syms; t++)
+            f(image->str(image->syms[t].name), (kconfig_symbol_type) image->syms[t].value);
+        return;
+    }
+    std::vector<std::pair<const std::string *, kconfig_symbol_type>> sorted;
+    sorted.reserve(symboltypes.size());
+    symboltypes.forEach([&sorted](SymbolId sym, kconfig_symbol_type type) {
+        sorted.emplace_back(&SymbolTable::name(sym), type);
+    });
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<const std::string *, kconfig_symbol_type> &a,
+                 const std::pair<const std::string *, kconfig_symbol_type> &b) {
+                  return *a.first < *b.first;
+              });
+    for (const auto &entry : sorted)  // pair<const string *, kconfig_symbol_type>
+        f(*entry.first, entry.second);
 }
 
 void PicosatCNF::setSymbolType(const std::string &sym, kconfig_symbol_type type) {
+    materialize();
+    SymbolId id = SymbolTable::intern(sym);
     std::string config_sym = "CONFIG_" + sym;
-    this->associatedSymbols[config_sym] = sym;
+    this->associatedSymbols[SymbolTable::intern(config_sym)] = id;
 
     if (type == K_S_TRISTATE) {
         std::string config_sym_mod = "CONFIG_" + sym + "_MODULE";
-        this->associatedSymbols[config_sym_mod] = sym;
+        this->associatedSymbols[SymbolTable::intern(config_sym_mod)] = id;
     }
-    this->symboltypes[sym] = type;
+    this->symboltypes[id] = type;
 }
 
 int PicosatCNF::getCNFVar(const std::string &var) const {
-    const auto &it = this->cnfvars.find(var); // pair<string, int>
-    return (it == this->cnfvars.end()) ? 0 : it->second;
+    if (image) {
+        if (const Image::Entry *e = image->find(image->vars, image->header->vars, var))
+            return e->value;
+    } else if (SymbolId id = SymbolTable::lookup(var)) {
+        if (const int *cnfvar = this->cnfvars.find(id))
+            return *cnfvar;
+    }
+    return base ? base->getCNFVar(var) : 0;
+}
+
+void PicosatCNF::forEachSymbol(const std::function<void(const std::string &, int)> &f) const {
+    if (image) {
+        for (uint32_t v = 0; v < image->header->vars; v++)
+            f(image->str(image->vars[v].name), image->vars[v].value);
+        return;
+    }
+    std::vector<std::pair<const std::string *, int>> sorted;
+    sorted.reserve(cnfvars.size());
+    cnfvars.forEach([&sorted](SymbolId sym, int var) {
+        sorted.emplace_back(&SymbolTable::name(sym), var);
+    });
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<const std::string *, int> &a,
+                 const std::pair<const std::string *, int> &b) { return *a.first < *b.first; });
+    for (const auto &entry : sorted)  // pair<const string *, int>
+        f(*entry.first, entry.second);
+}
+
+PicosatCNF::LiteralRange PicosatCNF::getClauses() const {
+    if (image)
+        return {image->literals, image->literals + image->header->literals};
+    return {clauses.data(), clauses.data() + clauses.size()};
 }
 
 void PicosatCNF::setCNFVar(const std::string &var, int CNFVar) {
+    materialize();
     if (abs(CNFVar) > this->varcount)
         this->varcount = abs(CNFVar);
     setCNFVar_fast(var, CNFVar);
 }
 
 void PicosatCNF::setCNFVar_fast(const std::string &var, int CNFVar) {
-    this->cnfvars[var] = CNFVar;
-    this->boolvars[CNFVar] = var;
+    SymbolId id = SymbolTable::intern(var);
+    this->cnfvars[id] = CNFVar;
+    // only positive cnf-ids have names
+    if (CNFVar > 0) {
+        if ((size_t) CNFVar >= boolvars.size())
+            boolvars.resize(std::max((size_t) CNFVar + 1, 2 * boolvars.size()), 0);
+        this->boolvars[CNFVar] = id;
+    }
 }
 
 const std::string PicosatCNF::getSymbolName(int CNFVar) const {
-    const auto &it = this->boolvars.find(CNFVar);
-    return it == this->boolvars.end() ? "" : it->second;
+    if (image) {
+        if (const Image::Entry *e = image->findVar(CNFVar))
+            return image->str(e->name);
+    } else if (CNFVar > 0 && (size_t) CNFVar < boolvars.size() && boolvars[CNFVar]) {
+        return SymbolTable::name(boolvars[CNFVar]);
+    }
+    return base ? base->getSymbolName(CNFVar) : "";
 }
 
 void PicosatCNF::pushVar(int v) {
+    materialize();
     if (abs(v) > this->varcount)
         this->varcount = abs(v);
     if (v == 0)
@@ -275,6 +600,7 @@ void PicosatCNF::pushVar(std::string &v, bool val) {
 }
 
 void PicosatCNF::pushClause() {
+    materialize();
     this->clausecount++;
     clauses.emplace_back(0);
 }
@@ -304,32 +630,282 @@ void PicosatCNF::pushAssumption(const std::string &v, bool val) {
         this->pushAssumption(-cnfvar);
 }
 
+struct PicosatCNF::Cones {
+    //! slicing is only sound if the formula is satisfiable on its own
+    bool satisfiable;
+    //! the cone of each variable, -1 if it is in no clause
+    std::vector<int> cone;
+    //! the offsets of the clauses of each cone in getClauses()
+    std::vector<std::vector<unsigned int>> clauses;
+};
+
+const PicosatCNF::Cones &PicosatCNF::getCones() const {
+    std::call_once(cones_once, [this]() {
+        auto c = std::make_shared<Cones>();
+        {
+            PicosatCNF whole(this, Picosat::SAT_MIN);
+            c->satisfiable = whole.checkSatisfiable();
+        }
+        const LiteralRange lits = getClauses();
+        int maxvar = varcount;
+        for (const int &lit : lits)
+            maxvar = std::max(maxvar, abs(lit));
+
+        // union-find, all variables of a clause are joined with its first one
+        std::vector<int> parent(maxvar + 1);
+        std::iota(parent.begin(), parent.end(), 0);
+        auto find = [&parent](int v) {
+            while (parent[v] != v)
+                v = parent[v] = parent[parent[v]];
+            return v;
+        };
+        int first = 0;
+        for (const int &lit : lits) {
+            if (lit == 0) {
+                first = 0;
+                continue;
+            }
+            const int root = find(abs(lit));
+            if (!first)
+                first = root;
+            else if (root != find(first))
+                parent[root] = find(first);
+        }
+
+        std::vector<int> coneOfRoot(maxvar + 1, -1);
+        bool start = true;
+        for (const int *lit = lits.begin(); lit != lits.end(); lit++) {
+            if (start && *lit != 0) {
+                int &cone = coneOfRoot[find(abs(*lit))];
+                if (cone < 0) {
+                    cone = c->clauses.size();
+                    c->clauses.emplace_back();
+                }
+                c->clauses[cone].push_back(lit - lits.begin());
+            }
+            start = *lit == 0;
+        }
+        c->cone.resize(maxvar + 1);
+        for (int v = 0; v <= maxvar; v++)
+            c->cone[v] = coneOfRoot[find(v)];
+        Logging::debug("CNF with ", getClauseCount(), " clauses has ", c->clauses.size(),
+                       " cones", c->satisfiable ? "" : ", but is unsatisfiable");
+        cones = c;
+    });
+    return *cones;
+}
+
+void PicosatCNF::setSliced(bool sliced, bool verify) {
+    this->sliced = sliced;
+    this->verifySlices = verify;
+    // the solver may already contain all clauses of the base
+    resetSolver();
+}
+
+struct PicosatCNF::SharedSolver {
+    Picosat::PicoSAT *solver = nullptr;
+    //! serial of the base, and its size to notice modifications
+    uint64_t base;
+    int baseVars, baseClauses;
+    //! true if only the active cones of the base were added
+    bool sliced;
+    std::vector<bool> activeCones;
+    //! solver variables above the ones of the base that no borrower uses
+    std::vector<int> freeVars;
+    //! number of borrowers so far, each one leaves its disabled clauses behind
+    unsigned int borrowers = 0;
+
+    ~SharedSolver() {
+        Picosat::picosat_select(solver);
+        Picosat::picosat_reset();
+    }
+
+    /**
+     * The solvers no formula borrowed at the moment, of all threads, the
+     * most recently returned one at the end. Job threads are short-lived,
+     * so the solvers must outlive them.
+     */
+    static std::vector<std::shared_ptr<SharedSolver>> idle;
+    static std::mutex lock;
+};
+
+std::vector<std::shared_ptr<PicosatCNF::SharedSolver>> PicosatCNF::SharedSolver::idle;
+std::mutex PicosatCNF::SharedSolver::lock;
+
+namespace {
+    //! shared solvers are replaced by fresh ones after that many borrowers
+    const unsigned int maxBorrowers = 1 << 14;
+    //! e.g., one per worker thread for the model and its sliced variant, and some of old bases
+    const size_t maxIdleSolvers = std::max(16u, 2 * std::thread::hardware_concurrency());
+} // namespace
+
+void PicosatCNF::borrowSolver(const Cones *c) {
+    {
+        std::lock_guard<std::mutex> guard(SharedSolver::lock);
+        std::vector<std::shared_ptr<SharedSolver>> &idle = SharedSolver::idle;
+        auto s = std::find_if(idle.rbegin(), idle.rend(),
+            [this, c](const std::shared_ptr<SharedSolver> &s) {
+                return s->base == base->serial && s->sliced == (c != nullptr);
+            });
+        if (s != idle.rend()) {
+            shared = *s;
+            idle.erase(std::next(s).base());
+        }
+    }
+    // dropping it resets the solver
+    if (shared && (shared->baseVars != base->getVarCount()
+                   || shared->baseClauses != base->getClauseCount()
+                   || shared->borrowers >= maxBorrowers))
+        shared.reset();
+
+    if (shared) {
+        Picosat::picosat_select(shared->solver);
+        // the phases saved for the previous borrower would bias the models of this one
+        Picosat::picosat_reset_phases();
+    } else {
+        shared = std::make_shared<SharedSolver>();
+        shared->base = base->serial;
+        shared->baseVars = base->getVarCount();
+        shared->baseClauses = base->getClauseCount();
+        shared->sliced = c != nullptr;
+        shared->solver = Picosat::picosat_init();
+        // the clauses of the base are passed directly, they are never copied
+        if (c) {
+            // reserves variables used in clauses only, see getCones()
+            Picosat::picosat_adjust(c->cone.size() - 1);
+            shared->activeCones.assign(c->clauses.size(), false);
+        } else {
+            Picosat::picosat_adjust(base->getVarCount());
+            for (const PicosatCNF *layer = base; layer; layer = layer->base)
+                for (const int &lit : layer->getClauses())
+                    Picosat::picosat_add(lit);
+        }
+    }
+    shared->borrowers++;
+    solver = shared->solver;
+    Picosat::picosat_set_global_default_phase(defaultPhase);
+    // above all variables of the base, also the ones only used in its clauses
+    activation = Picosat::picosat_inc_max_var();
+}
+
+void PicosatCNF::activateCone(const Cones &c, int lit) {
+    std::vector<bool> &active = shared->activeCones;
+    const size_t var = abs(lit);
+    if (var >= c.cone.size() || c.cone[var] < 0 || active[c.cone[var]])
+        return;
+    active[c.cone[var]] = true;
+    const int *lits = base->getClauses().begin();
+    for (unsigned int offset : c.clauses[c.cone[var]])
+        for (const int *l = lits + offset;; l++) {
+            Picosat::picosat_add(*l);
+            if (*l == 0)
+                break;
+        }
+}
+
+int PicosatCNF::toSolver(int lit) const {
+    const int var = abs(lit);
+    if (!shared || var <= base->getVarCount())
+        return lit;
+    const size_t own = var - base->getVarCount() - 1;
+    if (own >= sharedVars.size())
+        return 0;
+    return lit < 0 ? -sharedVars[own] : sharedVars[own];
+}
+
+void PicosatCNF::resetSolver() {
+    if (shared) {
+        Picosat::picosat_select(solver);
+        // satisfies the own clauses for good, their variables are free for the next borrower
+        Picosat::picosat_add(-activation);
+        Picosat::picosat_add(0);
+        shared->freeVars.insert(shared->freeVars.end(), sharedVars.begin(), sharedVars.end());
+        sharedVars.clear();
+        std::shared_ptr<SharedSolver> evicted;
+        {
+            std::lock_guard<std::mutex> guard(SharedSolver::lock);
+            SharedSolver::idle.push_back(std::move(shared));
+            if (SharedSolver::idle.size() > maxIdleSolvers) {
+                evicted = std::move(SharedSolver::idle.front());
+                SharedSolver::idle.erase(SharedSolver::idle.begin());
+            }
+        }
+    } else if (solver) {
+        Picosat::picosat_select(solver);
+        Picosat::picosat_reset();
+    }
+    solver = nullptr;
+    pushed_clauses_index = 0;
+}
+
 bool PicosatCNF::checkSatisfiable() {
-    // make sure the current data is stored within picosat
-    if (this != currentContext){
-        // if not, reset the context....
-        if (picosatIsInitalized)
-            Picosat::picosat_reset();
-        Picosat::picosat_init();
-        picosatIsInitalized = true;
-        // and load the current context
-        currentContext = this;
+    // determined before selecting the solver, as it may run a solver of its own
+    const Cones *c = (sliced && base && !base->base) ? &base->getCones() : nullptr;
+    if (c && !c->satisfiable)
+        c = nullptr;
+
+    if (solver) {
+        Picosat::picosat_select(solver);
+    } else if (base) {
+        borrowSolver(c);
+    } else {
+        solver = Picosat::picosat_init();
         Picosat::picosat_set_global_default_phase(defaultPhase);
-        pushed_clauses_index = 0;
+        Picosat::picosat_adjust(varcount);
     }
-    if (pushed_clauses_index < clauses.size()) {
+    // only clauses added since the last call have to be passed to picosat
+    const LiteralRange own = getClauses();
+    if (c) {
+        for (unsigned int i = pushed_clauses_index, e = own.size(); i < e; ++i)
+            activateCone(*c, own.begin()[i]);
+        for (const int &assumption : assumptions)
+            activateCone(*c, assumption);
+    }
+    if (shared) {
+        // assumptions may use variables that are in no clause
+        int maxvar = varcount;
+        for (const int &assumption : assumptions)
+            maxvar = std::max(maxvar, abs(assumption));
+        while ((int) sharedVars.size() < maxvar - base->getVarCount()) {
+            if (shared->freeVars.empty()) {
+                sharedVars.push_back(Picosat::picosat_inc_max_var());
+            } else {
+                sharedVars.push_back(shared->freeVars.back());
+                shared->freeVars.pop_back();
+            }
+        }
+        for (unsigned int i = pushed_clauses_index, e = own.size(); i < e; ++i) {
+            const int lit = own.begin()[i];
+            if (lit == 0)
+                Picosat::picosat_add(-activation);
+            Picosat::picosat_add(toSolver(lit));
+        }
+        pushed_clauses_index = own.size();
+        Picosat::picosat_assume(activation);
+    } else if (pushed_clauses_index < own.size()) {
         // tell picosat how many different variables it will receive
         Picosat::picosat_adjust(varcount);
 
-        for (unsigned int i = pushed_clauses_index, e = clauses.size(); i < e; ++i)
-            Picosat::picosat_add(clauses[i]);
-        pushed_clauses_index = clauses.size();
+        for (unsigned int i = pushed_clauses_index, e = own.size(); i < e; ++i)
+            Picosat::picosat_add(own.begin()[i]);
+        pushed_clauses_index = own.size();
     }
     for (const int &assumption : assumptions)
-        Picosat::picosat_assume(assumption);
-
-    assumptions.clear();
-    return Picosat::picosat_sat(-1) == PICOSAT_SATISFIABLE;
+        Picosat::picosat_assume(toSolver(assumption));
+
+    std::vector<int> assumed;
+    assumed.swap(assumptions);
+    const bool satisfiable = Picosat::picosat_sat(-1) == PICOSAT_SATISFIABLE;
+
+    if (c && verifySlices) {
+        PicosatCNF whole(*this);  // not sliced, with a solver of its own
+        whole.assumptions = assumed;
+        if (whole.checkSatisfiable() != satisfiable)
+            Logging::error("sliced CNF is ", satisfiable ? "" : "un", "satisfiable, ",
+                           "but the whole formula is not");
+        Picosat::picosat_select(solver);
+    }
+    return satisfiable;
 }
 
 void PicosatCNF::pushAssumptions(std::map<std::string, bool> &a) {
@@ -341,7 +917,12 @@ void PicosatCNF::pushAssumptions(std::map<std::string, bool> &a) {
 }
 
 bool PicosatCNF::deref(int s) const {
-    return Picosat::picosat_deref(s) == 1;
+    // nothing is assigned before the first check, or to variables created after it
+    const int lit = toSolver(s);
+    if (!solver || (shared && !lit))
+        return false;
+    Picosat::picosat_select(solver);
+    return Picosat::picosat_deref(lit) == 1;
 }
 
 bool PicosatCNF::deref(const std::string &s) const {
@@ -354,13 +935,50 @@ bool PicosatCNF::deref(const char *c) const {
     return this->deref(cnfvar);
 }
 
-const std::string *PicosatCNF::getAssociatedSymbol(const std::string &var) const {
-    const auto &it = this->associatedSymbols.find(var); // pair<string, string>
-    return (it == this->associatedSymbols.end()) ? nullptr : &(it->second);
+std::string PicosatCNF::getAssociatedSymbol(const std::string &var) const {
+    if (image) {
+        // the image has no such table, it follows from the symbol types like in setSymbolType
+        static const std::string prefix("CONFIG_"), suffix("_MODULE");
+        if (var.compare(0, prefix.size(), prefix) == 0) {
+            std::string sym = var.substr(prefix.size());
+            if (image->find(image->syms, image->header->syms, sym))
+                return sym;
+            if (sym.size() > suffix.size()
+                && sym.compare(sym.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                sym.resize(sym.size() - suffix.size());
+                const Image::Entry *e = image->find(image->syms, image->header->syms, sym);
+                if (e && e->value == K_S_TRISTATE)
+                    return sym;
+            }
+        }
+    } else if (SymbolId id = SymbolTable::lookup(var)) {
+        if (const SymbolId *sym = this->associatedSymbols.find(id))
+            return SymbolTable::name(*sym);
+    }
+    return base ? base->getAssociatedSymbol(var) : "";
 }
 
 const int *PicosatCNF::failedAssumptions() const {
-    return Picosat::picosat_failed_assumptions();
+    static const int none[] = {0};
+    if (!solver)
+        return none;
+    Picosat::picosat_select(solver);
+    const int *lits = Picosat::picosat_failed_assumptions();
+    if (!shared)
+        return lits;
+    failed.clear();
+    for (; *lits; lits++) {
+        const int var = abs(*lits);
+        if (var == activation)
+            continue;
+        int own = var;
+        auto v = std::find(sharedVars.begin(), sharedVars.end(), var);
+        if (v != sharedVars.end())
+            own = base->getVarCount() + 1 + (v - sharedVars.begin());
+        failed.push_back(*lits < 0 ? -own : own);
+    }
+    failed.push_back(0);
+    return failed.data();
 }
 
 void PicosatCNF::addMetaValue(const std::string &key, const std::string &value) {
@@ -373,7 +991,7 @@ void PicosatCNF::addMetaValue(const std::string &key, const std::string &value)
 const std::deque<std::string> *PicosatCNF::getMetaValue(const std::string &key) const {
     const auto &i = meta_information.find(key); // pair<string, deque<string>>
     if (i == meta_information.end()) // key not found
-        return nullptr;
+        return base ? base->getMetaValue(key) : nullptr;
     return &(i->second);
 }
 
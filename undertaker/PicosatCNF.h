@@ -25,11 +25,16 @@
 #define KCONFIG_PICOSATCNF_H
 
 #include "Kconfig.h"
+#include "SymbolTable.h"
 
+#include <cstdint>
 #include <vector>
 #include <map>
+#include <memory>
 #include <string>
 #include <deque>
+#include <functional>
+#include <mutex>
 
 namespace Picosat {
     // Modes taken from picosat.h
@@ -39,33 +44,97 @@ namespace Picosat {
         SAT_DEFAULT = 2,
         SAT_RANDOM  = 3,
     };
+    struct PicoSAT;
 } // namespace Picosat
 
 
 namespace kconfig {
     class PicosatCNF {
+        /**
+         * \brief formula this one is layered on, e.g., a loaded model
+         *
+         * The base is shared and never modified. All of its variables,
+         * clauses and meta information are part of this formula, but are
+         * not copied. Own variables get ids above the ones of the base.
+         */
+        const PicosatCNF *base = nullptr;
+        /**
+         * \brief a binary CNF file mapped into memory, see readFromFile
+         *
+         * If set, variables, symbol types and clauses are read directly
+         * from the mapping instead of the containers below. The first
+         * modification copies them into the containers.
+         */
+        struct Image;
+        std::shared_ptr<const Image> image;
+        void materialize();
         std::vector<int> clauses;
         std::vector<int> assumptions;
+        //! unique for each object, identifies bases in the solvers of SharedSolver
+        const uint64_t serial;
+        /**
+         * \brief the solver instance used by this object, set on first use
+         *
+         * Formulas without a base own their solver. Layered formulas
+         * borrow an idle solver that already contains the clauses of the
+         * base (see SharedSolver), or load a new one that is kept for the
+         * next layer, e.g., of another thread.
+         */
+        Picosat::PicoSAT *solver = nullptr;
+        //! number of entries of 'clauses' already added to 'solver'
         unsigned int pushed_clauses_index = 0;
+        /**
+         * \brief a solver loaded with the clauses of a base, kept for the next layer
+         *
+         * The own clauses of the borrowing layer are guarded by an
+         * activation variable, which is assumed for each check and
+         * disabled for good when the solver is given back. The own
+         * variables of the layer are mapped to solver variables above
+         * the ones of the base ('sharedVars'), which are reused by the
+         * following borrowers.
+         */
+        struct SharedSolver;
+        std::shared_ptr<SharedSolver> shared;
+        std::vector<int> sharedVars;
+        int activation = 0;
+        //! failedAssumptions() of a borrowed solver in the numbering of this formula
+        mutable std::vector<int> failed;
+        int toSolver(int lit) const;
+        void resetSolver();
+        /**
+         * \brief the clauses grouped by the variables they share
+         *
+         * Two clauses are in the same cone if they are connected through
+         * shared variables, directly or via other clauses. Computed once
+         * on first use, see setSliced.
+         */
+        struct Cones;
+        mutable std::shared_ptr<const Cones> cones;
+        mutable std::once_flag cones_once;
+        const Cones &getCones() const;
+        bool sliced = false, verifySlices = false;
+        //! adds the cone of 'lit' to the borrowed solver if it isn't there yet
+        void activateCone(const Cones &c, int lit);
+        void borrowSolver(const Cones *c);
         //! this map contains the the type of each Kconfig symbol
-        std::map<std::string, kconfig_symbol_type> symboltypes;
+        SymbolMap<kconfig_symbol_type> symboltypes;
 
         /**
         * \brief mapping between boolean variable names and their cnf-id
         *  Keep in sync with "booleanvars"
         */
-        std::map<std::string, int> cnfvars;
+        SymbolMap<int> cnfvars;
         /** mapping between the names of boolean variables and symbols
             Some boolean variable represent model symbols. if so, the have
             to be stored in this map.
             Example:
             { "CONFIG_FOO"  -> "FOO", "CONFIG_FOO_MODULE" -> "FOO" }
         **/
-        std::map<std::string, std::string> associatedSymbols;
-        /** contains the variable name for cnf-id.
-            Not all cnf-id will have a name. Must kept in sync with "cnfvars"
+        SymbolMap<SymbolId> associatedSymbols;
+        /** contains the variable name for cnf-id, indexed by the cnf-id.
+            Not all cnf-id will have a name (0). Must kept in sync with "cnfvars"
         **/
-        std::map<int, std::string> boolvars;
+        std::vector<SymbolId> boolvars;
         std::map<std::string, std::deque<std::string>> meta_information;
         Picosat::SATMode defaultPhase;
         int varcount = 0;
@@ -73,13 +142,67 @@ namespace kconfig {
         inline void setCNFVar_fast(const std::string &var, int CNFVar);
     public:
         explicit PicosatCNF(Picosat::SATMode = Picosat::SAT_MIN);
+        //! copies the formula, the copy gets its own solver instance
+        PicosatCNF(const PicosatCNF &);
         PicosatCNF(const PicosatCNF &, Picosat::SATMode);
+        //! creates an empty formula layered on 'base', which has to outlive this object
+        PicosatCNF(const PicosatCNF *base, Picosat::SATMode);
+        PicosatCNF &operator=(const PicosatCNF &) = delete;
         ~PicosatCNF();
+        //! read-only view of literals, clauses are terminated by 0
+        struct LiteralRange {
+            const int *first, *last;
+            const int *begin() const { return first; }
+            const int *end() const { return last; }
+            size_t size() const { return last - first; }
+        };
+
+        /**
+         * Reads a CNF file in the text or binary format. Binary files are
+         * mapped into memory and used without parsing them.
+         * @throws IOException if the file can't be read or has the wrong format
+         */
         void readFromFile(const std::string &filename);
         void readFromStream(std::istream &i);
-        void toFile(const std::string &filename) const;
+        void toFile(const std::string &filename, bool binary = false) const;
         void toStream(std::ostream &out) const;
+        /**
+         * \brief writes the binary format
+         *
+         * The binary format consists of a header with a magic number,
+         * the format version and the size of each section, followed by:
+         *  - the clauses as a flat array of literals,
+         *  - the named variables sorted by name and an index of them
+         *    sorted by cnf-id,
+         *  - the symbol types sorted by name,
+         *  - the meta information,
+         *  - a string table with all names.
+         * All numbers are in the byte order of the machine writing it.
+         */
+        void toBinaryStream(std::ostream &out) const;
         void incrementWith(const PicosatCNF &);
+        /**
+         * \brief layers the current formula on 'base'
+         *
+         * Unlike incrementWith, this only renumbers the (usually few)
+         * variables of this formula. Variables with the same name as one
+         * in 'base' are unified with it. 'base' has to outlive this object.
+         */
+        void setBase(const PicosatCNF *base);
+        const PicosatCNF *getBase() const { return base; }
+        /**
+         * \brief only pass the cone of influence of this layer to the solver
+         *
+         * Clauses of the base that don't share variables with the clauses
+         * and assumptions of this layer, not even through other clauses,
+         * can't change its satisfiability if the base is satisfiable on
+         * its own (which is checked once per base). They are left out of
+         * the solver. The values of all variables outside of the cone are
+         * arbitrary, so deref() must not be used on sliced formulas.
+         * If 'verify' is set, each result is compared to solving the
+         * whole formula and mismatches are logged as errors.
+         */
+        void setSliced(bool sliced, bool verify = false);
         kconfig_symbol_type getSymbolType(const std::string &name) const;
         void setSymbolType(const std::string &sym, kconfig_symbol_type type);
         int getCNFVar(const std::string &var) const;
@@ -104,14 +227,20 @@ namespace kconfig {
         bool deref(const std::string &s) const;
         bool deref(const char *s) const;
         int getVarCount() const { return varcount; }
-        int getClauseCount() const { return clausecount; }
-        const std::vector<int> &getClauses() const { return clauses; }
-        int newVar();
-        const std::string *getAssociatedSymbol(const std::string &var) const;
-        const std::map<std::string, int> &getSymbolMap() const { return cnfvars; }
-        const std::map<std::string, kconfig_symbol_type> &getSymbolTypes() const {
-            return symboltypes;
+        //! number of clauses, including the ones of the base
+        int getClauseCount() const {
+            return base ? base->getClauseCount() + clausecount : clausecount;
         }
+        //! clauses of this layer only, see getBase()
+        LiteralRange getClauses() const;
+        int newVar();
+        //! returns the symbol 'var' belongs to (e.g., FOO for CONFIG_FOO_MODULE) or ""
+        std::string getAssociatedSymbol(const std::string &var) const;
+        //! calls 'f' for every named variable of this layer (see getBase()) in order of names
+        void forEachSymbol(const std::function<void(const std::string &, int)> &f) const;
+        //! calls 'f' for every symbol type of this layer in order of names
+        void forEachSymbolType(
+            const std::function<void(const std::string &, kconfig_symbol_type)> &f) const;
         const std::map<std::string, std::deque<std::string>> &getMetaInformation() const {
             return meta_information;
         }
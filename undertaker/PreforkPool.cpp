@@ -0,0 +1,205 @@
+/*
+ *   undertaker - pool of long-lived worker processes for batch mode
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PreforkPool.h"
+#include "Logging.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+PreforkPool::PreforkPool(unsigned int workers, job_t job) : _job(job) {
+    if (workers < 1)
+        workers = 1;
+    _workers.resize(workers);
+    for (Worker &w : _workers)
+        start(w);
+}
+
+PreforkPool::~PreforkPool() {
+    for (Worker &w : _workers)
+        stop(w);
+}
+
+void PreforkPool::start(Worker &w) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        Logging::error("creating socket for worker failed: ", strerror(errno));
+        std::exit(EXIT_FAILURE);
+    }
+    // prevent printing the contents of the stdout-buffer in every worker
+    std::cout << std::flush;
+    std::cerr << std::flush;
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        Logging::error("forking failed. Exiting.");
+        std::exit(EXIT_FAILURE);
+    } else if (pid == 0) { /* worker */
+        close(fds[0]);
+        for (const Worker &other : _workers)
+            if (other.fd >= 0)
+                close(other.fd);
+        serve(fds[1]);
+    }
+    close(fds[1]);
+    w.pid = pid;
+    w.fd = fds[0];
+    w.busy = false;
+    w.response.clear();
+}
+
+void PreforkPool::serve(int fd) {
+    FILE *in = fdopen(fd, "r");
+    char *line = nullptr;
+    size_t size = 0;
+    ssize_t len;
+
+    while ((len = getline(&line, &size, in)) > 0) {
+        if (line[len - 1] == '\n')
+            len--;
+        int status = _job(std::string(line, len));
+
+        // the parent may print statistics right after our answer
+        std::cout << std::flush;
+        std::cerr << std::flush;
+        std::string answer = std::to_string(status) + "\n";
+        if (write(fd, answer.data(), answer.size()) != (ssize_t) answer.size())
+            break;
+    }
+    // all global data belongs to the parent, don't run any destructors
+    _exit(EXIT_SUCCESS);
+}
+
+void PreforkPool::submit(const std::string &item) {
+    const std::string message = item + "\n";
+    while (true) {
+        for (Worker &w : _workers) {
+            if (w.busy)
+                continue;
+            if (send(w.fd, message.data(), message.size(), MSG_NOSIGNAL)
+                == (ssize_t) message.size()) {
+                w.busy = true;
+                w.item = item;
+                return;
+            }
+            // the idle worker has died, e.g. after an abandoned timeout
+            reap(w);
+            start(w);
+        }
+        collect();
+    }
+}
+
+void PreforkPool::collect() {
+    std::vector<struct pollfd> fds;
+    std::vector<Worker *> busy;
+    for (Worker &w : _workers) {
+        if (!w.busy)
+            continue;
+        fds.push_back({w.fd, POLLIN, 0});
+        busy.push_back(&w);
+    }
+    if (fds.empty())
+        return;
+
+    if (poll(fds.data(), fds.size(), -1) < 0) {
+        if (errno != EINTR)
+            Logging::error("waiting for workers failed: ", strerror(errno));
+        return;
+    }
+    for (size_t i = 0; i < fds.size(); i++) {
+        if (!fds[i].revents)
+            continue;
+        Worker &w = *busy[i];
+        char buf[64];
+        ssize_t n = read(w.fd, buf, sizeof buf);
+        if (n <= 0) {
+            // the worker died while processing its item
+            reap(w);
+            start(w);
+            continue;
+        }
+        w.response.append(buf, n);
+        if (w.response.back() != '\n')
+            continue;
+        int status = std::atoi(w.response.c_str());
+        if (status == EXIT_SUCCESS) {
+            _stats.ok++;
+        } else {
+            _stats.failed++;
+            _stats.failed_items.push_back(w.item);
+            Logging::error("Process (pid: ", w.pid, ", args: ", w.item,
+                           ") failed with exitcode ", status);
+        }
+        w.busy = false;
+        w.response.clear();
+    }
+}
+
+void PreforkPool::reap(Worker &w) {
+    int state = 0;
+    close(w.fd);
+    w.fd = -1;
+    while (waitpid(w.pid, &state, 0) == -1 && errno == EINTR)
+        ;
+    if (!w.busy)
+        return;
+
+    if (WIFSIGNALED(state)) {
+        _stats.signaled++;
+        Logging::error("Process (pid: ", w.pid, ", args: ", w.item,
+                       ") failed with signal ", WTERMSIG(state));
+    } else {
+        _stats.failed++;
+        Logging::error("Process (pid: ", w.pid, ", args: ", w.item,
+                       ") failed with exitcode ", WEXITSTATUS(state));
+    }
+    _stats.failed_items.push_back(w.item);
+    w.busy = false;
+}
+
+void PreforkPool::stop(Worker &w) {
+    if (w.fd < 0)
+        return;
+    // closing the socket ends the worker's read loop
+    close(w.fd);
+    w.fd = -1;
+    while (waitpid(w.pid, nullptr, 0) == -1 && errno == EINTR)
+        ;
+}
+
+const PreforkPool::Stats &PreforkPool::finish() {
+    bool busy;
+    do {
+        collect();
+        busy = false;
+        for (const Worker &w : _workers)
+            busy |= w.busy;
+    } while (busy);
+
+    for (Worker &w : _workers)
+        stop(w);
+    return _stats;
+}
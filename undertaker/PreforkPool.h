@@ -0,0 +1,88 @@
+/*
+ *   undertaker - pool of long-lived worker processes for batch mode
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -*- mode: c++ -*-
+#ifndef prefork_pool_h__
+#define prefork_pool_h__
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+
+/**
+ * \brief Processes work items in a fixed number of forked worker processes
+ *
+ * The workers are forked once and then share everything the parent has
+ * loaded so far (e.g., the models) copy-on-write. Items are sent to
+ * an idle worker over a socket. The worker answers with the exit
+ * status of the job. A worker that dies while processing an item (crash,
+ * timeout, exit) is reported like a failed child process and replaced
+ * by a freshly forked one.
+ *
+ * Items are handed out as they are submitted, so the caller can feed
+ * the pool from a stream while earlier items are already processed.
+ */
+class PreforkPool {
+public:
+    //! runs in a worker process, returns EXIT_SUCCESS or EXIT_FAILURE
+    typedef std::function<int(const std::string &)> job_t;
+
+    struct Stats {
+        int ok = 0;
+        int failed = 0;
+        int signaled = 0;
+        std::vector<std::string> failed_items;
+    };
+
+    /**
+     * \param workers number of worker processes, at least one is used
+     * \param job function that processes one item in a worker
+     */
+    PreforkPool(unsigned int workers, job_t job);
+    ~PreforkPool();
+
+    /**
+     * Sends 'item' to an idle worker. If all workers are busy, this
+     * blocks until one of them has finished its item.
+     */
+    void submit(const std::string &item);
+
+    //! waits for all submitted items and stops the workers
+    const Stats &finish();
+
+private:
+    struct Worker {
+        pid_t pid = 0;
+        int fd = -1;  // our end of the socket pair
+        bool busy = false;
+        std::string item;
+        std::string response;
+    };
+    std::vector<Worker> _workers;
+    job_t _job;
+    Stats _stats;
+
+    void start(Worker &w);
+    [[noreturn]] void serve(int fd);
+    void collect();
+    void reap(Worker &w);
+    void stop(Worker &w);
+};
+
+#endif
@@ -23,6 +23,7 @@
 
 
 #include "PumaConditionalBlock.h"
+#include "QueryCache.h"
 #include "Logging.h"
 #include "cpp14.h"
 
@@ -39,6 +40,8 @@
 #include <Puma/StrCol.h>
 
 #include <set>
+#include <sstream>
+#include <boost/filesystem.hpp>
 
 using namespace Puma;
 
@@ -337,6 +340,7 @@ void PumaConditionalBlockBuilder::visitDefineHelper(PreTreeComposite *node, bool
         (*i).second->newDefine(&block, define);
 
     block.addDefine(map[definedFlag]);
+    _defines.push_back(CppFileSnapshot::Define{&block, define, definedFlag});
 }
 
 void PumaConditionalBlockBuilder::visitPreDefineConstantDirective_Pre (Puma::PreDefineConstantDirective *node){
@@ -522,6 +526,9 @@ void undertaker_normalizations(Puma::Unit *unit) {
 
 
 std::list<std::string> PumaConditionalBlockBuilder::_includePaths;
+std::mutex PumaConditionalBlockBuilder::pumaLock;
+std::map<std::string, PumaConditionalBlockBuilder::CachedInclude>
+    PumaConditionalBlockBuilder::_includeCache;
 
 void PumaConditionalBlockBuilder::addIncludePath(const char *path){
     _includePaths.push_back(path);
@@ -599,6 +606,58 @@ static void removeIncludeGuard(Unit *unit) {
     mc.commit();
 }
 
+std::string PumaConditionalBlockBuilder::locateInclude(const std::string &include,
+                                                      const char *includer, bool *computed) {
+    if (computed)
+        *computed = true;
+    const std::string::size_type start = include.find_first_not_of(" \t");
+    if (start == std::string::npos || (include[start] != '"' && include[start] != '<'))
+        return "";
+    const bool quoted = include[start] == '"';
+    const std::string::size_type end = include.find(quoted ? '"' : '>', start + 1);
+    if (end == std::string::npos)
+        return "";
+    if (computed)
+        *computed = false;
+    const std::string name = include.substr(start + 1, end - start - 1);
+
+    std::list<boost::filesystem::path> dirs;
+    // "file.h" is looked up next to the including file first
+    if (quoted && includer)
+        dirs.push_back(boost::filesystem::path(includer).parent_path());
+    dirs.insert(dirs.end(), _includePaths.begin(), _includePaths.end());
+    for (const boost::filesystem::path &dir : dirs) {
+        const boost::filesystem::path file = dir / name;
+        boost::system::error_code error;
+        if (boost::filesystem::is_regular_file(file, error))
+            return file.string();
+    }
+    return "";
+}
+
+Puma::Unit *PumaConditionalBlockBuilder::cachedInclude(const std::string &filename) {
+    std::ifstream in(filename, std::ios_base::binary);
+    if (!in.good())
+        return nullptr;
+    std::ostringstream content;
+    content << in.rdbuf();
+    const uint64_t hash = QueryCache::hash(content.str());
+
+    const auto it = _includeCache.find(filename);
+    if (it != _includeCache.end() && it->second.content == hash)
+        return it->second.unit;
+
+    // a changed header replaces the cached one, files still open may refer to the old unit
+    static Puma::ErrorStream err;
+    auto unit = new Puma::CUnit(err);
+    // always set filename for Puma::CUnits
+    unit->name(filename.c_str());
+    *unit << content.str() << Puma::endu;
+    removeIncludeGuard(unit);
+    _includeCache[filename] = CachedInclude{hash, unit};
+    return unit;
+}
+
 void PumaConditionalBlockBuilder::resolve_includes(Puma::Unit *unit) {
     Puma::PreFileIncluder includer(*_cpp);
     Puma::ManipCommander mc;
@@ -618,11 +677,21 @@ void PumaConditionalBlockBuilder::resolve_includes(Puma::Unit *unit) {
                 include += e->text();
             } while (unit->next(e) && unit->next(e)->text()[0] != '\n');
 
-            Puma::Unit *file = includer.includeFile(include.c_str());
+            /* Headers are scanned only once per process, the ones Puma has to
+             * find (e.g., computed includes) are scanned for each file */
+            const char *includer_name = s->location().filename().name();
+            const std::string filename = locateInclude(include, includer_name);
+            Puma::Unit *file = filename.empty() ? includer.includeFile(include.c_str())
+                                                : cachedInclude(filename);
             Puma::Token *before = unit->prev(s);
+            if (file)
+                _includedFiles.insert(file->name());
+            else
+                _unresolvedIncludes.push_back({include, includer_name ? includer_name : ""});
             if (file && already_seen.count(file) == 0) {
                 /* Paste the included file only, if we haven't it seen until then */
-                removeIncludeGuard(file);
+                if (filename.empty())
+                    removeIncludeGuard(file);
                 mc.paste_before(s, file);
                 already_seen.insert(file);
             }
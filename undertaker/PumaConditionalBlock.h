@@ -27,6 +27,7 @@
 #define _PUMA_CONDITIONAL_BLOCK_H
 
 #include "ConditionalBlock.h"
+#include "CppFileSnapshot.h"
 
 // unique_ptr needs a complete type
 #include <Puma/CTranslationUnit.h>
@@ -39,7 +40,12 @@
 
 #include <stack>
 #include <list>
+#include <map>
+#include <set>
+#include <vector>
 #include <fstream>
+#include <mutex>
+#include <cstdint>
 
 // forward decl.
 class PumaConditionalBlockBuilder;
@@ -106,6 +112,7 @@ public:
     bool isDummyBlock()          const final override { return _isDummyBlock; }
     void setDummyBlock()               final override { _isDummyBlock = true; }
     const std::string getName()  const final override;
+    unsigned long getIndex()     const final override { return _parent ? _number + 1 : 0; }
     PumaConditionalBlockBuilder &getBuilder() const { return _builder; }
 
     friend class PumaConditionalBlockBuilder;
@@ -133,10 +140,22 @@ class PumaConditionalBlockBuilder : public Puma::PreVisitor {
     std::unique_ptr<Puma::PreprocessorParser> _cpp;
 
     Puma::Unit *_unit = nullptr; // the unit we are working on
+    // what a snapshot of the file needs, see CppFileSnapshot
+    std::set<std::string> _includedFiles;
+    std::vector<CppFileSnapshot::UnresolvedInclude> _unresolvedIncludes;
+    std::vector<CppFileSnapshot::Define> _defines;
 
     static std::list<std::string> _includePaths;
 
+    //! a header scanned once per process and pasted into every file that includes it
+    struct CachedInclude {
+        uint64_t content;  // hash of the content the unit was scanned from
+        Puma::Unit *unit;  // without include guard, never freed
+    };
+    static std::map<std::string, CachedInclude> _includeCache;
+
     void visitDefineHelper(Puma::PreTreeComposite *node, bool define);
+    Puma::Unit *cachedInclude(const std::string &filename);
     void resolve_includes(Puma::Unit *);
     void reset_MacroManager(Puma::Unit *unit);
     ConditionalBlock *parse(const std::string &filename);
@@ -165,6 +184,32 @@ public:
     void visitPreUndefDirective_Pre (Puma::PreUndefDirective *)                  final override;
 
     unsigned long *getNodeNum() { return &_nodeNum; }
+    //! the files pasted in for #include directives
+    const std::set<std::string> &getIncludedFiles() const { return _includedFiles; }
+    //! the #include directives whose files weren't found
+    const std::vector<CppFileSnapshot::UnresolvedInclude> &getUnresolvedIncludes() const {
+        return _unresolvedIncludes;
+    }
+    //! all #define and #undef directives handled by CppDefine, in the order of the file
+    const std::vector<CppFileSnapshot::Define> &getDefines() const { return _defines; }
     static void addIncludePath(const char *);
+    static const std::list<std::string> &getIncludePaths() { return _includePaths; }
+    /**
+     * \brief finds the file of an #include directive like the preprocessor does
+     *
+     * @param include the text after #include, e.g. ' <linux/kernel.h>' or ' "local.h"'
+     * @param includer the file containing the directive
+     * @param computed set if 'include' isn't a plain file name, e.g., a macro
+     * \return the path of the file, empty for computed includes and files not found
+     */
+    static std::string locateInclude(const std::string &include, const char *includer,
+                                     bool *computed = nullptr);
+
+    /**
+     * Puma is not thread safe (e.g., all token texts live in one global
+     * string table). Threads must hold this lock while parsing a file,
+     * modifying or walking its token list and freeing it.
+     */
+    static std::mutex pumaLock;
 };
 #endif
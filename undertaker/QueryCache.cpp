@@ -0,0 +1,261 @@
+/*
+ *   undertaker - cache of satisfiability checks
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "QueryCache.h"
+#include "PicosatCNF.h"
+#include "Logging.h"
+#include "bool.h"
+#include "exceptions/IOException.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace {
+    // XXX do not modify without changing the magic, files of other versions are ignored then
+    const uint32_t recordMagic = 0x55514330;  // "UQC0", the lowest bit is the result
+
+    struct Record {
+        uint64_t hi, lo;
+        uint32_t magic;
+        uint32_t check;
+    };
+
+    // the finalizer of splitmix64
+    uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    uint64_t combine(uint64_t seed, uint64_t value) {
+        return mix(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+    }
+
+    // FNV-1a, unlike std::hash the same in every run
+    uint64_t fnv(const std::string &s) {
+        uint64_t h = 0xcbf29ce484222325ULL;
+        for (unsigned char c : s) {
+            h ^= c;
+            h *= 0x100000001b3ULL;
+        }
+        return h;
+    }
+
+    uint32_t checksum(const Record &r) {
+        return (uint32_t) combine(combine(r.hi, r.lo), r.magic);
+    }
+
+    // shared nodes (see BoolExpFactory) are only hashed once
+    uint64_t hashNode(const kconfig::BoolExp *e,
+                      std::unordered_map<const kconfig::BoolExp *, uint64_t> &memo) {
+        using namespace kconfig;
+        if (!e)
+            return 0;
+        const auto it = memo.find(e);
+        if (it != memo.end())
+            return it->second;
+
+        uint64_t h;
+        if (const BoolExpConst *c = dynamic_cast<const BoolExpConst *>(e))
+            h = combine(1, c->value);
+        else if (dynamic_cast<const BoolExpVar *>(e))
+            h = combine(2, fnv(e->getName()));
+        else if (dynamic_cast<const BoolExpNot *>(e))
+            h = 3;
+        else if (dynamic_cast<const BoolExpAnd *>(e))
+            h = 4;
+        else if (dynamic_cast<const BoolExpOr *>(e))
+            h = 5;
+        else if (dynamic_cast<const BoolExpImpl *>(e))
+            h = 6;
+        else if (dynamic_cast<const BoolExpEq *>(e))
+            h = 7;
+        else if (dynamic_cast<const BoolExpAny *>(e))
+            h = combine(8, fnv(e->getName()));
+        else if (const BoolExpCall *call = dynamic_cast<const BoolExpCall *>(e)) {
+            h = combine(9, fnv(e->getName()));
+            if (call->param)
+                for (const BoolExp *param : *call->param)
+                    h = combine(h, hashNode(param, memo));
+        } else
+            h = combine(10, fnv(e->getName()));
+        h = combine(combine(h, hashNode(e->left, memo)), hashNode(e->right, memo));
+        memo.emplace(e, h);
+        return h;
+    }
+} // namespace
+
+QueryCache &QueryCache::getInstance() {
+    static QueryCache instance;
+    return instance;
+}
+
+QueryCache::~QueryCache() {
+    if (fd >= 0)
+        close(fd);
+}
+
+void QueryCache::enable(const std::string &file) {
+    boost::unique_lock<boost::shared_mutex> guard(lock);
+    if (!counters) {
+        // anonymous shared memory is inherited by forked workers and zeroed
+        void *shared = mmap(nullptr, sizeof(Counters), PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (shared == MAP_FAILED)
+            throw kconfig::IOException("could not map the counters of the query cache");
+        counters = new (shared) Counters();
+    }
+    if (!file.empty() && fd < 0) {
+        fd = open(file.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0)
+            throw kconfig::IOException("could not open query cache " + file);
+        refresh();
+        Logging::info("loaded ", results.size(), " results from query cache ", file);
+    }
+    enabled = true;
+}
+
+void QueryCache::refresh() {
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size <= offset)
+        return;
+    std::vector<char> data(st.st_size - offset);
+    if (pread(fd, data.data(), data.size(), offset) != (ssize_t) data.size())
+        return;
+
+    Record r;
+    auto validAt = [&r, &data](size_t pos) {
+        memcpy(&r, &data[pos], sizeof(r));
+        return (r.magic & ~1u) == recordMagic && r.check == checksum(r);
+    };
+    size_t pos = 0;
+    while (pos + sizeof(Record) <= data.size()) {
+        if (validAt(pos)) {
+            results.emplace(Key{r.hi, r.lo}, r.magic & 1);
+            pos += sizeof(Record);
+            continue;
+        }
+        // the rest of a failed (short) write, the records after it start at any byte
+        size_t next = pos + 1;
+        while (next + sizeof(Record) <= data.size() && !validAt(next))
+            next++;
+        if (next + sizeof(Record) > data.size())
+            break;  // the garbage is skipped once a valid record follows it
+        Logging::warn("skipping ", next - pos, " corrupt bytes in the query cache");
+        pos = next;
+    }
+    if (offset == 0 && pos == 0 && data.size() >= sizeof(Record)) {
+        // not a single record, don't scan the whole file again on every miss
+        Logging::warn("ignoring the query cache, it's corrupt or of another version");
+        offset = std::numeric_limits<off_t>::max();
+        return;
+    }
+    // a record that is being appended right now is read the next time
+    offset += pos;
+}
+
+bool QueryCache::lookup(const Key &key, bool &satisfiable) {
+    {
+        boost::shared_lock<boost::shared_mutex> guard(lock);
+        const auto it = results.find(key);
+        if (it != results.end()) {
+            satisfiable = it->second;
+            counters->hits++;
+            return true;
+        }
+    }
+    if (fd >= 0) {
+        boost::unique_lock<boost::shared_mutex> guard(lock);
+        refresh();
+        const auto it = results.find(key);
+        if (it != results.end()) {
+            satisfiable = it->second;
+            counters->hits++;
+            return true;
+        }
+    }
+    counters->misses++;
+    return false;
+}
+
+void QueryCache::insert(const Key &key, bool satisfiable) {
+    boost::unique_lock<boost::shared_mutex> guard(lock);
+    if (!results.emplace(key, satisfiable).second || fd < 0)
+        return;
+    Record r{key.hi, key.lo, recordMagic | (satisfiable ? 1u : 0u), 0};
+    r.check = checksum(r);
+    // a single write with O_APPEND doesn't interleave with the ones of other processes
+    if (write(fd, &r, sizeof(r)) != sizeof(r))
+        Logging::warn("could not write to the query cache");
+}
+
+QueryCache::Stats QueryCache::getStats() const {
+    if (!counters)
+        return Stats{0, 0};
+    return Stats{counters->hits, counters->misses};
+}
+
+uint64_t QueryCache::fingerprint(const kconfig::PicosatCNF *cnf) {
+    if (!cnf)
+        return 0;
+    {
+        boost::shared_lock<boost::shared_mutex> guard(lock);
+        const auto it = fingerprints.find(cnf);
+        if (it != fingerprints.end())
+            return it->second;
+    }
+    uint64_t h = combine(0, cnf->getVarCount());
+    for (const kconfig::PicosatCNF *layer = cnf; layer; layer = layer->getBase()) {
+        for (int lit : layer->getClauses())
+            h = combine(h, (uint64_t) (int64_t) lit);
+        layer->forEachSymbol([&h](const std::string &name, int lit) {
+            h = combine(combine(h, fnv(name)), (uint64_t) (int64_t) lit);
+        });
+    }
+    boost::unique_lock<boost::shared_mutex> guard(lock);
+    return fingerprints.emplace(cnf, h).first->second;
+}
+
+QueryCache::Key QueryCache::key(const kconfig::PicosatCNF *cnf, std::vector<uint64_t> formulas) {
+    std::sort(formulas.begin(), formulas.end());
+    formulas.erase(std::unique(formulas.begin(), formulas.end()), formulas.end());
+    const uint64_t model = fingerprint(cnf);
+    Key key{combine(0x6a09e667f3bcc908ULL, model), combine(0xbb67ae8584caa73bULL, model)};
+    for (uint64_t f : formulas) {
+        key.hi = combine(key.hi, f);
+        key.lo = combine(key.lo, mix(f));
+    }
+    return key;
+}
+
+uint64_t QueryCache::hash(const kconfig::BoolExp *e) {
+    std::unordered_map<const kconfig::BoolExp *, uint64_t> memo;
+    return hashNode(e, memo);
+}
+
+uint64_t QueryCache::hash(const std::string &formula) {
+    return combine(11, fnv(formula));
+}
@@ -0,0 +1,113 @@
+/*
+ *   undertaker - cache of satisfiability checks
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -*- mode: c++ -*-
+#ifndef query_cache_h__
+#define query_cache_h__
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+#include <boost/thread/shared_mutex.hpp>
+
+namespace kconfig {
+    class BoolExp;
+    class PicosatCNF;
+}
+
+
+/**
+ * \brief Results of satisfiability checks, shared by all checkers of a run
+ *
+ * A query is the conjunction of a cnf model (or none) and of a set of
+ * formulas. Its key is a 128 bit hash of the fingerprint of the model
+ * and of the structural hashes of the formulas, independent of their
+ * order and of duplicates. Only the result (satisfiable or not) is
+ * stored, not the solution.
+ *
+ * The results can be kept in a file, which is read when the cache is
+ * enabled. New results are appended to it with single writes, so that
+ * concurrent runs and forked workers can share the same file. Before
+ * a query is reported as a miss, the results appended by others since
+ * the last read are loaded. Each record carries a magic number and a
+ * checksum, so the rest of a failed write is skipped up to the next
+ * valid record instead of misaligning all of the following ones.
+ */
+class QueryCache {
+public:
+    struct Key {
+        uint64_t hi, lo;
+        bool operator==(const Key &other) const { return hi == other.hi && lo == other.lo; }
+    };
+    //! hits and misses of this process and of all processes forked from it
+    struct Stats {
+        uint64_t hits, misses;
+    };
+
+    //! the cache of this process, disabled until enable() is called
+    static QueryCache &getInstance();
+
+    /**
+     * Enables the cache. If 'file' isn't empty, the results stored in it
+     * are loaded and new results are appended to it.
+     * @throws kconfig::IOException if 'file' can't be opened
+     */
+    void enable(const std::string &file = "");
+    bool isEnabled() const { return enabled; }
+
+    //! returns true and sets 'satisfiable' if the result of 'key' is known
+    bool lookup(const Key &key, bool &satisfiable);
+    void insert(const Key &key, bool satisfiable);
+    Stats getStats() const;
+
+    //! order independent key of the conjunction of the base 'cnf' and 'formulas'
+    Key key(const kconfig::PicosatCNF *cnf, std::vector<uint64_t> formulas);
+    //! structural hash of a formula, stable across runs
+    static uint64_t hash(const kconfig::BoolExp *e);
+    //! hash of a formula that is given as string
+    static uint64_t hash(const std::string &formula);
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key &key) const { return key.lo; }
+    };
+    struct Counters {
+        std::atomic<uint64_t> hits, misses;
+    };
+
+    QueryCache() = default;
+    ~QueryCache();
+    QueryCache(const QueryCache &) = delete;
+    QueryCache &operator=(const QueryCache &) = delete;
+
+    //! loads the results appended to the file since the last call, 'lock' must be held
+    void refresh();
+    uint64_t fingerprint(const kconfig::PicosatCNF *cnf);
+
+    bool enabled = false;
+    std::unordered_map<Key, bool, KeyHash> results;
+    std::unordered_map<const kconfig::PicosatCNF *, uint64_t> fingerprints;
+    boost::shared_mutex lock;
+    int fd = -1;
+    off_t offset = 0;  // bytes of the file already read
+    // in memory shared with forked workers
+    Counters *counters = nullptr;
+};
+#endif
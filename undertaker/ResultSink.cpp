@@ -0,0 +1,239 @@
+/*
+ *   undertaker - result files collected in a few append-only files
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ResultSink.h"
+#include "Logging.h"
+#include "exceptions/IOException.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <fcntl.h>
+#include <glob.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+
+
+namespace {
+    const std::string sinkSuffix = ".results";
+    //! see ResultSink::deferTo
+    thread_local ResultSink::Deferred *deferred = nullptr;
+
+    struct Record {
+        uint64_t time;
+        char type;
+        std::string name;
+        size_t file;                   // index of the sink file
+        std::streamoff offset, length;  // of the content in the sink file
+    };
+
+    // appends the records of 'filename' to 'records', a truncated last record is dropped
+    void readRecords(const std::string &filename, size_t file, std::vector<Record> &records) {
+        std::ifstream in(filename, std::ios_base::binary);
+        boost::system::error_code error;
+        const std::streamoff size = boost::filesystem::file_size(filename, error);
+        if (!in.good() || error)
+            throw kconfig::IOException("could not read results " + filename);
+        std::string header;
+        while (std::getline(in, header)) {
+            Record record;
+            size_t nameLength;
+            char type;
+            unsigned long long time, length;
+            if (sscanf(header.c_str(), "%c\t%llu\t%zu\t%llu", &type, &time, &nameLength, &length)
+                    != 4
+                || (type != 'F' && type != 'R')) {
+                Logging::warn("corrupt record in ", filename, ", skipping the rest of it");
+                return;
+            }
+            record.type = type;
+            record.time = time;
+            record.file = file;
+            record.length = length;
+            record.name.resize(nameLength);
+            in.read(&record.name[0], nameLength);
+            record.offset = in.tellg();
+            if (!in.good() || record.offset + record.length > size) {
+                Logging::warn("truncated record in ", filename, ", skipping it");
+                return;
+            }
+            in.seekg(record.length, std::ios_base::cur);
+            records.push_back(record);
+        }
+    }
+} // namespace
+
+ResultSink &ResultSink::getInstance() {
+    static ResultSink instance;
+    return instance;
+}
+
+ResultSink::~ResultSink() {
+    if (fd >= 0)
+        close(fd);
+}
+
+void ResultSink::enable(const std::string &directory) {
+    boost::system::error_code error;
+    boost::filesystem::create_directories(directory, error);
+    if (!boost::filesystem::is_directory(directory))
+        throw kconfig::IOException("could not create the result directory " + directory);
+    _directory = directory;
+}
+
+bool ResultSink::write(const std::string &filename, const std::string &content) {
+    if (deferred) {
+        deferred->emplace_back(filename, content);
+        return true;
+    }
+    if (!isEnabled())
+        return writeFile(filename, content);
+    return append('F', filename, content);
+}
+
+void ResultSink::deferTo(Deferred *results) {
+    deferred = results;
+}
+
+bool ResultSink::commit(const Deferred &results) {
+    bool ok = true;
+    for (const auto &result : results)  // pair<string, string>
+        ok = write(result.first, result.second) && ok;
+    return ok;
+}
+
+int ResultSink::remove(const std::string &pattern) {
+    if (!isEnabled())
+        return removeFiles(pattern);
+    return append('R', pattern, "") ? 1 : 0;
+}
+
+bool ResultSink::append(char type, const std::string &name, const std::string &content) {
+    std::lock_guard<std::mutex> guard(lock);
+    // merge() orders by time, the records of one process must stay in order even if the clock
+    // is set back
+    const uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::system_clock::now().time_since_epoch()).count();
+    time = std::max(now, time + 1);
+    std::string record = std::string(1, type) + "\t" + std::to_string(time) + "\t"
+        + std::to_string(name.size()) + "\t" + std::to_string(content.size()) + "\n";
+    record += name;
+    record += content;
+
+    if (fd < 0 || pid != getpid()) {
+        // the file of the parent stays with the parent, each worker appends to its own one
+        if (fd >= 0)
+            close(fd);
+        char host[64] = "localhost";
+        gethostname(host, sizeof(host) - 1);
+        pid = getpid();
+        const std::string file = _directory + "/" + host + "." + std::to_string(pid)
+            + (generation ? "." + std::to_string(generation) : "") + sinkSuffix;
+        fd = open(file.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0666);
+        if (fd < 0) {
+            Logging::error("failed to open ", file, " for writing");
+            return false;
+        }
+    }
+    // a single write, so that a crash never leaves a partial record in the middle of the file
+    struct stat st;
+    const off_t end = fstat(fd, &st) == 0 ? st.st_size : -1;
+    const ssize_t written = ::write(fd, record.data(), record.size());
+    if (written == (ssize_t) record.size())
+        return true;
+    Logging::error("failed to record ", name, " in the result directory ", _directory);
+    // merge() stops reading at a partial record (e.g., of a full disk), nothing may follow it
+    if (written > 0 && (end < 0 || ftruncate(fd, end) != 0)) {
+        close(fd);
+        fd = -1;
+        generation++;  // the next record starts a new file
+    }
+    return false;
+}
+
+bool ResultSink::writeFile(const std::string &filename, const std::string &content) {
+    std::ofstream out(filename, std::ios_base::trunc | std::ios_base::binary);
+    if (!out.good()) {
+        Logging::error("failed to open ", filename, " for writing");
+        return false;
+    }
+    out << content;
+    return out.good();
+}
+
+int ResultSink::removeFiles(const std::string &pattern) {
+    glob_t globbuf;
+
+    glob(pattern.c_str(), 0, nullptr, &globbuf);
+    int nr = globbuf.gl_pathc;
+    for (int i = 0; i < nr; i++)
+        if (0 != unlink(globbuf.gl_pathv[i]))
+            fprintf(stderr, "E: Couldn't unlink %s: %m", globbuf.gl_pathv[i]);
+
+    globfree(&globbuf);
+    return nr;
+}
+
+size_t ResultSink::merge(const std::vector<std::string> &files) {
+    std::vector<std::string> sinks;
+    for (const std::string &file : files) {
+        if (!boost::filesystem::is_directory(file)) {
+            sinks.push_back(file);
+            continue;
+        }
+        std::vector<std::string> entries;
+        for (const auto &entry : boost::filesystem::directory_iterator(file)) {
+            const std::string path = entry.path().string();
+            if (path.size() > sinkSuffix.size()
+                && path.compare(path.size() - sinkSuffix.size(), sinkSuffix.size(), sinkSuffix)
+                       == 0)
+                entries.push_back(path);
+        }
+        std::sort(entries.begin(), entries.end());
+        sinks.insert(sinks.end(), entries.begin(), entries.end());
+    }
+
+    std::vector<Record> records;
+    for (size_t i = 0; i < sinks.size(); i++)
+        readRecords(sinks[i], i, records);
+    // records of the same process are in order already, others are interleaved by time
+    std::stable_sort(records.begin(), records.end(),
+                     [](const Record &a, const Record &b) { return a.time < b.time; });
+
+    std::vector<std::unique_ptr<std::ifstream>> in;
+    for (const std::string &sink : sinks)
+        in.emplace_back(new std::ifstream(sink, std::ios_base::binary));
+    size_t written = 0;
+    for (const Record &record : records) {
+        if (record.type == 'R') {
+            removeFiles(record.name);
+            continue;
+        }
+        std::string content(record.length, '\0');
+        std::ifstream &sink = *in[record.file];
+        sink.seekg(record.offset);
+        sink.read(&content[0], record.length);
+        if (!sink.good())
+            throw kconfig::IOException("could not read results " + sinks[record.file]);
+        if (writeFile(record.name, content))
+            written++;
+    }
+    return written;
+}
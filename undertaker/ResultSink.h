@@ -0,0 +1,113 @@
+/*
+ *   undertaker - result files collected in a few append-only files
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -*- mode: c++ -*-
+#ifndef result_sink_h__
+#define result_sink_h__
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+
+
+/**
+ * \brief Destination of the result files (defect reports, configurations)
+ *
+ * By default, each result is written to a file of its own and removed
+ * results are unlinked, like the jobs always did. Once the sink is
+ * enabled, results are appended as records to a single file per process
+ * in the sink directory instead, which saves the creation of many small
+ * files. merge() reproduces the files from the records later on.
+ *
+ * Each record is a header line 'F' (file) or 'R' (removal of the files
+ * matching a glob pattern), a timestamp and the lengths of the name and
+ * the content, tab separated, followed by the name and the content
+ * without separators. A record is appended with a single write, so it
+ * is either complete or the last one of a crashed process. A partial
+ * record of a failed write is truncated, or the process continues with
+ * a new file.
+ */
+class ResultSink {
+public:
+    //! the sink of this process, disabled until enable() is called
+    static ResultSink &getInstance();
+
+    /**
+     * Appends the results of this process to a file in 'directory'.
+     * @throws kconfig::IOException if 'directory' can't be created
+     */
+    void enable(const std::string &directory);
+    bool isEnabled() const { return !_directory.empty(); }
+
+    /**
+     * Stores 'content' as result file 'filename', false (and logged) on
+     * errors. While the results of the thread are held back (see
+     * deferTo), this always succeeds, commit() reports the errors then.
+     */
+    bool write(const std::string &filename, const std::string &content);
+
+    //! result files held back for a job, pairs of file name and content
+    typedef std::vector<std::pair<std::string, std::string>> Deferred;
+    /**
+     * Holds back the result files written by the calling thread in
+     * 'deferred' until they are passed to commit(), nullptr ends that.
+     * Used for jobs that may be abandoned after a timeout, their results
+     * must not show up later on. Removals are not held back.
+     */
+    static void deferTo(Deferred *deferred);
+    //! stores the result files held back in 'deferred', false if one of them failed
+    bool commit(const Deferred &deferred);
+
+    /**
+     * Removes the result files matching the glob 'pattern' (e.g., the
+     * ones of a previous run). Returns the number of removed files, or
+     * the number of recorded removals (1, or 0 on errors) if the sink
+     * is enabled, as the files are only removed by merge().
+     */
+    int remove(const std::string &pattern);
+
+    /**
+     * Writes the result files recorded in the sink files 'files', in
+     * the order they were recorded. Directories stand for the sink
+     * files in them. Returns the number of written files.
+     * @throws kconfig::IOException if a sink file can't be read
+     */
+    static size_t merge(const std::vector<std::string> &files);
+
+private:
+    ResultSink() = default;
+    ~ResultSink();
+    ResultSink(const ResultSink &) = delete;
+    ResultSink &operator=(const ResultSink &) = delete;
+
+    //! writes or removes directly, as if no sink were enabled
+    static bool writeFile(const std::string &filename, const std::string &content);
+    static int removeFiles(const std::string &pattern);
+
+    bool append(char type, const std::string &name, const std::string &content);
+
+    std::string _directory;
+    std::mutex lock;
+    int fd = -1;
+    pid_t pid = 0;  // of the process that opened 'fd', forked workers need their own file
+    unsigned int generation = 0;  // of the file of this process, see append()
+    uint64_t time = 0;  // of the last record
+};
+#endif
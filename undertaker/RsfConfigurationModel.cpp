@@ -24,14 +24,14 @@
 #endif
 
 #include "RsfConfigurationModel.h"
-#include "Tools.h"
 #include "StringJoiner.h"
+#include "ClauseList.h"
+#include "DependencyGraph.h"
 #include "RsfReader.h"
 #include "Logging.h"
 
 #include <boost/filesystem.hpp>
 #include <boost/regex.hpp>
-#include <stack>
 
 
 RsfConfigurationModel::RsfConfigurationModel(const std::string &filename) {
@@ -65,31 +65,26 @@ RsfConfigurationModel::RsfConfigurationModel(const std::string &filename) {
 RsfConfigurationModel::~RsfConfigurationModel() {
     delete _model;
     delete _rsf;
+    delete _graph;
+}
+
+const DependencyGraph &RsfConfigurationModel::graph() const {
+    std::call_once(_graph_once, [this]() {
+        _graph = new DependencyGraph(*_model);
+        Logging::debug("Compiled dependency graph of ", _name, ": ", _graph->size(), " items, ",
+                       _graph->components(), " components");
+    });
+    return *_graph;
 }
 
 void RsfConfigurationModel::extendWithInterestingItems(std::set<std::string> &workingSet) const {
-    std::stack<std::string> workingStack;
-    /* Initialize the working stack with the given elements */
-    for (const std::string &str : workingSet)
-        workingStack.push(str);
-    while (!workingStack.empty()) {
-        const std::string *item = _model->getValue(workingStack.top());
-        workingStack.pop();
-        if (item != nullptr && *item != "") {
-            for (const std::string &str : undertaker::itemsOfString(*item)) {
-                /* Item already seen? continue */
-                if (workingSet.count(str) == 0) {
-                    workingStack.push(str);
-                    workingSet.insert(str);
-                }
-            }
-        }
-    }
+    graph().extend(workingSet);
 }
 
 void RsfConfigurationModel::doIntersectPreprocess(std::set<std::string> &item_set,
                                                   StringJoiner &sj,
-                                                  std::set<std::string> *exclude_set) const {
+                                                  std::set<std::string> *exclude_set,
+                                                  kconfig::ClauseList *clauses) const {
     const StringList *always_on = getWhitelist();
     const StringList *always_off = getBlacklist();
 
@@ -107,8 +102,12 @@ void RsfConfigurationModel::doIntersectPreprocess(std::set<std::string> &item_se
     // For all symbols in 'item_set', retrieve the formula from the model and push it into sj.
     for (const std::string &str : item_set) {
         const std::string *item = _model->getValue(str);
-        if (item != nullptr && *item != "")
-            sj.push_back("(" + str + " -> (" + *item + "))");
+        if (item != nullptr && *item != "") {
+            const std::string formula = "(" + str + " -> (" + *item + "))";
+            sj.push_back(formula);
+            if (clauses)
+                clauses->push_back(getClause(formula));
+        }
     }
     // There is no point in adding the formulae of always_off items into sj, since we push the
     // negated always_off symbol into sj, false -> {true,false}
@@ -26,16 +26,25 @@
 
 #include "ConfigurationModel.h"
 
+#include <mutex>
+
 class RsfReader;
 class ItemRsfReader;
+class DependencyGraph;
 
 
 class RsfConfigurationModel : public ConfigurationModel {
     RsfReader *_model = nullptr;
     ItemRsfReader *_rsf = nullptr;
+    mutable DependencyGraph *_graph = nullptr;
+    mutable std::once_flag _graph_once;
+
+    //! the dependency graph of the model, compiled on first use
+    const DependencyGraph &graph() const;
 
     void doIntersectPreprocess(std::set<std::string> &start_items, StringJoiner &sj,
-                               std::set<std::string> *exclude_set) const final override;
+                               std::set<std::string> *exclude_set,
+                               kconfig::ClauseList *clauses) const final override;
 
     void addMetaValue(const std::string &key, const std::string &val) const final override;
 
@@ -43,6 +52,7 @@ public:
     //! Loads the configuration model from file
     //! \param filename filepath to the model file. (NB: The basename is taken as architecture name.)
     explicit RsfConfigurationModel(const std::string &filename);
+    //! adds all items the given items (transitively) depend on
     void extendWithInterestingItems(std::set<std::string> &) const;
 
     //! destructor
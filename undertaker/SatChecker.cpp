@@ -29,6 +29,9 @@
 #include "PumaConditionalBlock.h"
 #include "ConfigurationModel.h"
 #include "CnfConfigurationModel.h"
+#include "KconfigWhitelist.h"
+#include "QueryCache.h"
+#include "ResultSink.h"
 #include "Logging.h"
 #include "CNFBuilder.h"
 #include "exceptions/CNFBuilderError.h"
@@ -53,6 +56,9 @@ using kconfig::CNFBuilder;
 /* SatChecker                                                           */
 /************************************************************************/
 
+CNFBuilder::Encoding SatChecker::encoding = CNFBuilder::Encoding::TSEITIN;
+SatChecker::Slicing SatChecker::slicing = SatChecker::Slicing::OFF;
+
 bool SatChecker::check(const std::string &sat) {
     SatChecker c;
     try {
@@ -66,39 +72,99 @@ bool SatChecker::check(const std::string &sat) {
 }
 
 SatChecker::SatChecker(const ConfigurationModel *model, Picosat::SATMode mode) {
+    // the model's formula is shared, not copied
     if (model && model->getModelVersionIdentifier() == "cnf")
         _cnf = make_unique<PicosatCNF>(
-            *dynamic_cast<const CnfConfigurationModel *>(model)->getCNF(), mode);
+            dynamic_cast<const CnfConfigurationModel *>(model)->getCNF(), mode);
     else
         _cnf = make_unique<PicosatCNF>(mode);
 }
 
 void SatChecker::loadCnfModel(const ConfigurationModel *m) {
-    _cnf->incrementWith(*dynamic_cast<const CnfConfigurationModel *>(m)->getCNF());
+    const PicosatCNF *model_cnf = dynamic_cast<const CnfConfigurationModel *>(m)->getCNF();
+    if (_cnf->getBase() != model_cnf)
+        _cnf->setBase(model_cnf);
+}
+
+void SatChecker::sliceModel() {
+    if (slicing != Slicing::OFF)
+        _cnf->setSliced(true, slicing == Slicing::VERIFY);
+}
+
+void SatChecker::cacheResults() {
+    if (_cached || !QueryCache::getInstance().isEnabled())
+        return;
+    _cached = true;
+    // ignored items are free variables in all formulas, so they are part of each query
+    static const uint64_t ignored = [] {
+        std::string items;
+        for (const std::string &item : KconfigWhitelist::getIgnorelist())
+            items += item + " ";
+        return QueryCache::hash("ignored: " + items);
+    }();
+    _formulas.push_back(ignored);
+}
+
+bool SatChecker::check() {
+    if (!_cached)
+        return _cnf->checkSatisfiable();
+    QueryCache &cache = QueryCache::getInstance();
+    const QueryCache::Key key = cache.key(_cnf->getBase(), _formulas);
+    bool satisfiable;
+    if (cache.lookup(key, satisfiable))
+        return satisfiable;
+    satisfiable = _cnf->checkSatisfiable();
+    cache.insert(key, satisfiable);
+    return satisfiable;
 }
 
 const SatChecker::AssignmentMap &SatChecker::getAssignment() {
-    for (const auto &entry : _cnf->getSymbolMap()) {  // pair<string, int>
-        bool selected = this->_cnf->deref(entry.second);
-        assignmentTable.emplace(entry.first, selected);
-    }
+    for (const PicosatCNF *layer = _cnf.get(); layer; layer = layer->getBase())
+        layer->forEachSymbol([this](const std::string &sym, int var) {
+            bool selected = this->_cnf->deref(var);
+            assignmentTable.emplace(sym, selected);
+        });
     return assignmentTable;
 }
 
 bool SatChecker::operator()(const std::string &formula) {
-    CNFBuilder builder(_cnf.get(), formula, true, CNFBuilder::ConstantPolicy::FREE);
+    CNFBuilder builder(_cnf.get(), formula, true, CNFBuilder::ConstantPolicy::FREE, encoding);
+    if (_cached)
+        _formulas.push_back(QueryCache::hash(formula));
+    return check();
+}
+
+bool SatChecker::operator()(const kconfig::ClauseList &clauses) {
+    CNFBuilder builder(_cnf.get(), "", true, CNFBuilder::ConstantPolicy::FREE, encoding);
+    builder.pushClauses(clauses);
+    if (_cached)
+        for (const kconfig::BoolExp *e : clauses)
+            _formulas.push_back(QueryCache::hash(e));
+    return check();
+}
+
+bool SatChecker::checkAssuming(std::map<std::string, bool> assumptions) {
+    _cnf->pushAssumptions(assumptions);
     return _cnf->checkSatisfiable();
 }
 
+std::set<std::string> SatChecker::getFailedAssumptions() const {
+    std::set<std::string> failed;
+    for (const int *lit = _cnf->failedAssumptions(); lit && *lit; lit++)
+        failed.insert(_cnf->getSymbolName(abs(*lit)));
+    return failed;
+}
+
 bool SatChecker::checkMUS() {
     // call picosat in quiet mode with stdin as input and stdout as output
     redi::pstream cmd_process("picomus - -");
     // write to stdin of the process
     cmd_process << "p cnf " << _cnf->getVarCount() << " " << _cnf->getClauseCount() << std::endl;
-    for (const int &clause : _cnf->getClauses()) {
-        char sep = (clause == 0) ? '\n' : ' ';
-        cmd_process << clause << sep;
-    }
+    for (const PicosatCNF *layer = _cnf.get(); layer; layer = layer->getBase())
+        for (const int &clause : layer->getClauses()) {
+            char sep = (clause == 0) ? '\n' : ' ';
+            cmd_process << clause << sep;
+        }
     // send eof and tell cmd_process we will start reading from stdout of cmd
     redi::peof(cmd_process);
     cmd_process.out();
@@ -158,25 +224,16 @@ void SatChecker::writeMUS(std::ostream &out, bool writeStatistics) const {
 /************************************************************************/
 
 void SatChecker::AssignmentMap::setEnabledBlocks(std::vector<bool> &blocks) {
-    static const boost::regex block_regexp("^B(\\d+)$");
     for (const auto &entry : *this) {  // pair<string, bool>
         const std::string &name = entry.first;
         const bool &valid = entry.second;
-        boost::smatch what;
-
-        if (!valid || !boost::regex_match(name, what, block_regexp))
-            continue;
-
-        // Follow hack from commit e1e7f90addb15257520937c7782710caf56d4101
-        if (what[1] == "00") {
-            // B00 is first and means the whole block
-            blocks[0] = true;
+        if (!valid)
             continue;
-        }
 
-        // B0 starts at index 1
-        int blockno = 1 + std::stoi(what[1]);
-        blocks[blockno] = true;
+        // B00 is first and means the whole block, B0 starts at index 1
+        const long index = undertaker::blockIndex(name);
+        if (index >= 0 && (unsigned long) index < blocks.size())
+            blocks[index] = true;
     }
 }
 
@@ -189,7 +246,6 @@ int SatChecker::AssignmentMap::formatKconfig(std::ostream &out,
     for (const auto &entry : *this) {  // pair<string, bool>
         static const boost::regex item_regexp("^CONFIG_(.*[^.])$");
         static const boost::regex module_regexp("^CONFIG_(.*)_MODULE$");
-        static const boost::regex block_regexp("^B\\d+$");
         static const boost::regex choice_regexp("^CONFIG_CHOICE_.*$");
         const std::string &name = entry.first;
         const bool &valid = entry.second;
@@ -243,7 +299,7 @@ int SatChecker::AssignmentMap::formatKconfig(std::ostream &out,
                 Logging::debug("Setting ", what[0], " to ", valid);
             }
 
-        } else if (boost::regex_match(name, block_regexp)) {
+        } else if (undertaker::blockIndex(name) >= 0) {
             // ignore block variables
             continue;
         } else {
@@ -320,13 +376,12 @@ int SatChecker::AssignmentMap::formatAll(std::ostream &out) const {
 
 int SatChecker::AssignmentMap::formatCPP(std::ostream &out,
                                          const ConfigurationModel *model) const {
-    static const boost::regex block_regexp("^B\\d+$");
     static const boost::regex valid_regexp("^[_a-zA-Z].*$");
 
     for (const auto &entry : *this) {  // pair<string, bool>
         const std::string &name = entry.first;
         // ignoring block variables
-        if (boost::regex_match(name, block_regexp))
+        if (undertaker::blockIndex(name) >= 0)
             continue;
 
         // ignoring symbols that can be defined
@@ -359,6 +414,7 @@ int SatChecker::AssignmentMap::formatCommented(std::ostream &out, const CppFile
     Puma::TokenStream stream;
     sighandler_t oldaction;
 
+    const auto parserLock = CppFile::lockParser();
     PumaConditionalBlock *topBlock = (PumaConditionalBlock *)file.topBlock();
     Puma::Unit *unit = topBlock->unit();
     if (!unit) {
@@ -454,23 +510,20 @@ int SatChecker::AssignmentMap::formatCommented(std::ostream &out, const CppFile
 int SatChecker::AssignmentMap::formatCombined(const CppFile &file, const ConfigurationModel *model,
                                               const MissingSet &missingSet,
                                               unsigned number) const {
-    std::stringstream s;
-    s << file.getFilename() << ".cppflags" << number;
+    ResultSink &sink = ResultSink::getInstance();
+    const std::string suffix = std::to_string(number);
 
-    std::ofstream modelstream(s.str());
+    std::ostringstream modelstream;
     formatCPP(modelstream, model);
+    sink.write(file.getFilename() + ".cppflags" + suffix, modelstream.str());
 
-    s.str("");
-    s.clear();
-    s << file.getFilename() << ".source" << number;
-    std::ofstream commented(s.str());
+    std::ostringstream commented;
     formatCommented(commented, file);
+    sink.write(file.getFilename() + ".source" + suffix, commented.str());
 
-    s.str("");
-    s.clear();
-    s << file.getFilename() << ".config" << number;
-    std::ofstream kconfig(s.str());
+    std::ostringstream kconfig;
     formatKconfig(kconfig, missingSet);
+    sink.write(file.getFilename() + ".config" + suffix, kconfig.str());
 
     return size();
 }
@@ -485,50 +538,112 @@ int SatChecker::AssignmentMap::formatExec(const CppFile &file, const char *cmd)
     return size();
 }
 
-void SatChecker::pprintAssignments(std::ostream &out,
-                                   const std::list<SatChecker::AssignmentMap> solutions,
-                                   const ConfigurationModel *model, const MissingSet &missingSet) {
-    out << "I: Found " << solutions.size() << " assignments" << std::endl;
-    out << "I: Entries in missingSet: " << missingSet.size() << std::endl;
+/************************************************************************/
+/* SatChecker::AssignmentProjection                                     */
+/************************************************************************/
 
-    std::map<std::string, bool> common_subset;
+void SatChecker::AssignmentProjection::Bits::set(long bit, bool val) {
+    if (bit < 0)
+        return;
+    const size_t word = bit / 64;
+    if (assigned.size() <= word) {
+        assigned.resize(word + 1);
+        value.resize(word + 1);
+    }
+    const uint64_t mask = uint64_t(1) << (bit % 64);
+    assigned[word] |= mask;
+    if (val)
+        value[word] |= mask;
+    else
+        value[word] &= ~mask;
+}
 
-    for (const auto &conf : solutions) {  // AssignmentMap
-        for (const auto &entry : conf) {  // pair<string, bool>
-            const std::string &name = entry.first;
-            const bool &valid = entry.second;
+bool SatChecker::AssignmentProjection::Bits::isAssigned(long bit) const {
+    return test(assigned, bit);
+}
 
-            if (model && !model->inConfigurationSpace(name))
-                continue;
+bool SatChecker::AssignmentProjection::Bits::operator==(const Bits &other) const {
+    // the vectors may differ in length, the missing words are 0
+    auto equal = [](const std::vector<uint64_t> &a, const std::vector<uint64_t> &b) {
+        for (size_t i = 0; i < std::max(a.size(), b.size()); i++)
+            if ((i < a.size() ? a[i] : 0) != (i < b.size() ? b[i] : 0))
+                return false;
+        return true;
+    };
+    return equal(assigned, other.assigned) && equal(value, other.value);
+}
 
-            if (conf == solutions.front()) {
-                // Copy first assignment to common subset map
-                common_subset[name] = valid;
-            } else {
-                if (common_subset.find(name) != common_subset.end()
-                    && common_subset[name] != valid) {
-                    // In this assignment the symbol has a different
-                    // value, remove it from the common subset map
-                    common_subset.erase(name);
-                }
-            }
-        }
+size_t SatChecker::AssignmentProjection::Hash::operator()(const Bits &bits) const {
+    // trailing zero words are skipped, equal projections of different lengths hash equally
+    size_t words = bits.assigned.size();
+    while (words > 0 && bits.assigned[words - 1] == 0)
+        words--;
+    uint64_t hash = 0;
+    for (size_t i = 0; i < words; i++) {
+        hash = (hash ^ bits.assigned[i]) * 0x9e3779b97f4a7c15ULL;
+        hash = (hash ^ bits.value[i]) * 0x9e3779b97f4a7c15ULL;
+        hash ^= hash >> 29;
     }
+    return hash;
+}
 
-    // Remove all items from common subset, that are not in all assignments
-    for (const auto &entry : common_subset) {  // pair<string, bool>
-        const std::string &name = entry.first;
-        for (auto &conf : solutions) {  // AssignmentMap
-            if (conf.find(name) == conf.end())
-                common_subset.erase(name);
+long SatChecker::AssignmentProjection::bit(const std::string &name) {
+    const auto it = _bits.find(name);
+    if (it != _bits.end())
+        return it->second;
+    const long bit = _filter(name) ? _next++ : -1;
+    _bits.emplace(name, bit);
+    return bit;
+}
+
+SatChecker::AssignmentProjection::Bits
+SatChecker::AssignmentProjection::project(const AssignmentMap &assignment) {
+    Bits bits;
+    for (const auto &entry : assignment)  // pair<string, bool>
+        bits.set(bit(entry.first), entry.second);
+    return bits;
+}
+
+SatChecker::AssignmentProjection::Bits
+SatChecker::AssignmentProjection::common(const std::list<Bits> &projections) {
+    if (projections.empty())
+        return Bits();
+    Bits result = projections.front();
+    for (const Bits &bits : projections) {
+        for (size_t i = 0; i < result.assigned.size(); i++) {
+            const uint64_t assigned = i < bits.assigned.size() ? bits.assigned[i] : 0;
+            const uint64_t value = i < bits.value.size() ? bits.value[i] : 0;
+            // assigned in both, with the same value
+            result.assigned[i] &= assigned & ~(result.value[i] ^ value);
+            result.value[i] &= result.assigned[i];
         }
     }
+    return result;
+}
+
+void SatChecker::pprintAssignments(std::ostream &out,
+                                   const std::list<SatChecker::AssignmentMap> solutions,
+                                   const ConfigurationModel *model, const MissingSet &missingSet) {
+    out << "I: Found " << solutions.size() << " assignments" << std::endl;
+    out << "I: Entries in missingSet: " << missingSet.size() << std::endl;
+
+    AssignmentProjection projection([model](const std::string &name) {
+        return !model || model->inConfigurationSpace(name);
+    });
+    std::list<AssignmentProjection::Bits> projections;
+    for (const auto &conf : solutions)  // AssignmentMap
+        projections.push_back(projection.project(conf));
+    const AssignmentProjection::Bits common = AssignmentProjection::common(projections);
 
     out << "I: In all assignments the following symbols are equally set" << std::endl;
-    for (const auto &entry : common_subset) {  // pair<string, bool>
-        const std::string &name = entry.first;
-        const bool &valid = entry.second;
-        out << name << "=" << (valid ? 1 : 0) << std::endl;
+    if (!solutions.empty()) {
+        // the common symbols are part of every assignment, also of the first one
+        for (const auto &entry : solutions.front()) {  // pair<string, bool>
+            const std::string &name = entry.first;
+            const bool &valid = entry.second;
+            if (common.isAssigned(projection.bit(name)))
+                out << name << "=" << (valid ? 1 : 0) << std::endl;
+        }
     }
 
     out << "I: All differences in the assignments" << std::endl;
@@ -538,11 +653,10 @@ void SatChecker::pprintAssignments(std::ostream &out,
         for (const auto &entry : conf) {  // pair<string, bool>
             const std::string &name = entry.first;
             const bool &valid = entry.second;
+            const long bit = projection.bit(name);
 
-            if (model && !model->inConfigurationSpace(name))
-                continue;
-
-            if (common_subset.find(name) != common_subset.end())
+            // not in the configuration space or in the common subset
+            if (bit < 0 || common.isAssigned(bit))
                 continue;
 
             out << name << "=" << (valid ? 1 : 0) << std::endl;
@@ -569,5 +683,6 @@ bool BaseExpressionSatChecker::operator()(const std::set<std::string> &assumeSym
 BaseExpressionSatChecker::BaseExpressionSatChecker(std::string base_expression,
                                                    const ConfigurationModel *model)
         : SatChecker(model) {
-    CNFBuilder builder(_cnf.get(), base_expression, true, CNFBuilder::ConstantPolicy::BOUND);
+    CNFBuilder builder(_cnf.get(), base_expression, true, CNFBuilder::ConstantPolicy::BOUND,
+                       encoding);
 }
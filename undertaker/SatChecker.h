@@ -27,11 +27,16 @@
 #define sat_checker_h__
 
 #include "PicosatCNF.h"
+#include "CNFBuilder.h"
+#include "ClauseList.h"
 
 #include <map>
 #include <set>
 #include <list>
+#include <functional>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 typedef std::set<std::string> MissingSet;
 
@@ -65,8 +70,40 @@ public:
      */
     bool operator()(const std::string &formula);
 
+    /**
+     * Checks the conjunction of the given formulas with an sat solver.
+     * Equivalent to checking their joined string, but without printing
+     * and parsing it.
+     * @param clauses the formulas to be checked
+     * @returns true, if satisfiable, false otherwise
+     */
+    bool operator()(const kconfig::ClauseList &clauses);
+
     static bool check(const std::string &sat);
 
+    //! CNF encoding of the formulas given to operator() and BaseExpressionSatChecker
+    static kconfig::CNFBuilder::Encoding encoding;
+
+    //! cone-of-influence slicing of cnf models, see sliceModel()
+    enum class Slicing {OFF, ON, VERIFY};
+    static Slicing slicing;
+
+    /**
+     * Lets this checker solve only the part of a cnf model that is
+     * connected to the checked formulas, if enabled by 'slicing'. Only
+     * for checkers whose assignments are never used.
+     * See PicosatCNF::setSliced.
+     */
+    void sliceModel();
+
+    /**
+     * Lets this checker look up the results of operator() in the
+     * QueryCache and store them there, if the cache is enabled. The
+     * solver isn't called on hits, so only for checkers whose
+     * assignments are never used.
+     */
+    void cacheResults();
+
     /**
      * \brief Representation of a variable selection
      *
@@ -181,6 +218,53 @@ public:
             const MissingSet& missingSet, unsigned number) const;
     }; // end struct AssignmentMap
 
+    /**
+     * \brief Assignments projected onto some of their variables, as bit vectors
+     *
+     * Each variable accepted by the filter gets the next bit, the filter
+     * is asked only once per variable. Comparing, hashing and
+     * intersecting the projections are word operations then, instead
+     * of walking and copying the string maps of the assignments.
+     */
+    class AssignmentProjection {
+    public:
+        //! a projected assignment, bits of variables it doesn't contain are 0
+        struct Bits {
+            std::vector<uint64_t> assigned, value;
+
+            void set(long bit, bool val);
+            bool isAssigned(long bit) const;
+            bool getValue(long bit) const { return isAssigned(bit) && test(value, bit); }
+            bool operator==(const Bits &other) const;
+
+            static bool test(const std::vector<uint64_t> &bits, long bit) {
+                return bit >= 0 && (size_t) bit / 64 < bits.size()
+                    && (bits[bit / 64] >> (bit % 64) & 1);
+            }
+        };
+        struct Hash {
+            size_t operator()(const Bits &bits) const;
+        };
+
+        explicit AssignmentProjection(std::function<bool(const std::string &)> filter)
+            : _filter(filter) {}
+
+        //! the bit of 'name', -1 if it isn't projected
+        long bit(const std::string &name);
+        Bits project(const AssignmentMap &assignment);
+
+        /**
+         * the variables with the same value in all 'projections', as
+         * 'assigned' and 'value' bits; empty if 'projections' is empty
+         */
+        static Bits common(const std::list<Bits> &projections);
+
+    private:
+        std::function<bool(const std::string &)> _filter;
+        std::unordered_map<std::string, long> _bits;
+        long _next = 0;
+    };
+
     // After doing the check, you can get the assignments for the formula
     const AssignmentMap &getAssignment();
 
@@ -190,12 +274,33 @@ public:
 
     void loadCnfModel(const ConfigurationModel *);
 
+    /**
+     * Checks the formulas added so far with the given symbols set to the
+     * given values. The assumptions only hold for this single check.
+     * @param assumptions symbol -> value, all symbols must already be known
+     * @returns true, if satisfiable, false otherwise
+     */
+    bool checkAssuming(std::map<std::string, bool> assumptions);
+
+    /**
+     * After a check with assumptions failed, the names of the assumed
+     * variables that caused the conflict. The set is not necessarily
+     * minimal; it is empty if the formula is unsatisfiable on its own.
+     */
+    std::set<std::string> getFailedAssumptions() const;
+
     bool checkMUS();
     void writeMUS(std::ostream &out, bool writeStatistics = true) const;
 
 protected:
     std::unique_ptr<kconfig::PicosatCNF> _cnf;
     AssignmentMap assignmentTable;
+    //! hashes of the formulas given to operator() if results are cached
+    std::vector<uint64_t> _formulas;
+    bool _cached = false;
+
+    //! checks the formulas added so far, with the cache if enabled by cacheResults()
+    bool check();
 };
 
 /************************************************************************/
@@ -0,0 +1,136 @@
+/*
+ *   undertaker - process-wide table of interned symbol names
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SymbolTable.h"
+
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+
+namespace {
+    /*
+     * Names are stored in chunks that are never moved, so name() can read
+     * them without taking the lock. An id is only handed out after its
+     * name has been stored.
+     *
+     * lookup() doesn't take the lock either: the slots of the index are
+     * only ever set once, and a grown index is filled completely before
+     * it is published. Replaced indexes are kept until the end of the
+     * process, as readers may still be probing them. A reader on an
+     * outdated index may miss a name that is just being interned, which
+     * is indistinguishable from looking it up a moment earlier.
+     */
+    const unsigned int chunk_bits = 14;
+    const size_t chunk_size = 1 << chunk_bits;
+    const size_t max_chunks = 1 << 12;
+
+    //! open addressing index over the names, size is a power of two
+    struct Index {
+        std::vector<std::atomic<SymbolId>> slots;
+        explicit Index(size_t size) : slots(size) {}
+    };
+
+    struct Table {
+        std::atomic<std::string *> chunks[max_chunks];
+        std::atomic<size_t> count{0};  // ids 1 .. count are in use
+        std::atomic<Index *> index;
+        std::vector<std::unique_ptr<Index>> indexes;  // the current one and all replaced ones
+        std::mutex lock;  // serializes intern()
+
+        Table() {
+            for (auto &chunk : chunks)
+                chunk = nullptr;
+            indexes.emplace_back(new Index(1 << 16));
+            index = indexes.back().get();
+        }
+        ~Table() {
+            for (auto &chunk : chunks)
+                delete[] chunk.load();
+        }
+
+        const std::string &name(SymbolId id) const {
+            return chunks[id >> chunk_bits].load(std::memory_order_acquire)[id & (chunk_size - 1)];
+        }
+        //! returns the slot of 'str' in 'idx', which is 0 if 'str' isn't interned
+        size_t slot(const Index &idx, const std::string &str) const {
+            const size_t mask = idx.slots.size() - 1;
+            size_t i = std::hash<std::string>()(str) & mask;
+            SymbolId id;
+            while ((id = idx.slots[i].load(std::memory_order_acquire)) && name(id) != str)
+                i = (i + 1) & mask;
+            return i;
+        }
+        void rehash() {
+            const Index &old = *index.load(std::memory_order_relaxed);
+            std::unique_ptr<Index> grown(new Index(2 * old.slots.size()));
+            for (const std::atomic<SymbolId> &id : old.slots)
+                if (SymbolId i = id.load(std::memory_order_relaxed))
+                    grown->slots[slot(*grown, name(i))].store(i, std::memory_order_relaxed);
+            index.store(grown.get(), std::memory_order_release);
+            indexes.push_back(std::move(grown));
+        }
+    };
+
+    Table &table() {
+        static Table instance;
+        return instance;
+    }
+} // namespace
+
+SymbolId SymbolTable::lookup(const std::string &str) {
+    const Table &t = table();
+    const Index &idx = *t.index.load(std::memory_order_acquire);
+    return idx.slots[t.slot(idx, str)].load(std::memory_order_acquire);
+}
+
+SymbolId SymbolTable::intern(const std::string &str) {
+    if (SymbolId id = lookup(str))
+        return id;
+
+    Table &t = table();
+    std::lock_guard<std::mutex> guard(t.lock);
+    Index &idx = *t.index.load(std::memory_order_relaxed);
+    size_t i = t.slot(idx, str);
+    if (SymbolId id = idx.slots[i].load(std::memory_order_relaxed))  // interned by another thread
+        return id;
+
+    SymbolId id = t.count + 1;
+    assert((id >> chunk_bits) < max_chunks);
+    std::atomic<std::string *> &chunk = t.chunks[id >> chunk_bits];
+    if (!chunk.load())
+        chunk.store(new std::string[chunk_size], std::memory_order_release);
+    chunk.load()[id & (chunk_size - 1)] = str;
+    t.count = id;
+
+    // publishes the name stored above to lookup()
+    idx.slots[i].store(id, std::memory_order_release);
+    if (2 * t.count > idx.slots.size())
+        t.rehash();
+    return id;
+}
+
+const std::string &SymbolTable::name(SymbolId id) {
+    assert(id > 0 && id <= table().count);
+    return table().name(id);
+}
+
+size_t SymbolTable::size() {
+    return table().count;
+}
@@ -0,0 +1,139 @@
+/*
+ *   undertaker - process-wide table of interned symbol names
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -*- mode: c++ -*-
+#ifndef symbol_table_h__
+#define symbol_table_h__
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+//! dense id of an interned symbol name, 0 is never handed out
+typedef uint32_t SymbolId;
+
+/**
+ * \brief Interns symbol names and hands out dense integer ids
+ *
+ * Each distinct name gets an id once and keeps it for the lifetime of
+ * the process, so ids can be compared and hashed instead of strings.
+ * All methods are thread-safe, only intern() of a new name takes a lock.
+ * The reference returned by name() stays valid forever.
+ */
+namespace SymbolTable {
+    //! returns the id of 'name', a new one if it wasn't interned before
+    SymbolId intern(const std::string &name);
+    //! returns the id of 'name' or 0 if it was never interned
+    SymbolId lookup(const std::string &name);
+    const std::string &name(SymbolId id);
+    //! number of interned names
+    size_t size();
+} // namespace SymbolTable
+
+/**
+ * \brief Hash map from SymbolIds to 'T' with open addressing
+ *
+ * Slots are kept in a single flat vector and probed linearly. There is
+ * no erase, the map only grows (or is cleared).
+ */
+template <typename T>
+class SymbolMap {
+    struct Slot {
+        SymbolId key;
+        T value;
+    };
+    std::vector<Slot> slots;  // size is 0 or a power of two
+    size_t used = 0;
+
+    size_t index(SymbolId id) const {
+        // multiplying with an odd constant spreads the dense ids over the table
+        return (id * 2654435769u) & (slots.size() - 1);
+    }
+    void grow() {
+        std::vector<Slot> old(slots.size() ? 2 * slots.size() : 16, Slot{0, T()});
+        old.swap(slots);
+        for (Slot &slot : old)
+            if (slot.key) {
+                size_t i = index(slot.key);
+                while (slots[i].key)
+                    i = (i + 1) & (slots.size() - 1);
+                slots[i] = std::move(slot);
+            }
+    }
+
+public:
+    const T *find(SymbolId id) const {
+        if (slots.empty())
+            return nullptr;
+        for (size_t i = index(id); slots[i].key; i = (i + 1) & (slots.size() - 1))
+            if (slots[i].key == id)
+                return &slots[i].value;
+        return nullptr;
+    }
+    T *find(SymbolId id) {
+        return const_cast<T *>(static_cast<const SymbolMap *>(this)->find(id));
+    }
+    //! returns the value for 'id', inserts a default constructed one if there is none
+    T &operator[](SymbolId id) {
+        if (2 * (used + 1) > slots.size())
+            grow();
+        size_t i = index(id);
+        while (slots[i].key && slots[i].key != id)
+            i = (i + 1) & (slots.size() - 1);
+        if (!slots[i].key) {
+            slots[i].key = id;
+            used++;
+        }
+        return slots[i].value;
+    }
+    size_t size() const { return used; }
+    bool empty() const { return used == 0; }
+    void clear() {
+        slots.clear();
+        used = 0;
+    }
+    void swap(SymbolMap &other) {
+        slots.swap(other.slots);
+        std::swap(used, other.used);
+    }
+    //! calls 'f(id, value)' for all entries in no particular order
+    template <typename F>
+    void forEach(F f) const {
+        for (const Slot &slot : slots)
+            if (slot.key)
+                f(slot.key, slot.value);
+    }
+};
+
+//! set of SymbolIds, see SymbolMap
+class SymbolSet {
+    SymbolMap<bool> map;
+
+public:
+    //! returns true if 'id' wasn't in the set yet
+    bool insert(SymbolId id) {
+        bool &present = map[id];
+        bool inserted = !present;
+        present = true;
+        return inserted;
+    }
+    bool contains(SymbolId id) const { return map.find(id) != nullptr; }
+    size_t size() const { return map.size(); }
+};
+
+#endif
@@ -34,6 +34,7 @@ void kconfig::SymbolTranslator::pushSymbolInfo(struct symbol *sym) {
 }
 
 void kconfig::SymbolTranslator::visit_bool_symbol(struct symbol *sym) {
+    BoolExpFactory::Scope scope(nodes);
     if (!sym)
         return;
 
@@ -88,6 +89,7 @@ void kconfig::SymbolTranslator::visit_bool_symbol(struct symbol *sym) {
 };
 
 void kconfig::SymbolTranslator::visit_tristate_symbol(struct symbol *sym) {
+    BoolExpFactory::Scope scope(nodes);
     ExpressionTranslator expTranslator(this->symbolSet);
     expr *rev = reverseDepExpression(sym);
     expr *vis = visibilityExpression(sym);
@@ -188,6 +190,7 @@ void kconfig::SymbolTranslator::visit_string_symbol(struct symbol *sym) {
 }
 
 void kconfig::SymbolTranslator::visit_choice_symbol(struct symbol *sym) {
+    BoolExpFactory::Scope scope(nodes);
     ExpressionTranslator expTranslator(this->symbolSet);
     TristateRepr transChoice = expTranslator.process(choiceExpression(sym));
     BoolExp &f1yes = *B_VAR(sym, rel_yes);
@@ -31,17 +31,25 @@ namespace kconfig {
         // statistic data
         int _featuresWithStringDep = 0;
         int _totalStringComp = 0;
+        //! shares the subformulas of all symbols, they are all pushed into the same CNF
+        BoolExpFactory nodes;
         CNFBuilder cnfbuilder;
 
         void addClause(BoolExp *clause);
         void pushSymbolInfo(struct symbol *sym);
     public:
-        explicit SymbolTranslator(PicosatCNF *cnf) : cnfbuilder(cnf) {}
+        explicit SymbolTranslator(PicosatCNF *cnf,
+                                  CNFBuilder::Encoding encoding = CNFBuilder::Encoding::TSEITIN)
+                : cnfbuilder(cnf, "", false, CNFBuilder::ConstantPolicy::BOUND, encoding) {
+            // all clauses live in 'nodes' until the translator is destroyed
+            cnfbuilder.keepVariables();
+        }
 
         std::set<struct symbol *> *symbolSet = nullptr;
 
         int featuresWithStringDependencies() { return _featuresWithStringDep; }
         int totalStringComparisons() { return _totalStringComp; }
+        CNFBuilder::Stats getStats() const { return cnfbuilder.getStats(); }
     protected:
         void visit_bool_symbol (struct symbol *sym)     final override;
         void visit_tristate_symbol (struct symbol *sym) final override;
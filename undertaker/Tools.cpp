@@ -17,16 +17,33 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "BoolExpSymbolSet.h"
 #include "Tools.h"
+#include "bool.h"
 
 #include <algorithm>
+#include <limits>
+#include <unordered_map>
+#include <boost/thread/shared_mutex.hpp>
 
-std::set<std::string> undertaker::itemsOfString(const std::string &str) {
-    kconfig::BoolExp *e = kconfig::BoolExp::parseString(str);
-    kconfig::BoolExpSymbolSet symset(e);
-    delete e;
-    return symset.getSymbolSet();
+std::shared_ptr<const std::set<std::string>>
+undertaker::itemsOfString(const std::string &str) {
+    // enough for the expressions of the files analyzed at the same time
+    static const size_t maxEntries = 1 << 16;
+    static std::unordered_map<std::string, std::shared_ptr<const std::set<std::string>>> cache;
+    static boost::shared_mutex lock;
+    {
+        boost::shared_lock<boost::shared_mutex> guard(lock);
+        const auto it = cache.find(str);
+        if (it != cache.end())
+            return it->second;
+    }
+    auto items = std::make_shared<const std::set<std::string>>(
+        kconfig::BoolExp::symbolsOfString(str));
+    boost::unique_lock<boost::shared_mutex> guard(lock);
+    // callers keep their sets, the expressions of the current files are cached again soon
+    if (cache.size() >= maxEntries)
+        cache.clear();
+    return cache.emplace(str, std::move(items)).first->second;
 }
 
 bool undertaker::ends_with(const std::string &val, const std::string &end) {
@@ -40,3 +57,19 @@ bool undertaker::starts_with(const std::string &val, const std::string &start) {
         return false;
     return std::equal(start.begin(), start.end(), val.begin());
 }
+
+long undertaker::blockIndex(const std::string &name) {
+    // called for each variable of each assignment, so no regex here
+    if (name.size() < 2 || name[0] != 'B')
+        return -1;
+    for (std::string::size_type i = 1; i < name.size(); i++)
+        if (name[i] < '0' || name[i] > '9')
+            return -1;
+    // B00 is the top level block, the others start with B0
+    if (name == "B00")
+        return 0;
+    // no file has that many blocks, but it still is a block variable
+    if (name.size() > 18)
+        return std::numeric_limits<long>::max();
+    return 1 + std::stol(name.substr(1));
+}
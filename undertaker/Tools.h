@@ -21,15 +21,30 @@
 #ifndef _UNDERTAKER_TOOLS_H_
 #define _UNDERTAKER_TOOLS_H_
 
+#include <memory>
 #include <string>
 #include <set>
 
 
 namespace undertaker {
-    //! returns all (configuration) items of the given string
-    std::set<std::string> itemsOfString(const std::string &);
+    /**
+     * returns all (configuration) items of the given string
+     *
+     * The items are scanned without building an expression tree and
+     * cached for each string, as the same expressions are looked up
+     * many times. The cache is emptied once it holds too many strings,
+     * the returned set stays valid nevertheless. Strings that are only
+     * looked up once should use kconfig::BoolExp::symbolsOfString.
+     */
+    std::shared_ptr<const std::set<std::string>> itemsOfString(const std::string &);
     //! returns true if 'val' ends with the substring 'end'
     bool ends_with(const std::string &val, const std::string &end);
     bool starts_with(const std::string &val, const std::string &start);
+    /**
+     * returns the index of the block variable 'name' ("B<number>") in
+     * its file, see ConditionalBlock::getIndex(), or -1 if 'name' is no
+     * such variable (e.g., an item or a block name with a file name)
+     */
+    long blockIndex(const std::string &name);
 } // namespace undertaker
 #endif
@@ -0,0 +1,81 @@
+/*
+ *   undertaker - thread pool for processing worklists in parallel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "WorkStealingPool.h"
+#include "cpp14.h"
+
+#include <thread>
+
+
+WorkStealingPool::WorkStealingPool(unsigned int workers) {
+    if (workers < 1)
+        workers = 1;
+    for (unsigned int i = 0; i < workers; i++)
+        _queues.push_back(make_unique<Queue>());
+}
+
+void WorkStealingPool::run(const std::vector<std::string> &items, const job_t &job) {
+    const size_t n = _queues.size();
+
+    // hand out contiguous chunks, the first 'items.size() % n' workers get one more item
+    auto it = items.begin();
+    for (size_t i = 0; i < n; i++) {
+        size_t chunk = items.size() / n + (i < items.size() % n ? 1 : 0);
+        for (size_t j = 0; j < chunk; j++, ++it)
+            _queues[i]->items.push_back(&(*it));
+    }
+
+    if (n == 1) {
+        work(0, job);
+        return;
+    }
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < n; i++)
+        threads.emplace_back(&WorkStealingPool::work, this, i, std::cref(job));
+    for (std::thread &t : threads)
+        t.join();
+}
+
+const std::string *WorkStealingPool::next(unsigned int self) {
+    const size_t n = _queues.size();
+    {
+        Queue &own = *_queues[self];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.items.empty()) {
+            const std::string *item = own.items.front();
+            own.items.pop_front();
+            return item;
+        }
+    }
+    // nothing left in our own queue, try to steal from the others
+    for (size_t i = 1; i < n; i++) {
+        Queue &victim = *_queues[(self + i) % n];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.items.empty()) {
+            const std::string *item = victim.items.back();
+            victim.items.pop_back();
+            return item;
+        }
+    }
+    // no new items are added while running, so all work is handed out
+    return nullptr;
+}
+
+void WorkStealingPool::work(unsigned int self, const job_t &job) {
+    while (const std::string *item = next(self))
+        job(*item);
+}
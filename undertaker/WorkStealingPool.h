@@ -0,0 +1,67 @@
+/*
+ *   undertaker - thread pool for processing worklists in parallel
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -*- mode: c++ -*-
+#ifndef work_stealing_pool_h__
+#define work_stealing_pool_h__
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+/**
+ * \brief Processes a list of work items on a fixed number of threads
+ *
+ * Every worker thread owns a queue, which initially holds a contiguous
+ * chunk of the work items (neighbouring files in a worklist tend to
+ * share headers and models). A worker takes items from the front of
+ * its own queue. When it runs dry, it steals from the back of the other
+ * queues, so a few expensive files don't leave the remaining threads
+ * idle.
+ */
+class WorkStealingPool {
+public:
+    typedef std::function<void(const std::string &)> job_t;
+
+    //! \param workers number of threads, at least one is used
+    explicit WorkStealingPool(unsigned int workers);
+
+    /**
+     * Calls 'job' exactly once for every entry in 'items' and returns
+     * once all calls have finished. 'job' is called concurrently from
+     * different threads and must not throw.
+     */
+    void run(const std::vector<std::string> &items, const job_t &job);
+
+    unsigned int workers() const { return _queues.size(); }
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<const std::string *> items;
+    };
+    std::vector<std::unique_ptr<Queue>> _queues;
+
+    const std::string *next(unsigned int self);
+    void work(unsigned int self, const job_t &job);
+};
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ *   bench-BoolExpParser - measures how fast the formulas of models are parsed
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RsfReader.h"
+#include "bool.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace kconfig;
+
+
+static void usage(void) {
+    std::cerr << "bench-BoolExpParser [-n <rounds>] <model>..." << std::endl;
+    std::cerr << "  -n <rounds>  parse all formulas this many times (default: 10)" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "Parses each formula of the models as rsf2cnf does ('ITEM -> (formula)')"
+              << std::endl;
+    std::cerr << "and prints the throughput." << std::endl;
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int rounds = 10;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            rounds = std::atoi(optarg);
+            break;
+        default:
+            usage();
+        }
+    }
+    if (optind >= argc || rounds < 1)
+        usage();
+
+    std::vector<std::string> formulas;
+    size_t bytes = 0;
+    for (int i = optind; i < argc; i++) {
+        RsfReader model(argv[i]);
+        for (const auto &entry : model) {  // pair<string, string>
+            if (entry.second.empty())
+                continue;
+            formulas.emplace_back(entry.first + " -> (" + entry.second + ")");
+            bytes += formulas.back().size();
+        }
+    }
+
+    size_t failed = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (const std::string &formula : formulas) {
+            BoolExp *exp = BoolExp::parseString(formula);
+            if (!exp)
+                failed++;
+            delete exp;
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const double seconds = elapsed.count() > 0 ? elapsed.count() : 1e-9;
+
+    std::cout << "formulas:      " << formulas.size() << " (" << bytes << " bytes)" << std::endl;
+    std::cout << "rounds:        " << rounds << std::endl;
+    std::cout << "syntax errors: " << failed / rounds << std::endl;
+    std::cout << "time:          " << seconds << " s" << std::endl;
+    std::cout << "formulas/s:    " << formulas.size() * rounds / seconds << std::endl;
+    std::cout << "MB/s:          " << bytes * rounds / seconds / 1e6 << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -20,14 +20,12 @@
  */
 
 #include "bool.h"
-#include "exceptions/BoolExpParserException.h"
 #include "BoolExpGC.h"
 #include "BoolExpSimplifier.h"
 #include "BoolExpStringBuilder.h"
-#include "BoolExpLexer.h"
 
+#include <cstddef>
 #include <typeinfo> // for typeid()
-#include <sstream>
 
 
 /************************************************************************/
@@ -208,7 +206,7 @@ void kconfig::BoolExpConst::accept(kconfig::BoolVisitor *visitor) {
 }
 
 kconfig::BoolExpConst *kconfig::BoolExpConst::getInstance(bool val) {
-    return new kconfig::BoolExpConst(val);
+    return BoolExpFactory::make<BoolExpConst>(val);
 }
 
 void kconfig::BoolExpVar::accept(kconfig::BoolVisitor *visitor) {
@@ -228,7 +226,9 @@ void kconfig::BoolExpCall::accept(kconfig::BoolVisitor *visitor) {
 /************************************************************************/
 
 bool kconfig::BoolExp::equals(const BoolExp *other) const {
-    if (other == nullptr || typeid(*other) != typeid(*this)) {
+    if (other == this) {
+        return true;
+    } else if (other == nullptr || typeid(*other) != typeid(*this)) {
         return false;
     } else {
         return ((this->left == other->left || this->left->equals(other->left))
@@ -252,6 +252,8 @@ bool kconfig::BoolExpCall::equals(const BoolExp *other) const {
 }
 
 bool kconfig::BoolExpVar::equals(const BoolExp *other) const {
+    if (other == this)
+        return true;
     const BoolExpVar *otherv = dynamic_cast<const BoolExpVar *>(other);
     return otherv != nullptr && this->name == otherv->name;
 }
@@ -280,22 +282,6 @@ kconfig::BoolExp::~BoolExp() {
     }
 }
 
-kconfig::BoolExp *kconfig::BoolExp::parseString(std::string s) {
-    BoolExp *result;
-    std::stringstream ins(s);
-    BoolExpLexer lexer(&ins, nullptr);
-
-    BoolExpParser parser(&result, &lexer);
-    try {
-        if (parser.parse() == 0) {
-            return result;
-        }
-    } catch (BoolExpParserException *e) {
-        return nullptr;
-    }
-    return nullptr;
-}
-
 std::string kconfig::BoolExp::str(void) {
     BoolExpStringBuilder sb;
     this->accept(&sb);
@@ -308,6 +294,57 @@ kconfig::BoolExp *kconfig::BoolExp::simplify() {
     return sim.getResult();
 }
 
+/************************************************************************/
+/* BoolExpFactory                                                       */
+/************************************************************************/
+
+static thread_local kconfig::BoolExpFactory *current_factory = nullptr;
+
+kconfig::BoolExpFactory::Scope::Scope(BoolExpFactory &factory) : previous(current_factory) {
+    current_factory = &factory;
+}
+
+kconfig::BoolExpFactory::Scope::~Scope() {
+    current_factory = previous;
+}
+
+kconfig::BoolExpFactory *kconfig::BoolExpFactory::current() {
+    return current_factory;
+}
+
+kconfig::BoolExpFactory::~BoolExpFactory() {
+    // the nodes are marked, so their destructors don't touch the children
+    for (auto it = nodes.rbegin(); it != nodes.rend(); ++it)  // BoolExp *
+        (*it)->~BoolExp();
+}
+
+size_t kconfig::BoolExpFactory::KeyHash::operator()(const Key &key) const {
+    size_t h = key.kind->hash_code();
+    for (size_t v : {(size_t) key.left, (size_t) key.right, (size_t) key.name,
+                     (size_t) key.discriminator})
+        h = (h ^ v) * 1099511628211u;
+    return h;
+}
+
+kconfig::BoolExp *&kconfig::BoolExpFactory::lookup(const BoolExp &probe, int discriminator) {
+    const std::string &name = probe.getName();
+    Key key{&typeid(probe), probe.left, probe.right,
+            name.empty() ? 0 : SymbolTable::intern(name), discriminator};
+    return unique[key];
+}
+
+void *kconfig::BoolExpFactory::allocate(size_t size) {
+    const size_t align = alignof(std::max_align_t);
+    size = (size + align - 1) & ~(align - 1);
+    if (blockUsed + size > BlockSize) {
+        blocks.emplace_back(new char[BlockSize]);
+        blockUsed = 0;
+    }
+    void *p = blocks.back().get() + blockUsed;
+    blockUsed += size;
+    return p;
+}
+
 /************************************************************************/
 /* Operators                                                            */
 /************************************************************************/
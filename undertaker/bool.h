@@ -25,16 +25,25 @@
 #define KCONFIG_BOOL_H
 
 #include "SymbolTools.h"
+#include "SymbolTable.h"
 
 #include <string>
 #include <list>
+#include <memory>
+#include <new>
 #include <ostream>
-
-#define B_AND new kconfig::BoolExpAnd
-#define B_OR new kconfig::BoolExpOr
-#define B_NOT new kconfig::BoolExpNot
-#define B_IMPL new kconfig::BoolExpImpl
-#define B_VAR new kconfig::BoolExpVar
+#include <set>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#define B_AND kconfig::BoolExpFactory::make<kconfig::BoolExpAnd>
+#define B_OR kconfig::BoolExpFactory::make<kconfig::BoolExpOr>
+#define B_NOT kconfig::BoolExpFactory::make<kconfig::BoolExpNot>
+#define B_IMPL kconfig::BoolExpFactory::make<kconfig::BoolExpImpl>
+#define B_EQ kconfig::BoolExpFactory::make<kconfig::BoolExpEq>
+#define B_VAR kconfig::BoolExpFactory::make<kconfig::BoolExpVar>
 #define B_CONST(v) (kconfig::BoolExpConst::getInstance(v))
 
 
@@ -56,7 +65,6 @@ namespace kconfig {
         bool gcMarked = false;
         BoolExp *left = nullptr;
         BoolExp *right = nullptr;
-        int CNFVar = 0;
 
         BoolExp() = default;
         virtual ~BoolExp();
@@ -69,7 +77,14 @@ namespace kconfig {
         virtual bool equals(const BoolExp *other) const;
         virtual void accept(BoolVisitor *visitor);
 
-        static BoolExp *parseString(std::string);
+        //! returns the parsed 's' or nullptr on syntax errors, see BoolExpParser.cpp
+        static BoolExp *parseString(const std::string &s);
+        /**
+         * returns the names of the variables in 's', like a
+         * BoolExpSymbolSet of the parsed 's', but without building the
+         * tree; empty on syntax errors
+         */
+        static std::set<std::string> symbolsOfString(const std::string &s);
     };
 
 /************************************************************************/
@@ -183,6 +198,7 @@ namespace kconfig {
 /************************************************************************/
 
     class BoolExpConst : public BoolExp {
+        friend class BoolExpFactory;
         explicit BoolExpConst(bool val) : value(val) {}
 
     public:
@@ -220,6 +236,96 @@ namespace kconfig {
         bool equals(const BoolExp *other) const final override;
     };
 
+/************************************************************************/
+/* BoolExpFactory                                                       */
+/************************************************************************/
+
+    /**
+     * \brief Hash-consing allocator for BoolExp nodes
+     *
+     * While a Scope is active, the B_* macros (and thus the operators
+     * below) don't allocate a new node for each call, but look the node
+     * up by (kind, children, name, relation/value) in the factory's
+     * unique table. Structurally equal subformulas are therefore built
+     * only once and shared, so they can be compared with '==' and are
+     * encoded with a single CNF variable by the CNFBuilder.
+     *
+     * All nodes live in the factory's arena and are freed together when
+     * the factory is destroyed. They must never be deleted on their own.
+     * Without an active Scope, the macros allocate with 'new' as before.
+     */
+    class BoolExpFactory {
+    public:
+        //! makes 'factory' the current one of this thread until destroyed
+        class Scope {
+            BoolExpFactory *previous;
+
+        public:
+            explicit Scope(BoolExpFactory &factory);
+            ~Scope();
+        };
+
+        BoolExpFactory() = default;
+        BoolExpFactory(const BoolExpFactory &) = delete;
+        BoolExpFactory &operator=(const BoolExpFactory &) = delete;
+        ~BoolExpFactory();
+
+        //! number of distinct nodes
+        size_t size() const { return nodes.size(); }
+
+        //! the factory of the innermost Scope, nullptr if there is none
+        static BoolExpFactory *current();
+
+        template <typename T, typename... Args>
+        static T *make(Args &&... args) {
+            BoolExpFactory *factory = current();
+            if (!factory)
+                return new T(std::forward<Args>(args)...);
+            // the probe doesn't own its (shared) children, its destructor
+            // must not free them
+            T probe(std::forward<Args>(args)...);
+            probe.gcMarked = true;
+            BoolExp *&node = factory->lookup(probe, discriminator(probe));
+            if (!node)
+                node = factory->adopt(new (factory->allocate(sizeof(T))) T(probe));
+            return static_cast<T *>(node);
+        }
+
+    private:
+        struct Key {
+            const std::type_info *kind;
+            const BoolExp *left;
+            const BoolExp *right;
+            SymbolId name;
+            int discriminator;
+
+            bool operator==(const Key &other) const {
+                return kind == other.kind && left == other.left && right == other.right
+                       && name == other.name && discriminator == other.discriminator;
+            }
+        };
+        struct KeyHash {
+            size_t operator()(const Key &key) const;
+        };
+        static const size_t BlockSize = 64 * 1024;
+
+        std::unordered_map<Key, BoolExp *, KeyHash> unique;
+        std::vector<BoolExp *> nodes;
+        std::vector<std::unique_ptr<char[]>> blocks;
+        size_t blockUsed = BlockSize;
+
+        static int discriminator(const BoolExp &) { return 0; }
+        static int discriminator(const BoolExpVar &e) { return e.rel; }
+        static int discriminator(const BoolExpConst &e) { return e.value; }
+
+        BoolExp *&lookup(const BoolExp &probe, int discriminator);
+        void *allocate(size_t size);
+        BoolExp *adopt(BoolExp *node) {
+            nodes.push_back(node);
+            return node;
+        }
+    };
+
 /************************************************************************/
 /* Operators                                                            */
 /************************************************************************/
@@ -20,7 +20,9 @@
  */
 
 #include "PicosatCNF.h"
+#include "Backbone.h"
 #include "CNFBuilder.h"
+#include "CNFPreprocessor.h"
 #include "exceptions/IOException.h"
 #include "RsfReader.h"
 #include "KconfigWhitelist.h"
@@ -33,9 +35,13 @@ using namespace kconfig;
 
 
 static void usage(void){
-    std::cerr << "rsf2cnf [-v] [-q] -m <model> [-W <file>] [-B <file>] [-r <rsf>] [-c <cnf>]" << std::endl;
+    std::cerr << "rsf2cnf [-v] [-q] [-b] [-p] [-s] [-f] -m <model> [-W <file>] [-B <file>] [-r <rsf>] [-c <cnf>]" << std::endl;
     std::cerr << "  -v           increase verbosity" << std::endl;
     std::cerr << "  -q           decrease verbosity" << std::endl;
+    std::cerr << "  -b           write the cnf in the binary format instead of text" << std::endl;
+    std::cerr << "  -p           use a compact, polarity aware encoding (smaller, but numbered differently)" << std::endl;
+    std::cerr << "  -s           simplify the cnf, only named variables are kept as they are" << std::endl;
+    std::cerr << "  -f           store the variables with a fixed value in all configurations (backbone)" << std::endl;
     std::cerr << "  -m <model>   file with inferences from golem, or a version 1.0 model file generated by rsf2model" << std::endl;
     std::cerr << "  -r <rsf>     (optional) original *.rsf file generated by dumpconf" << std::endl;
     std::cerr << "  -c <cnf>     (optional) merges constraints from given .cnf file" << std::endl;
@@ -127,10 +133,14 @@ int main(int argc, char **argv) {
     std::string model_file;
     std::string rsf_file;
     std::string cnf_file;
+    bool binary = false;
+    bool backbone = false;
+    bool simplify = false;
+    CNFBuilder::Encoding encoding = CNFBuilder::Encoding::TSEITIN;
 
     int loglevel = Logging::getLogLevel();
 
-    while ((opt = getopt(argc, argv, "m:r:c:W:B:vh")) != -1) {
+    while ((opt = getopt(argc, argv, "m:r:c:W:B:bfpsvh")) != -1) {
         switch (opt) {
             int n;
         case 'm':
@@ -142,6 +152,18 @@ int main(int argc, char **argv) {
         case 'c':
             cnf_file = optarg;
             break;
+        case 'b':
+            binary = true;
+            break;
+        case 'f':
+            backbone = true;
+            break;
+        case 'p':
+            encoding = CNFBuilder::Encoding::COMPACT;
+            break;
+        case 's':
+            simplify = true;
+            break;
         case 'q':
             loglevel = loglevel + 10;
             Logging::setLogLevel(loglevel);
@@ -183,7 +205,7 @@ int main(int argc, char **argv) {
     if (cnf_file != "")
         cnf.readFromFile(cnf_file);
 
-    kconfig::CNFBuilder builder(&cnf);
+    kconfig::CNFBuilder builder(&cnf, "", false, CNFBuilder::ConstantPolicy::BOUND, encoding);
 
     RsfReader model(model_file);
     addClauses(builder, model);
@@ -192,8 +214,29 @@ int main(int argc, char **argv) {
     if (rsf_file != "")
         addTypeInfo(cnf, rsf_file);
 
+    const CNFBuilder::Stats stats = builder.getStats();
+    Logging::debug("encoded ", stats.vars, " variables and ", stats.clauses, " clauses");
+
     std::string magic_inc("CONFIGURATION_SPACE_INCOMPLETE");
     if (model.getMetaValue(magic_inc))
         cnf.addMetaValue(magic_inc, "True");
-    cnf.toStream(std::cout);
+    PicosatCNF simplified;
+    if (simplify) {
+        const CNFPreprocessor::Stats s = CNFPreprocessor::simplify(cnf, simplified);
+        Logging::info("simplified to ", simplified.getVarCount(), " variables and ",
+                      simplified.getClauseCount(), " clauses (", s.units, " units, ",
+                      s.equivalences, " equivalences, ", s.eliminated, " eliminated, ",
+                      s.subsumed, " subsumed, ", s.strengthened, " strengthened)");
+    }
+    PicosatCNF &result = simplify ? simplified : cnf;
+    if (backbone) {
+        const std::deque<std::string> fixed = Backbone::compute(result);
+        for (const std::string &lit : fixed)
+            result.addMetaValue(Backbone::metaKey, lit);
+        Logging::info("backbone: ", fixed.size(), " variables have a fixed value");
+    }
+    if (binary)
+        result.toBinaryStream(std::cout);
+    else
+        result.toStream(std::cout);
 }
@@ -24,6 +24,8 @@
 #include "SymbolTranslator.h"
 #include "KconfigSymbolSet.h"
 #include "PicosatCNF.h"
+#include "Backbone.h"
+#include "CNFPreprocessor.h"
 #include "KconfigAssumptionMap.h"
 #include "Logging.h"
 #include "../version.h"
@@ -39,11 +41,17 @@ using namespace kconfig;
 
 
 void usage(std::ostream &out) {
-    out << "usage: satyr [-V] [-a <assumtion.config> | -c <out.cnf>] <model>" << std::endl;
+    out << "usage: satyr [-V] [-p] [-a <assumtion.config> | -c <out.cnf> [-b] [-s] [-f]] <model>" << std::endl;
     out << "       model:          a Kconfig file / translated cnf file" << std::endl;
     out << "       -a <assumtion>  a .config file to be validated" << std::endl;
     out << "                       (may be incomplete)" << std::endl;
     out << "       -c <out.cnf>   translates model to cnf and saves it to out.cnf" << std::endl;
+    out << "       -b             saves the cnf in the binary format instead of text" << std::endl;
+    out << "       -p             use a compact, polarity aware cnf encoding" << std::endl;
+    out << "       -s             simplifies the saved cnf, only named variables" << std::endl;
+    out << "                      are kept as they are" << std::endl;
+    out << "       -f             stores the variables with a fixed value in all" << std::endl;
+    out << "                      configurations (backbone) in the saved cnf" << std::endl;
     out << "       -V  print version information\n";
     exit(EXIT_FAILURE);
 }
@@ -76,6 +84,10 @@ int process_assumptions(PicosatCNF &cnf, const std::vector<boost::filesystem::pa
 
 int main(int argc, char **argv) {
     bool saveTranslatedModel = false;
+    bool saveBinary = false;
+    bool saveBackbone = false;
+    bool saveSimplified = false;
+    CNFBuilder::Encoding encoding = CNFBuilder::Encoding::TSEITIN;
     std::vector<boost::filesystem::path> assumptions;
     boost::filesystem::path saveFile;
     int exitstatus = 0;
@@ -83,7 +95,7 @@ int main(int argc, char **argv) {
 
     int loglevel = Logging::getLogLevel();
 
-    while ((opt = getopt(argc, argv, "Vvc:a:")) != -1) {
+    while ((opt = getopt(argc, argv, "Vvbfpsc:a:")) != -1) {
         switch (opt) {
         case 'c':
             saveTranslatedModel = true;
@@ -92,6 +104,18 @@ int main(int argc, char **argv) {
         case 'a':
             assumptions.push_back(optarg);
             break;
+        case 'b':
+            saveBinary = true;
+            break;
+        case 'f':
+            saveBackbone = true;
+            break;
+        case 'p':
+            encoding = CNFBuilder::Encoding::COMPACT;
+            break;
+        case 's':
+            saveSimplified = true;
+            break;
         case 'v':
             loglevel = loglevel - 10;
             if (loglevel < 0)
@@ -139,7 +163,7 @@ int main(int argc, char **argv) {
         cnf.readFromFile(filepath.string());
     } else {
         Logging::info("Parsing Kconfig file ", filepath);
-        SymbolTranslator translator(&cnf);
+        SymbolTranslator translator(&cnf, encoding);
         KconfigSymbolSet symbolSet;
 
         Logging::debug("parsing");
@@ -156,10 +180,28 @@ int main(int argc, char **argv) {
                           translator.totalStringComparisons(), " comparisons.");
         }
         Logging::info("features in model: ", symbolSet.size());
+        const CNFBuilder::Stats stats = translator.getStats();
+        Logging::info("encoded ", stats.vars, " variables and ", stats.clauses, " clauses");
+    }
+    // the assumptions are checked on the model as it was translated
+    PicosatCNF simplified;
+    if (saveTranslatedModel && saveSimplified) {
+        const CNFPreprocessor::Stats s = CNFPreprocessor::simplify(cnf, simplified);
+        Logging::info("simplified to ", simplified.getVarCount(), " variables and ",
+                      simplified.getClauseCount(), " clauses (", s.units, " units, ",
+                      s.equivalences, " equivalences, ", s.eliminated, " eliminated, ",
+                      s.subsumed, " subsumed, ", s.strengthened, " strengthened)");
+    }
+    PicosatCNF &saved = saveSimplified ? simplified : cnf;
+    if (saveTranslatedModel && saveBackbone) {
+        const std::deque<std::string> fixed = Backbone::compute(saved);
+        for (const std::string &lit : fixed)
+            saved.addMetaValue(Backbone::metaKey, lit);
+        Logging::info("backbone: ", fixed.size(), " variables have a fixed value");
     }
     if (saveTranslatedModel) {
-        cnf.toFile(saveFile.string());
-        Logging::info(cnf.getVarCount(), " variables written to ", saveFile);
+        saved.toFile(saveFile.string(), saveBinary);
+        Logging::info(saved.getVarCount(), " variables written to ", saveFile);
     }
     exitstatus += process_assumptions(cnf, assumptions);
     return exitstatus;
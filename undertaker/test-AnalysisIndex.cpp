@@ -0,0 +1,153 @@
+#include "AnalysisIndex.h"
+#include "ConditionalBlock.h"
+#include <check.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static std::string tempFile(const char *pattern) {
+    std::string file(pattern);
+    int fd = mkstemp(&file[0]);
+    fail_unless(fd >= 0);
+    close(fd);
+    return file;
+}
+
+static void writeFile(const std::string &file, const std::string &content) {
+    std::ofstream out(file, std::ios_base::trunc);
+    out << content;
+}
+
+START_TEST(contentHashes) {
+    const std::string file = tempFile("/tmp/test-AnalysisIndex.XXXXXX");
+    writeFile(file, "#ifdef CONFIG_A\n#endif\n");
+    const std::string hash = AnalysisIndex::contentHash(file);
+    fail_if(hash.empty());
+    fail_unless(hash == AnalysisIndex::contentHash(file));
+    writeFile(file, "#ifdef CONFIG_B\n#endif\n");
+    fail_if(hash == AnalysisIndex::contentHash(file));
+    unlink(file.c_str());
+    fail_unless(AnalysisIndex::contentHash(file).empty());
+} END_TEST;
+
+START_TEST(reuseResults) {
+    const std::string index_file = tempFile("/tmp/test-AnalysisIndex.index.XXXXXX");
+    const std::string source = tempFile("/tmp/test-AnalysisIndex.XXXXXX");
+    const std::string report = source + ".B1.code.globally.dead";
+    writeFile(source, "#ifdef CONFIG_A\n#ifndef CONFIG_A\n#endif\n#endif\n");
+    writeFile(report, "");
+
+    AnalysisIndex &index = AnalysisIndex::getInstance();
+    index.enable(index_file, "settings");
+    fail_unless(index.isEnabled());
+    fail_if(index.isUpToDate(source));
+    {
+        CppFile file(source);
+        fail_unless(file.good());
+        index.record(source, file, {report});
+    }
+    fail_unless(index.isUpToDate(source));
+
+    // the index is read again, but other settings invalidate it
+    index.enable(index_file, "settings");
+    fail_unless(index.isUpToDate(source));
+    index.enable(index_file, "other settings");
+    fail_if(index.isUpToDate(source));
+
+    // missing reports and changed files need a new analysis
+    index.enable(index_file, "settings");
+    unlink(report.c_str());
+    fail_if(index.isUpToDate(source));
+    writeFile(report, "");
+    fail_unless(index.isUpToDate(source));
+    writeFile(source, "#ifdef CONFIG_B\n#endif\n");
+    fail_if(index.isUpToDate(source));
+
+    unlink(report.c_str());
+    unlink(source.c_str());
+    unlink(index_file.c_str());
+} END_TEST;
+
+START_TEST(changedHeaders) {
+    const std::string index_file = tempFile("/tmp/test-AnalysisIndex.index.XXXXXX");
+    const std::string source = tempFile("/tmp/test-AnalysisIndex.XXXXXX");
+    const std::string header = tempFile("/tmp/test-AnalysisIndex.XXXXXX");
+    writeFile(header, "#define X\n");
+    writeFile(source, "#include \"" + header.substr(header.rfind('/') + 1) + "\"\n"
+                      "#ifdef CONFIG_A\n#endif\n");
+
+    AnalysisIndex &index = AnalysisIndex::getInstance();
+    index.enable(index_file, "settings");
+    {
+        CppFile file(source);
+        fail_unless(file.good());
+        fail_unless(file.getIncludedFiles().size() == 1);
+        index.record(source, file, {});
+    }
+    fail_unless(index.isUpToDate(source));
+    // the included files are kept in the index as well
+    index.enable(index_file, "settings");
+    fail_unless(index.isUpToDate(source));
+    writeFile(header, "#undef X\n");
+    fail_if(index.isUpToDate(source));
+
+    unlink(header.c_str());
+    unlink(source.c_str());
+    unlink(index_file.c_str());
+} END_TEST;
+
+START_TEST(concurrentRuns) {
+    const std::string index_file = tempFile("/tmp/test-AnalysisIndex.index.XXXXXX");
+    const std::string source = tempFile("/tmp/test-AnalysisIndex.XXXXXX");
+    writeFile(source, "#ifdef CONFIG_A\n#endif\n");
+    AnalysisIndex &index = AnalysisIndex::getInstance();
+    index.enable(index_file, "settings");
+
+    // another run appends after this one compacted the index it had opened before
+    int ready[2];
+    fail_unless(pipe(ready) == 0);
+    pid_t pid = fork();
+    if (pid == 0) {
+        char c;
+        if (read(ready[0], &c, 1) != 1)
+            _exit(1);
+        CppFile file(source);
+        index.record(source, file, {});
+        _exit(0);
+    }
+    index.enable(index_file, "settings");
+    fail_unless(write(ready[1], "x", 1) == 1);
+    int status;
+    waitpid(pid, &status, 0);
+    fail_unless(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    index.enable(index_file, "settings");
+    fail_unless(index.isUpToDate(source));
+
+    close(ready[0]);
+    close(ready[1]);
+    unlink(source.c_str());
+    unlink(index_file.c_str());
+} END_TEST;
+
+Suite *analysis_index_suite(void) {
+    Suite *s  = suite_create("AnalysisIndex-test");
+    TCase *tc = tcase_create("AnalysisIndex");
+    tcase_add_test(tc, contentHashes);
+    tcase_add_test(tc, reuseResults);
+    tcase_add_test(tc, changedHeaders);
+    tcase_add_test(tc, concurrentRuns);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main() {
+    Suite *s = analysis_index_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
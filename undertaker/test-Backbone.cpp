@@ -0,0 +1,99 @@
+#include "Backbone.h"
+#include "ClauseList.h"
+#include "KconfigWhitelist.h"
+#include "PicosatCNF.h"
+#include "bool.h"
+#include <check.h>
+#include <deque>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace kconfig;
+
+//! A && (B -> C) && (C -> !A), D is free
+static void buildModel(PicosatCNF &cnf) {
+    const char *names[] = {"CONFIG_A", "CONFIG_B", "CONFIG_C", "CONFIG_D"};
+    for (int i = 0; i < 4; i++)
+        cnf.setCNFVar(names[i], cnf.newVar());
+    int clauses[] = {1, 0, -2, 3, 0, -3, -1, 0};
+    for (int lit : clauses)
+        if (lit)
+            cnf.pushVar(lit);
+        else
+            cnf.pushClause();
+}
+
+static bool refutes(const Backbone &bb, const std::vector<std::string> &formulas) {
+    std::vector<std::unique_ptr<BoolExp>> exps;
+    ClauseList clauses;
+    for (const std::string &f : formulas) {
+        exps.emplace_back(BoolExp::parseString(f));
+        clauses.push_back(exps.back().get());
+    }
+    return bb.refutes(clauses);
+}
+
+START_TEST(compute) {
+    PicosatCNF cnf;
+    buildModel(cnf);
+    std::deque<std::string> meta = Backbone::compute(cnf);
+    std::set<std::string> computed(meta.begin(), meta.end());
+    std::set<std::string> expected{"CONFIG_A", "!CONFIG_B", "!CONFIG_C"};
+    fail_unless(computed == expected);
+    fail_unless(Backbone(&meta).size() == 3);
+
+    // an unsatisfiable model has no backbone
+    cnf.pushVar(-1);
+    cnf.pushClause();
+    fail_unless(Backbone::compute(cnf).empty());
+} END_TEST;
+
+START_TEST(refute) {
+    PicosatCNF cnf;
+    buildModel(cnf);
+    std::deque<std::string> meta = Backbone::compute(cnf);
+    Backbone bb(&meta);
+    fail_unless(refutes(bb, {"B1", "B1 <-> CONFIG_B && CONFIG_D"}));
+    fail_unless(refutes(bb, {"!B1", "B1 <-> CONFIG_A"}));
+    fail_unless(refutes(bb, {"B1", "B1 -> CONFIG_C"}));
+    fail_unless(refutes(bb, {"B1 && B2", "B2 <-> (CONFIG_D || CONFIG_A) && B1 && !CONFIG_A"}));
+    fail_if(refutes(bb, {"B1", "B1 <-> CONFIG_B || CONFIG_D"}));
+    fail_if(refutes(bb, {"B1", "B1 <-> CONFIG_A && CONFIG_D"}));
+    fail_if(Backbone().refutes(ClauseList()));
+} END_TEST;
+
+START_TEST(ignorelist) {
+    PicosatCNF cnf;
+    buildModel(cnf);
+    std::deque<std::string> meta = Backbone::compute(cnf);
+    Backbone bb(&meta);
+    fail_unless(refutes(bb, {"B1", "B1 <-> !CONFIG_A"}));
+
+    // ignored symbols are free variables in the SAT checks, the backbone says nothing about them
+    KconfigWhitelist::getIgnorelist().addItem("CONFIG_A");
+    fail_if(refutes(bb, {"B1", "B1 <-> !CONFIG_A"}));
+    fail_if(refutes(bb, {"B1 && B2", "B1 <-> CONFIG_A", "B2 <-> !CONFIG_A"}));
+    fail_unless(refutes(bb, {"B1", "B1 <-> CONFIG_A && CONFIG_B"}));
+} END_TEST;
+
+Suite *backbone_suite(void) {
+    Suite *s  = suite_create("Backbone-test");
+    TCase *tc = tcase_create("Backbone");
+    tcase_add_test(tc, compute);
+    tcase_add_test(tc, refute);
+    tcase_add_test(tc, ignorelist);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main() {
+    Suite *s = backbone_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
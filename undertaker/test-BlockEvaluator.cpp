@@ -0,0 +1,90 @@
+#include "BlockEvaluator.h"
+#include "ConditionalBlock.h"
+#include <check.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+static std::string tempFile(const char *pattern) {
+    std::string file(pattern);
+    int fd = mkstemp(&file[0]);
+    fail_unless(fd >= 0);
+    close(fd);
+    return file;
+}
+
+static void writeFile(const std::string &file, const std::string &content) {
+    std::ofstream out(file, std::ios_base::trunc);
+    out << content;
+}
+
+START_TEST(configurationSet) {
+    const std::string config = tempFile("/tmp/test-BlockEvaluator.XXXXXX");
+    writeFile(config, "CONFIG_A=y\nCONFIG_B=m\nCONFIG_C=n\n# CONFIG_D is not set\n"
+                      "CONFIG_E=\"string\"\n");
+    ConfigurationSet configs;
+    for (int i = 0; i < 70; i++)
+        configs.add(config);
+    fail_unless(configs.size() == 70);
+    fail_unless(configs.getWord("CONFIG_A", 0) == ~ConfigurationSet::Word(0));
+    fail_unless(configs.getWord("CONFIG_A", 1) == 0x3f);
+    fail_unless(configs.getWord("CONFIG_B", 0) == 0);
+    fail_unless(configs.getWord("CONFIG_B_MODULE", 0) != 0);
+    fail_unless(configs.getWord("CONFIG_C", 0) == 0);
+    fail_unless(configs.getWord("CONFIG_D", 0) == 0);
+    fail_unless(configs.getWord("CONFIG_E", 0) != 0);
+    fail_unless(configs.getWord("CONFIG_A", 2) == 0);
+    unlink(config.c_str());
+} END_TEST;
+
+START_TEST(evaluateBlocks) {
+    const std::string source = tempFile("/tmp/test-BlockEvaluator.XXXXXX");
+    const std::string a = tempFile("/tmp/test-BlockEvaluator.XXXXXX");
+    const std::string b = tempFile("/tmp/test-BlockEvaluator.XXXXXX");
+    const std::string none = tempFile("/tmp/test-BlockEvaluator.XXXXXX");
+    writeFile(source, "#ifdef CONFIG_A\n#define X\n#elif defined(CONFIG_B)\n#else\n"
+                      "#ifndef X\n#endif\n#endif\n"
+                      "#if defined(CONFIG_A) || defined(__KERNEL__)\n#endif\n");
+    writeFile(a, "CONFIG_A=y\n");
+    writeFile(b, "CONFIG_B=y\n");
+    writeFile(none, "# CONFIG_A is not set\n");
+
+    ConfigurationSet configs;
+    configs.add(a);
+    configs.add(b);
+    configs.add(none);
+    CppFile file(source);
+    fail_unless(file.good());
+    BlockEvaluator evaluator(file);
+    evaluator.evaluate(configs);
+    fail_unless(evaluator.blocks() == 5);
+
+    // X is known to be defined only if CONFIG_A is, __KERNEL__ is unknown
+    fail_unless(evaluator.getBitmap(0) == "10001");
+    fail_unless(evaluator.getBitmap(1) == "0100?");
+    fail_unless(evaluator.getBitmap(2) == "001??");
+    fail_unless(evaluator.getState(3, 2) == BlockEvaluator::State::UNKNOWN);
+
+    for (const std::string &f : {source, a, b, none})
+        unlink(f.c_str());
+} END_TEST;
+
+Suite *block_evaluator_suite(void) {
+    Suite *s  = suite_create("BlockEvaluator-test");
+    TCase *tc = tcase_create("BlockEvaluator");
+    tcase_add_test(tc, configurationSet);
+    tcase_add_test(tc, evaluateBlocks);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main() {
+    Suite *s = block_evaluator_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -118,6 +118,29 @@ START_TEST(parseBool) {
     parse_test_reference("A ? B : C", 0, "ternary operator");
 } END_TEST;
 
+START_TEST(parseTokens) {
+    parse_test_reference("0x1f && 0ul || 10L", "1 && 0 || 1", "integer literals");
+    parse_test_reference("A<<<B<=C", "A <<< B <= C", "longest operator match");
+    parse_test_reference("A-B->C", "A - B -> C", "'-' vs. '->'");
+    parse_test_reference("f(,a)", "f (a)", "omitted first parameter");
+    parse_test("A @ B", false);
+    parse_test("'ab'", false);
+    parse_test("f(a,)", false);
+    parse_test("A) && (B", false);
+
+    // deep nesting is rejected instead of overflowing the stack
+    parse_test(std::string(100, '(') + "A" + std::string(100, ')'), true);
+    parse_test(std::string(1000000, '(') + "A" + std::string(1000000, ')'), false);
+    parse_test(std::string(1000000, '!') + "A", false);
+    fail_unless(BoolExp::symbolsOfString(std::string(1000000, '(') + "A").empty());
+
+    // binary operators are left-associative
+    BoolExp *e = BoolExp::parseString("A -> B -> C");
+    fail_unless(e != nullptr);
+    fail_unless(dynamic_cast<BoolExpImpl *>(e->left) != nullptr);
+    delete e;
+} END_TEST;
+
 START_TEST(notATree) {
     BoolExp *x = new BoolExpVar("X",false);
     BoolExp *n0 = new BoolExpNot(x);
@@ -192,6 +215,27 @@ START_TEST(equal) {
     equals_test("A + B");
 } END_TEST;
 
+START_TEST(hashConsing) {
+    BoolExpFactory nodes;
+    BoolExpFactory::Scope scope(nodes);
+    BoolExp &x = *B_VAR("X");
+    BoolExp &y = *B_VAR("Y");
+
+    BoolExp *a = &(x && !y);
+    BoolExp *b = &(*B_VAR("X") && !*B_VAR("Y"));
+    fail_unless(a == b, "equal subformulas are not shared");
+    fail_unless(&(x || y) != &(y || x));
+    fail_unless(B_CONST(true) == B_CONST(true));
+    fail_unless(B_CONST(true) != B_CONST(false));
+    // X, Y, !Y, X && !Y, X || Y, Y || X, 1, 0
+    fail_unless(nodes.size() == 8, "%zu nodes", nodes.size());
+
+    // simplifying only rebuilds what is already there
+    BoolExp *s = B_OR(a, B_CONST(false))->simplify();
+    fail_unless(s == a, "simplified to %s", s->str().c_str());
+    fail_unless(nodes.size() == 9, "%zu nodes", nodes.size());
+} END_TEST;
+
 
 Suite *cond_block_suite(void) {
     Suite *s  = suite_create("Suite test-Bool");
@@ -199,9 +243,11 @@ Suite *cond_block_suite(void) {
     tcase_add_test(tc, parseBool);
     tcase_add_test(tc, bool_parser_test);
     tcase_add_test(tc, parseFunc);
+    tcase_add_test(tc, parseTokens);
     tcase_add_test(tc, notATree);
     tcase_add_test(tc, equal);
     tcase_add_test(tc, simplify);
+    tcase_add_test(tc, hashConsing);
     suite_add_tcase(s, tc);
     return s;
 }
@@ -1,5 +1,6 @@
 #include "bool.h"
 #include "BoolExpSymbolSet.h"
+#include "Tools.h"
 #include <set>
 #include <iostream>
 #include <check.h>
@@ -40,12 +41,41 @@ START_TEST(symtableWithCall) {
     fail_if(!e || s0.size() != 3);
 } END_TEST;
 
+START_TEST(symbolsOfString) {
+    const char *exps[] = {
+        "A && !B.",
+        "foo(x,y) || bar(x,z)",
+        "f(,g(a)) -> (B0 <-> CONFIG_X >= 0x10ul && 'c')",
+        "A -> B -> C <-> A",
+        "A &&",
+        "",
+    };
+    for (const char *exp : exps) {
+        BoolExp *e = BoolExp::parseString(exp);
+        BoolExpSymbolSet t(e);
+        fail_unless(BoolExp::symbolsOfString(exp) == t.getSymbolSet(), exp);
+        delete e;
+    }
+} END_TEST;
+
+START_TEST(itemsOfStringCache) {
+    const auto items = undertaker::itemsOfString("A && !B");
+    fail_unless(undertaker::itemsOfString("A && !B") == items);
+    // the cache is bounded, sets of dropped entries stay valid
+    for (int i = 0; i < 1 << 17; i++)
+        undertaker::itemsOfString("X" + std::to_string(i));
+    fail_unless(*items == std::set<std::string>({"A", "B"}));
+    fail_if(undertaker::itemsOfString("A && !B") == items);
+} END_TEST;
+
 
 Suite *cond_block_suite(void) {
     Suite *s  = suite_create("Suite");
     TCase *tc = tcase_create("Bool");
     tcase_add_test(tc, symtable);
     tcase_add_test(tc, symtableWithCall);
+    tcase_add_test(tc, symbolsOfString);
+    tcase_add_test(tc, itemsOfStringCache);
     suite_add_tcase(s, tc);
     return s;
 }
@@ -20,10 +20,14 @@
 
 #include "bool.h"
 #include "CNFBuilder.h"
+#include "ClauseList.h"
 #include "PicosatCNF.h"
 #include "exceptions/CNFBuilderError.h"
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
+#include <vector>
 #include <check.h>
 
 using namespace kconfig;
@@ -336,6 +340,93 @@ START_TEST(literals) {
 //  build_and_evaluate_strategy("0x0ull", true, false);
 } END_TEST;
 
+// every assignment of a, b, c and d has to give the same result with both encodings
+void compare_encodings(const char *expression) {
+    const char *symbols[] = {"a", "b", "c", "d"};
+    PicosatCNF tseitin, compact;
+    CNFBuilder builder1(&tseitin, expression, false, CNFBuilder::ConstantPolicy::BOUND,
+                        CNFBuilder::Encoding::TSEITIN);
+    CNFBuilder builder2(&compact, expression, false, CNFBuilder::ConstantPolicy::BOUND,
+                        CNFBuilder::Encoding::COMPACT);
+
+    for (int assignment = 0; assignment < 16; assignment++) {
+        for (int i = 0; i < 4; i++) {
+            if (!tseitin.getCNFVar(symbols[i]))
+                continue;
+            tseitin.pushAssumption(symbols[i], assignment & (1 << i));
+            compact.pushAssumption(symbols[i], assignment & (1 << i));
+        }
+        fail_unless(tseitin.checkSatisfiable() == compact.checkSatisfiable(),
+                    "encodings of %s differ for assignment %d", expression, assignment);
+    }
+    fail_unless(builder2.getStats().clauses <= builder1.getStats().clauses,
+                "%s: %d compact clauses, %d tseitin clauses", expression,
+                builder2.getStats().clauses, builder1.getStats().clauses);
+}
+
+START_TEST(compactEncoding) {
+    compare_encodings("a -> (b || !c && d)");
+    compare_encodings("(a || b || c) -> d");
+    compare_encodings("!(a && b && c && d)");
+    compare_encodings("(a <-> !b) && (c <-> (a || d))");
+    compare_encodings("!(a -> b) || (c <-> d) && !(a || !c)");
+    compare_encodings("(a && b || c) && !(a && b || c -> d)");
+    compare_encodings("(a || 0) && (b -> 1) && !(c && 0)");
+} END_TEST;
+
+START_TEST(compactEncodingSize) {
+    PicosatCNF cnf;
+    CNFBuilder builder(&cnf, "a && b && c && d", false, CNFBuilder::ConstantPolicy::BOUND,
+                       CNFBuilder::Encoding::COMPACT);
+    // one unit clause for each conjunct, no helper variables
+    fail_unless(builder.getStats().vars == 4, "%d vars", builder.getStats().vars);
+    fail_unless(builder.getStats().clauses == 4, "%d clauses", builder.getStats().clauses);
+
+    // the chain gets one variable, which only has to imply the conjunction
+    BoolExp *e = BoolExp::parseString("!x || a && b && c");
+    builder.pushClause(e);
+    delete e;
+    fail_unless(builder.getStats().vars == 6, "%d vars", builder.getStats().vars);
+    fail_unless(builder.getStats().clauses == 8, "%d clauses", builder.getStats().clauses);
+
+    // a structurally identical subformula reuses the variable
+    e = BoolExp::parseString("!y || a && b && c");
+    builder.pushClause(e);
+    delete e;
+    fail_unless(builder.getStats().vars == 7, "%d vars", builder.getStats().vars);
+    fail_unless(builder.getStats().clauses == 9, "%d clauses", builder.getStats().clauses);
+} END_TEST;
+
+static bool sameClauses(const PicosatCNF &a, const PicosatCNF &b) {
+    PicosatCNF::LiteralRange ca = a.getClauses(), cb = b.getClauses();
+    return a.getVarCount() == b.getVarCount() && ca.size() == cb.size()
+           && std::equal(ca.begin(), ca.end(), cb.begin());
+}
+
+START_TEST(pushClausesLikeString) {
+    const char *formulas[] = {"( B1 <-> (A || !B) && ( ! (B0) ) )", "(B1 -> X.)",
+                              "(!B1 -> (X <-> X.))", "B00", "!(A && 0)"};
+    std::vector<std::unique_ptr<BoolExp>> parsed;
+    ClauseList clauses;
+    std::string joined;
+    for (const char *formula : formulas) {
+        parsed.emplace_back(BoolExp::parseString(formula));
+        clauses.push_back(parsed.back().get());
+        joined += (joined.empty() ? "" : "\n&& ") + std::string(formula);
+    }
+    // a unique list adds each formula only once
+    clauses.push_back(parsed[3].get());
+    fail_unless(clauses.size() == 5);
+
+    PicosatCNF expected, cnf1, cnf2;
+    CNFBuilder builder(&expected, joined);
+    // the formulas are only read, they can be pushed more than once
+    CNFBuilder(&cnf1).pushClauses(clauses);
+    CNFBuilder(&cnf2).pushClauses(clauses);
+    fail_unless(sameClauses(expected, cnf1));
+    fail_unless(sameClauses(expected, cnf2));
+} END_TEST;
+
 Suite *cond_block_suite(void) {
     Suite *s  = suite_create("Suite: test-CNFBuilder");
     TCase *tc = tcase_create("CNFBuilder");
@@ -352,6 +443,9 @@ Suite *cond_block_suite(void) {
     tcase_add_test(tc, buildImplNull);
     tcase_add_test(tc, buildCNFVarUsedMultipleTimes);
     tcase_add_test(tc, literals);
+    tcase_add_test(tc, compactEncoding);
+    tcase_add_test(tc, compactEncodingSize);
+    tcase_add_test(tc, pushClausesLikeString);
     tcase_add_test(tc, buildCNFVarUsedMultipleTimes);
     suite_add_tcase(s, tc);
     return s;
@@ -0,0 +1,119 @@
+#include "CNFPreprocessor.h"
+#include "CNFBuilder.h"
+#include "PicosatCNF.h"
+#include "bool.h"
+#include <check.h>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace kconfig;
+
+static void pushClauses(PicosatCNF &cnf, const std::vector<int> &literals) {
+    for (int lit : literals)
+        if (lit)
+            cnf.pushVar(lit);
+        else
+            cnf.pushClause();
+}
+
+// every assignment of the named variables has the same satisfiability in both
+static bool sameAnswers(PicosatCNF &a, PicosatCNF &b, const std::vector<std::string> &names) {
+    for (unsigned int bits = 0; bits < (1u << names.size()); bits++) {
+        for (size_t i = 0; i < names.size(); i++) {
+            a.pushAssumption(names[i], bits & (1u << i));
+            b.pushAssumption(names[i], bits & (1u << i));
+        }
+        if (a.checkSatisfiable() != b.checkSatisfiable())
+            return false;
+    }
+    return true;
+}
+
+START_TEST(helperVariables) {
+    PicosatCNF cnf;
+    CNFBuilder builder(&cnf);
+    BoolExp *e = BoolExp::parseString(
+        "(CONFIG_A -> (CONFIG_B || CONFIG_C) && !CONFIG_D) && (CONFIG_C <-> CONFIG_D || CONFIG_E)"
+        " && (CONFIG_B -> CONFIG_A) && (FILE_x -> CONFIG_A && CONFIG_E)");
+    builder.pushClause(e);
+    delete e;
+    cnf.setSymbolType("A", K_S_TRISTATE);
+    cnf.addMetaValue("ALWAYS_ON", "CONFIG_E");
+
+    PicosatCNF out;
+    CNFPreprocessor::Stats stats = CNFPreprocessor::simplify(cnf, out);
+    fail_unless(stats.units + stats.equivalences + stats.eliminated > 0);
+    fail_unless(out.getClauseCount() < cnf.getClauseCount());
+    fail_unless(out.getVarCount() < cnf.getVarCount());
+
+    std::vector<std::string> names{"CONFIG_A", "CONFIG_B", "CONFIG_C", "CONFIG_D", "CONFIG_E",
+                                   "FILE_x"};
+    for (const std::string &name : names)
+        fail_unless(out.getCNFVar(name) != 0);
+    fail_unless(out.getSymbolType("A") == K_S_TRISTATE);
+    fail_unless(out.getAssociatedSymbol("CONFIG_A_MODULE") == "A");
+    fail_unless(out.getMetaValue("ALWAYS_ON") && out.getMetaValue("ALWAYS_ON")->front() == "CONFIG_E");
+    fail_unless(sameAnswers(cnf, out, names));
+} END_TEST;
+
+START_TEST(randomFormulas) {
+    std::mt19937 random(4711);
+    const std::vector<std::string> names{"CONFIG_A", "CONFIG_B", "CONFIG_C", "CONFIG_D"};
+    for (int round = 0; round < 200; round++) {
+        PicosatCNF cnf;
+        const int vars = 4 + random() % 8;  // the first four are named
+        for (int var = 1; var <= vars; var++)
+            cnf.newVar();
+        for (size_t i = 0; i < names.size(); i++)
+            cnf.setCNFVar(names[i], i + 1);
+        std::vector<int> literals;
+        const int clauses = 2 + random() % 16;
+        for (int c = 0; c < clauses; c++) {
+            const int size = random() % 8 ? 2 + random() % 2 : 1;
+            for (int l = 0; l < size; l++)
+                literals.push_back((random() % 2 ? 1 : -1) * (1 + (int) (random() % vars)));
+            literals.push_back(0);
+        }
+        pushClauses(cnf, literals);
+
+        PicosatCNF out;
+        CNFPreprocessor::simplify(cnf, out);
+        fail_unless(out.getClauseCount() <= cnf.getClauseCount());
+        fail_unless(sameAnswers(cnf, out, names), "round %d", round);
+    }
+} END_TEST;
+
+START_TEST(unsatisfiable) {
+    PicosatCNF cnf;
+    cnf.setCNFVar("CONFIG_A", cnf.newVar());
+    cnf.newVar();
+    // A <-> 2, 2 <-> !A
+    pushClauses(cnf, {-1, 2, 0, 1, -2, 0, 2, 1, 0, -2, -1, 0});
+
+    PicosatCNF out;
+    CNFPreprocessor::simplify(cnf, out);
+    fail_unless(out.getClauseCount() == cnf.getClauseCount());
+    fail_unless(out.getCNFVar("CONFIG_A") == 1);
+    fail_if(out.checkSatisfiable());
+} END_TEST;
+
+Suite *cnf_preprocessor_suite(void) {
+    Suite *s  = suite_create("CNFPreprocessor-test");
+    TCase *tc = tcase_create("CNFPreprocessor");
+    tcase_add_test(tc, helperVariables);
+    tcase_add_test(tc, randomFormulas);
+    tcase_add_test(tc, unsatisfiable);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main() {
+    Suite *s = cnf_preprocessor_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -17,11 +17,15 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include <typeinfo>
 
 #include "ConditionalBlock.h"
+#include "CNFBuilder.h"
+#include "ClauseList.h"
+#include "PicosatCNF.h"
 
 #include <stdlib.h>
 #include <assert.h>
@@ -84,6 +88,20 @@ START_TEST(cond_getConstraints) {
 
 } END_TEST;
 
+START_TEST(cond_getCodeClauses) {
+    // the formulas have to give exactly the CNF of the parsed strings
+    for (ConditionalBlock *block : {file->topBlock(), block_a, block_b, block_ifdef, block_elsif}) {
+        kconfig::PicosatCNF expected, cnf;
+        kconfig::CNFBuilder builder(&expected, block->getCodeConstraints());
+        kconfig::CNFBuilder(&cnf).pushClauses(block->getCodeClauses());
+
+        kconfig::PicosatCNF::LiteralRange c1 = expected.getClauses(), c2 = cnf.getClauses();
+        fail_unless(expected.getVarCount() == cnf.getVarCount(), "%s", block->getName().c_str());
+        fail_unless(c1.size() == c2.size() && std::equal(c1.begin(), c1.end(), c2.begin()),
+                    "%s", block->getName().c_str());
+    }
+} END_TEST;
+
 Suite *
 cond_block_suite(void) {
     ConditionalBlock::iterator i = file->topBlock()->begin();
@@ -101,6 +119,7 @@ cond_block_suite(void) {
     TCase *tc = tcase_create("Conditional");
     tcase_add_test(tc, cond_parse_test);
     tcase_add_test(tc, cond_getConstraints);
+    tcase_add_test(tc, cond_getCodeClauses);
 
     suite_add_tcase(s, tc);
 
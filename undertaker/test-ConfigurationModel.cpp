@@ -19,8 +19,12 @@
 
 #include "ModelContainer.h"
 #include "ConfigurationModel.h"
+#include "RsfConfigurationModel.h"
+#include "RsfReader.h"
+#include "Tools.h"
 
 #include <check.h>
+#include <stack>
 
 
 START_TEST(getTypes) {
@@ -101,6 +105,43 @@ START_TEST(empty_model) {
     fail_unless(l->size() == 1, "found %d items in whitelist", l->size());
 } END_TEST;
 
+// the closure as it was computed before the dependency graph
+static std::set<std::string> interesting_reference(const RsfReader &model,
+                                                   std::set<std::string> items) {
+    std::stack<std::string> stack;
+    for (const std::string &str : items)
+        stack.push(str);
+    while (!stack.empty()) {
+        const std::string *formula = model.getValue(stack.top());
+        stack.pop();
+        if (formula == nullptr || *formula == "")
+            continue;
+        const auto formulaItems = undertaker::itemsOfString(*formula);
+        for (const std::string &str : *formulaItems)
+            if (items.insert(str).second)
+                stack.push(str);
+    }
+    return items;
+}
+
+START_TEST(interestingItems) {
+    const char *file = "validation/busybox-httpd.model";
+    RsfConfigurationModel model(file);
+    RsfReader reader(file);
+
+    for (const auto &entry : reader) {
+        std::set<std::string> items{entry.first, "NOT_IN_MODEL"};
+        model.extendWithInterestingItems(items);
+        fail_unless(items == interesting_reference(reader, {entry.first, "NOT_IN_MODEL"}),
+                    entry.first.c_str());
+    }
+    // CONFIG_HTTPD and ENABLE_HTTPD depend on each other
+    std::set<std::string> items{"CONFIG_FEATURE_HTTPD_CGI"};
+    model.extendWithInterestingItems(items);
+    fail_unless(items.size() == 4, "found %d items", items.size());
+    fail_unless(items.count("ENABLE_HTTPD") == 1);
+} END_TEST;
+
 Suite *cond_block_suite(void) {
 
     Suite *s  = suite_create("Suite");
@@ -109,6 +150,7 @@ Suite *cond_block_suite(void) {
     tcase_add_test(tc, whitelistManagement);
     tcase_add_test(tc, blacklistManagement);
     tcase_add_test(tc, empty_model);
+    tcase_add_test(tc, interestingItems);
 
     suite_add_tcase(s, tc);
     return s;
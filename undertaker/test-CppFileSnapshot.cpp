@@ -0,0 +1,131 @@
+#include "CppFileSnapshot.h"
+#include "PumaConditionalBlock.h"
+#include <check.h>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <boost/filesystem.hpp>
+
+static const std::string directory = "/tmp/test-CppFileSnapshot";
+static const std::string source = directory + "/source.c";
+
+static void writeFile(const std::string &file, const std::string &content) {
+    std::ofstream out(file, std::ios_base::trunc);
+    out << content;
+}
+
+static bool restored(const CppFile &file) {
+    return dynamic_cast<SnapshotConditionalBlock *>(file.topBlock()) != nullptr;
+}
+
+START_TEST(sameBlocks) {
+    boost::filesystem::remove_all(directory);
+    CppFileSnapshot::enable(directory);
+    writeFile(source, "#ifdef CONFIG_A\n#define X\n#elif defined(CONFIG_B)\n"
+                      "#else\n#ifndef X\n#undef X\n#endif\n#endif\n");
+
+    CppFile parsed(source);
+    CppFile snapshot(source);
+    fail_unless(parsed.good() && snapshot.good());
+    fail_if(restored(parsed));
+    fail_unless(restored(snapshot));
+
+    fail_unless(parsed.size() == snapshot.size());
+    for (auto a = parsed.begin(), b = snapshot.begin(); a != parsed.end(); ++a, ++b) {
+        fail_unless((*a)->getName() == (*b)->getName());
+        fail_unless(std::string((*a)->ExpressionStr()) == (*b)->ExpressionStr());
+        fail_unless((*a)->ifdefExpression() == (*b)->ifdefExpression());
+        fail_unless((*a)->lineStart() == (*b)->lineStart());
+        fail_unless((*a)->lineEnd() == (*b)->lineEnd());
+        fail_unless((*a)->isElseBlock() == (*b)->isElseBlock());
+        fail_unless((*a)->getDefines().size() == (*b)->getDefines().size());
+    }
+    fail_unless(parsed.getDefines()->size() == snapshot.getDefines()->size());
+    fail_unless(parsed.topBlock()->getCodeConstraints()
+                == snapshot.topBlock()->getCodeConstraints());
+
+    // decision coverage adds the same #else blocks
+    parsed.decisionCoverage();
+    snapshot.decisionCoverage();
+    fail_unless(parsed.size() == snapshot.size());
+    fail_unless(parsed.back()->getName() == snapshot.back()->getName());
+    boost::filesystem::remove_all(directory);
+} END_TEST;
+
+START_TEST(changedFiles) {
+    boost::filesystem::remove_all(directory);
+    CppFileSnapshot::enable(directory);
+    const std::string header = directory + "/header.h";
+    PumaConditionalBlockBuilder::addIncludePath(directory.c_str());
+    writeFile(header, "#ifdef CONFIG_H\n#endif\n");
+    writeFile(source, "#include \"header.h\"\n#ifdef CONFIG_A\n#endif\n");
+    {
+        CppFile parsed(source);
+        CppFile snapshot(source);
+        fail_unless(restored(snapshot));
+        fail_unless(parsed.size() == 2 && snapshot.size() == 2);
+        // the coverage output of commented sources needs the Puma tokens
+        CppFile tokens(source, false);
+        fail_if(restored(tokens));
+    }
+
+    writeFile(header, "#ifdef CONFIG_H\n#endif\n#ifdef CONFIG_I\n#endif\n");
+    {
+        CppFile parsed(source);
+        fail_if(restored(parsed));
+        // the header scanned for the first file of this process is outdated
+        fail_unless(parsed.size() == 3);
+    }
+    writeFile(source, "#ifdef CONFIG_B\n#endif\n");
+    {
+        CppFile parsed(source);
+        fail_if(restored(parsed));
+        fail_unless(parsed.front()->ifdefExpression() == "CONFIG_B");
+        CppFile snapshot(source);
+        fail_unless(restored(snapshot));
+        fail_unless(snapshot.front()->ifdefExpression() == "CONFIG_B");
+    }
+    boost::filesystem::remove_all(directory);
+} END_TEST;
+
+START_TEST(unresolvedIncludes) {
+    boost::filesystem::remove_all(directory);
+    CppFileSnapshot::enable(directory);
+    const std::string header = directory + "/missing.h";
+    writeFile(source, "#include \"missing.h\"\n#ifdef CONFIG_A\n#endif\n");
+    {
+        CppFile parsed(source);
+        CppFile snapshot(source);
+        fail_unless(restored(snapshot));
+        fail_unless(parsed.size() == 1 && snapshot.size() == 1);
+    }
+    // the header that wasn't found before is there now
+    writeFile(header, "#ifdef CONFIG_H\n#endif\n");
+    {
+        CppFile parsed(source);
+        fail_if(restored(parsed));
+        fail_unless(parsed.size() == 2);
+        CppFile snapshot(source);
+        fail_unless(restored(snapshot));
+    }
+    boost::filesystem::remove_all(directory);
+} END_TEST;
+
+Suite *cppfile_snapshot_suite(void) {
+    Suite *s  = suite_create("CppFileSnapshot-test");
+    TCase *tc = tcase_create("CppFileSnapshot");
+    tcase_add_test(tc, sameBlocks);
+    tcase_add_test(tc, changedFiles);
+    tcase_add_test(tc, unresolvedIncludes);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main() {
+    Suite *s = cppfile_snapshot_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
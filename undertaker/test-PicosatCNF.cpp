@@ -20,10 +20,17 @@
 
 #include "bool.h"
 #include "PicosatCNF.h"
+#include "exceptions/IOException.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <check.h>
 #include <string>
 #include <sstream>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 using namespace kconfig;
 
@@ -183,6 +190,73 @@ START_TEST(parallelUsage) {
     fail_if(unsatisfiable.checkSatisfiable());
 } END_TEST;
 
+START_TEST(interleavedModels) {
+    PicosatCNF first;
+    PicosatCNF second;
+
+    // v1 -> v2
+    first.pushVar(-1);
+    first.pushVar(2);
+    first.pushClause();
+
+    // v1 -> !v2
+    second.pushVar(-1);
+    second.pushVar(-2);
+    second.pushClause();
+
+    first.pushAssumption(1);
+    fail_unless(first.checkSatisfiable());
+    second.pushAssumption(1);
+    fail_unless(second.checkSatisfiable());
+
+    // each model keeps its own solution
+    fail_unless(first.deref(2) == true);
+    fail_unless(second.deref(2) == false);
+
+    // clauses added later only go to the model they were pushed to
+    first.pushVar(-2);
+    first.pushClause();
+    first.pushAssumption(1);
+    fail_if(first.checkSatisfiable());
+    second.pushAssumption(1);
+    fail_unless(second.checkSatisfiable());
+
+    // a copy gets its own solver and does not disturb the original
+    PicosatCNF copy(second);
+    copy.pushVar(2);
+    copy.pushClause();
+    copy.pushAssumption(1);
+    fail_if(copy.checkSatisfiable());
+    fail_unless(second.checkSatisfiable());
+} END_TEST;
+
+START_TEST(threadedUsage) {
+    std::vector<int> results(8, 0);
+    std::vector<std::thread> threads;
+
+    for (unsigned int t = 0; t < results.size(); t++)
+        threads.emplace_back([t, &results]() {
+            for (int i = 0; i < 100; i++) {
+                PicosatCNF cnf;
+                // v1 && (v1 -> v2) && ((t is odd) -> !v2)
+                cnf.pushVar(1);
+                cnf.pushClause();
+                cnf.pushVar(-1);
+                cnf.pushVar(2);
+                cnf.pushClause();
+                if (t % 2) {
+                    cnf.pushVar(-2);
+                    cnf.pushClause();
+                }
+                if (cnf.checkSatisfiable() == (t % 2 == 0))
+                    results[t]++;
+            }
+        });
+    for (std::thread &thread : threads)
+        thread.join();
+    for (int result : results)
+        fail_unless(result == 100);
+} END_TEST;
 
 START_TEST(toFile) {
     std::stringstream file;
@@ -418,6 +492,270 @@ START_TEST(addClausesToCnfFromFile) {
     fail_unless(cnf.deref(v6) == true);
 } END_TEST;
 
+START_TEST(layeredOnBase) {
+    std::string v1("v1"), v2("v2"), v3("v3");
+    PicosatCNF base;
+    base.setCNFVar(v1, 1);
+    base.setCNFVar(v2, 2);
+    // v2 -> v1
+    base.pushVar(-2);
+    base.pushVar(1);
+    base.pushClause();
+
+    PicosatCNF layer(&base, Picosat::SAT_MIN);
+    // no solver yet, nothing is assigned or failed
+    fail_if(layer.deref(1));
+    fail_unless(layer.failedAssumptions()[0] == 0);
+    fail_unless(layer.getCNFVar(v2) == 2);
+    fail_unless(layer.getSymbolName(1) == v1);
+
+    // v3 -> v2, v3 gets an id above the ones of the base
+    int var3 = layer.newVar();
+    layer.setCNFVar(v3, var3);
+    fail_unless(var3 == 3);
+    layer.pushVar(-var3);
+    layer.pushVar(2);
+    layer.pushClause();
+    fail_unless(layer.getClauseCount() == 2);
+
+    layer.pushAssumption(v3, true);
+    fail_unless(layer.checkSatisfiable());
+    fail_unless(layer.deref(v1) == true);
+
+    layer.pushAssumption(v3, true);
+    layer.pushAssumption(v1, false);
+    fail_if(layer.checkSatisfiable());
+
+    // the base itself is unchanged
+    fail_unless(base.getVarCount() == 2);
+    fail_unless(base.getClauseCount() == 1);
+    fail_unless(base.getCNFVar(v3) == 0);
+} END_TEST;
+
+START_TEST(slicedOnBase) {
+    PicosatCNF base;
+    // two cones: v1 || v2 and (v3 -> v4) && v3, v5 is in no clause
+    int clauses[] = {1, 2, 0, -3, 4, 0, 3, 0};
+    for (int lit : clauses)
+        if (lit)
+            base.pushVar(lit);
+        else
+            base.pushClause();
+    base.newVar();
+
+    PicosatCNF layer(&base, Picosat::SAT_MIN);
+    layer.setSliced(true, true);
+    layer.pushAssumption(-1);
+    fail_unless(layer.checkSatisfiable());
+    layer.pushAssumption(-4);
+    fail_if(layer.checkSatisfiable());
+    // v6 -> !v4, added after the first check
+    int var6 = layer.newVar();
+    layer.pushVar(-var6);
+    layer.pushVar(-4);
+    layer.pushClause();
+    layer.pushAssumption(var6);
+    fail_if(layer.checkSatisfiable());
+    layer.pushAssumption(5);
+    fail_unless(layer.checkSatisfiable());
+
+    // an unsatisfiable base can't be sliced
+    PicosatCNF unsat;
+    int contradiction[] = {1, 0, -1, 0};
+    for (int lit : contradiction)
+        if (lit)
+            unsat.pushVar(lit);
+        else
+            unsat.pushClause();
+    unsat.newVar();
+    PicosatCNF unsatLayer(&unsat, Picosat::SAT_MIN);
+    unsatLayer.setSliced(true);
+    unsatLayer.pushAssumption(2);
+    fail_if(unsatLayer.checkSatisfiable());
+} END_TEST;
+
+START_TEST(layersShareSolver) {
+    PicosatCNF base;
+    // v2 -> v1
+    base.pushVar(-2);
+    base.pushVar(1);
+    base.pushClause();
+
+    {
+        // v3 && !v1, unsatisfiable with v3 -> v2
+        PicosatCNF layer(&base, Picosat::SAT_MIN);
+        int var3 = layer.newVar();
+        layer.pushVar(-var3);
+        layer.pushVar(2);
+        layer.pushClause();
+        layer.pushVar(-1);
+        layer.pushClause();
+        layer.pushAssumption(var3);
+        fail_if(layer.checkSatisfiable());
+        const int *failed = layer.failedAssumptions();
+        fail_unless(failed[0] == var3 && failed[1] == 0);
+
+        // a second layer at the same time loads another solver
+        PicosatCNF other(&base, Picosat::SAT_MIN);
+        other.pushAssumption(2);
+        fail_unless(other.checkSatisfiable());
+        fail_unless(other.deref(1));
+    }
+    // the clauses of the first layer are gone, its variable is reused
+    PicosatCNF layer(&base, Picosat::SAT_MAX);
+    int var3 = layer.newVar();
+    layer.pushVar(-var3);
+    layer.pushVar(-2);
+    layer.pushClause();
+    layer.pushAssumption(var3);
+    fail_unless(layer.checkSatisfiable());
+    fail_unless(layer.deref(var3));
+    fail_if(layer.deref(2));
+    fail_unless(layer.deref(1));
+    // unknown to the solver until the next check
+    fail_if(layer.deref(layer.newVar()));
+    layer.pushAssumption(var3);
+    layer.pushAssumption(2);
+    fail_if(layer.checkSatisfiable());
+} END_TEST;
+
+START_TEST(setBaseRenumbers) {
+    std::string v1("v1"), v2("v2"), v3("v3");
+    PicosatCNF base;
+    base.setCNFVar(v1, 1);
+    base.setCNFVar(v2, 2);
+    // v2 -> v1
+    base.pushVar(-2);
+    base.pushVar(1);
+    base.pushClause();
+
+    // v3 -> v2, v3 and v2 have ids that collide with the base
+    PicosatCNF cnf;
+    cnf.setCNFVar(v3, 1);
+    cnf.setCNFVar(v2, 2);
+    cnf.pushVar(-1);
+    cnf.pushVar(2);
+    cnf.pushClause();
+    cnf.pushAssumption(v3, true);
+    fail_unless(cnf.checkSatisfiable());
+
+    cnf.setBase(&base);
+    fail_unless(cnf.getCNFVar(v2) == 2);
+    fail_unless(cnf.getCNFVar(v3) > 2);
+    fail_unless(cnf.getSymbolName(cnf.getCNFVar(v3)) == v3);
+
+    cnf.pushAssumption(v3, true);
+    cnf.pushAssumption(v1, false);
+    fail_if(cnf.checkSatisfiable());
+    cnf.pushAssumption(v3, true);
+    fail_unless(cnf.checkSatisfiable());
+    fail_unless(cnf.deref(v1) == true);
+} END_TEST;
+
+START_TEST(binaryFileRoundTrip) {
+    std::stringstream file;
+    file << "c var CONFIG_A 1\n";
+    file << "c var CONFIG_B 2\n";
+    file << "c var CONFIG_B_MODULE 3\n";
+    file << "c sym A 1\n";
+    file << "c sym B 2\n";
+    file << "c meta_value ALWAYS_ON CONFIG_A\n";
+    file << "p cnf 4 3\n";
+    // CONFIG_B -> CONFIG_A, CONFIG_B_MODULE -> CONFIG_A, !(CONFIG_B && CONFIG_B_MODULE)
+    file << "-2 1 0\n";
+    file << "-3 1 0\n";
+    file << "-2 -3 0\n";
+
+    PicosatCNF text;
+    text.readFromStream(file);
+
+    char filename[] = "/tmp/test-PicosatCNF.XXXXXX";
+    int fd = mkstemp(filename);
+    fail_unless(fd >= 0);
+    close(fd);
+    text.toFile(filename, true);
+
+    PicosatCNF binary;
+    binary.readFromFile(filename);
+    unlink(filename);
+
+    fail_unless(binary.getVarCount() == 4);
+    fail_unless(binary.getClauseCount() == 3);
+    fail_unless(binary.getCNFVar("CONFIG_B_MODULE") == 3);
+    fail_unless(binary.getCNFVar("CONFIG_C") == 0);
+    fail_unless(binary.getSymbolName(2) == "CONFIG_B");
+    fail_unless(binary.getSymbolName(4) == "");
+    fail_unless(binary.getSymbolType("B") == K_S_TRISTATE);
+    fail_unless(binary.getSymbolType("C") == K_S_UNKNOWN);
+    fail_unless(binary.getAssociatedSymbol("CONFIG_B_MODULE") == "B");
+    fail_unless(binary.getAssociatedSymbol("CONFIG_A_MODULE") == "");
+    fail_unless(binary.getMetaValue("ALWAYS_ON")->front() == "CONFIG_A");
+
+    // both formats describe the same formula
+    std::stringstream fromText, fromBinary;
+    text.toStream(fromText);
+    binary.toStream(fromBinary);
+    fail_unless(fromText.str() == fromBinary.str(), "Expected:\n%s\n\nGot:\n%s",
+                fromText.str().c_str(), fromBinary.str().c_str());
+
+    binary.pushAssumption("CONFIG_B", true);
+    fail_unless(binary.checkSatisfiable());
+    fail_unless(binary.deref("CONFIG_A") == true);
+
+    // modifying the mapped formula works on a copy of it
+    binary.pushVar(-1);
+    binary.pushClause();
+    fail_unless(binary.getClauseCount() == 4);
+    fail_unless(binary.getCNFVar("CONFIG_A") == 1);
+    binary.pushAssumption("CONFIG_B", true);
+    fail_if(binary.checkSatisfiable());
+} END_TEST;
+
+START_TEST(corruptBinaryFile) {
+    PicosatCNF cnf;
+    cnf.setCNFVar("CONFIG_A", 1);
+    cnf.addMetaValue("ALWAYS_ON", "CONFIG_A");
+    cnf.pushVar(1);
+    cnf.pushClause();
+
+    char filename[] = "/tmp/test-PicosatCNF.XXXXXX";
+    int fd = mkstemp(filename);
+    fail_unless(fd >= 0);
+    close(fd);
+    cnf.toFile(filename, true);
+    std::string image;
+    {
+        std::ifstream in(filename, std::ios_base::binary);
+        std::stringstream content;
+        content << in.rdbuf();
+        image = content.str();
+    }
+    // header (44 bytes), the literals 1 0, one variable and its index, no symbols, one meta
+    const size_t literals = 44, vars = literals + 8, var_by_id = vars + 8, metas = var_by_id + 4;
+    fail_unless(image.size() > metas + 8);
+    auto readPatched = [&](size_t offset, uint32_t value) {
+        std::string patched = image;
+        memcpy(&patched[offset], &value, sizeof(value));
+        std::ofstream(filename, std::ios_base::binary | std::ios_base::trunc) << patched;
+        PicosatCNF binary;
+        try {
+            binary.readFromFile(filename);
+        } catch (IOException &) {
+            return false;
+        }
+        return true;
+    };
+    fail_unless(readPatched(literals, 1));
+    fail_if(readPatched(literals + 4, 1));            // unterminated clause
+    fail_if(readPatched(vars, image.size()));         // name out of the string table
+    fail_if(readPatched(var_by_id, 1));               // index out of the variable table
+    fail_if(readPatched(literals, 2));                // literal above the variable count
+    fail_if(readPatched(literals, -2));               // same for a negative literal
+    fail_if(readPatched(vars + 4, 0x7fffffff));       // cnf-id above the variable count
+    fail_if(readPatched(metas + 4, 0x7fffffff));      // meta value out of the string table
+    unlink(filename);
+} END_TEST;
+
 Suite *cond_block_suite(void) {
     Suite *s  = suite_create("PicosatCNF-test");
     TCase *tc = tcase_create("PicosatCNF");
@@ -426,11 +764,19 @@ Suite *cond_block_suite(void) {
     tcase_add_test(tc, moreComplexModel);
     tcase_add_test(tc, sequentialUsage);
     tcase_add_test(tc, parallelUsage);
+    tcase_add_test(tc, interleavedModels);
+    tcase_add_test(tc, threadedUsage);
     tcase_add_test(tc, toFile);
     tcase_add_test(tc, toFileWithSymbolTable);
     tcase_add_test(tc, readCnfFileWithInts);
     tcase_add_test(tc, readCnfFileWithStrings);
     tcase_add_test(tc, addClausesToCnfFromFile);
+    tcase_add_test(tc, layeredOnBase);
+    tcase_add_test(tc, slicedOnBase);
+    tcase_add_test(tc, layersShareSolver);
+    tcase_add_test(tc, setBaseRenumbers);
+    tcase_add_test(tc, binaryFileRoundTrip);
+    tcase_add_test(tc, corruptBinaryFile);
     suite_add_tcase(s, tc);
     return s;
 }
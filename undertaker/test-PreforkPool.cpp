@@ -0,0 +1,73 @@
+#include "PreforkPool.h"
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <check.h>
+
+static int job(const std::string &item) {
+    if (item == "crash")
+        std::abort();
+    if (item == "exit")
+        _exit(3);
+    return item == "fail" ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+START_TEST(allSucceed) {
+    PreforkPool pool(3, job);
+    for (int i = 0; i < 100; i++)
+        pool.submit("ok");
+
+    const PreforkPool::Stats &stats = pool.finish();
+    fail_unless(stats.ok == 100);
+    fail_unless(stats.failed == 0);
+    fail_unless(stats.signaled == 0);
+    fail_unless(stats.failed_items.empty());
+} END_TEST;
+
+START_TEST(failedJobs) {
+    PreforkPool pool(2, job);
+    pool.submit("ok");
+    pool.submit("fail");
+    pool.submit("ok");
+
+    const PreforkPool::Stats &stats = pool.finish();
+    fail_unless(stats.ok == 2);
+    fail_unless(stats.failed == 1);
+    fail_unless(stats.failed_items.size() == 1 && stats.failed_items[0] == "fail");
+} END_TEST;
+
+START_TEST(workersAreRestarted) {
+    // a single worker has to be replaced after each crash
+    PreforkPool pool(1, job);
+    pool.submit("crash");
+    pool.submit("ok");
+    pool.submit("exit");
+    pool.submit("ok");
+    pool.submit("crash");
+    pool.submit("ok");
+
+    const PreforkPool::Stats &stats = pool.finish();
+    fail_unless(stats.ok == 3);
+    fail_unless(stats.failed == 1);
+    fail_unless(stats.signaled == 2);
+    fail_unless(stats.failed_items.size() == 3);
+} END_TEST;
+
+Suite *prefork_pool_suite(void) {
+    Suite *s  = suite_create("PreforkPool-test");
+    TCase *tc = tcase_create("PreforkPool");
+    tcase_add_test(tc, allSucceed);
+    tcase_add_test(tc, failedJobs);
+    tcase_add_test(tc, workersAreRestarted);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main() {
+    Suite *s = prefork_pool_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
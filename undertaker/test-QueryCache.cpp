@@ -0,0 +1,105 @@
+#include "QueryCache.h"
+#include "PicosatCNF.h"
+#include "bool.h"
+#include <check.h>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace kconfig;
+
+static uint64_t hashOf(const std::string &formula) {
+    std::unique_ptr<BoolExp> e(BoolExp::parseString(formula));
+    return QueryCache::hash(e.get());
+}
+
+START_TEST(formulaHashes) {
+    fail_unless(hashOf("CONFIG_A && !CONFIG_B") == hashOf("CONFIG_A&&!CONFIG_B"));
+    fail_unless(hashOf("CONFIG_A && CONFIG_B") != hashOf("CONFIG_A || CONFIG_B"));
+    fail_unless(hashOf("CONFIG_A -> CONFIG_B") != hashOf("CONFIG_B -> CONFIG_A"));
+    fail_unless(hashOf("f(CONFIG_A, CONFIG_B)") != hashOf("f(CONFIG_B, CONFIG_A)"));
+    fail_unless(hashOf("CONFIG_A") != QueryCache::hash(std::string("CONFIG_A")));
+} END_TEST;
+
+START_TEST(keys) {
+    QueryCache &cache = QueryCache::getInstance();
+    const uint64_t a = hashOf("CONFIG_A"), b = hashOf("!CONFIG_B");
+    // the same set of formulas, regardless of order and duplicates
+    fail_unless(cache.key(nullptr, {a, b}) == cache.key(nullptr, {b, a, b}));
+    fail_if(cache.key(nullptr, {a, b}) == cache.key(nullptr, {a}));
+
+    PicosatCNF model, other;
+    model.setCNFVar("CONFIG_A", model.newVar());
+    other.setCNFVar("CONFIG_B", other.newVar());
+    fail_if(cache.key(&model, {a}) == cache.key(nullptr, {a}));
+    fail_if(cache.key(&model, {a}) == cache.key(&other, {a}));
+} END_TEST;
+
+START_TEST(sharedFile) {
+    char file[] = "/tmp/test-QueryCache.XXXXXX";
+    int fd = mkstemp(file);
+    fail_unless(fd >= 0);
+    close(fd);
+
+    QueryCache &cache = QueryCache::getInstance();
+    cache.enable(file);
+    fail_unless(cache.isEnabled());
+    const QueryCache::Key sat = cache.key(nullptr, {hashOf("CONFIG_A")});
+    const QueryCache::Key unsat = cache.key(nullptr, {hashOf("CONFIG_A && !CONFIG_A")});
+    bool satisfiable;
+    fail_if(cache.lookup(sat, satisfiable));
+
+    // a worker stores results, the parent reads them from the file
+    pid_t pid = fork();
+    if (pid == 0) {
+        cache.insert(sat, true);
+        cache.insert(unsat, false);
+        _exit(cache.lookup(unsat, satisfiable) && !satisfiable ? 0 : 1);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    fail_unless(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    fail_unless(cache.lookup(sat, satisfiable) && satisfiable);
+    fail_unless(cache.lookup(unsat, satisfiable) && !satisfiable);
+    // the counters include the ones of the worker
+    const QueryCache::Stats stats = cache.getStats();
+    fail_unless(stats.hits == 3 && stats.misses == 1);
+
+    // a torn record of a failed write doesn't misalign the ones appended after it
+    fd = open(file, O_WRONLY | O_APPEND);
+    fail_unless(fd >= 0 && write(fd, "torn", 4) == 4);
+    close(fd);
+    const QueryCache::Key later = cache.key(nullptr, {hashOf("CONFIG_B")});
+    pid = fork();
+    if (pid == 0) {
+        cache.insert(later, true);
+        _exit(0);
+    }
+    waitpid(pid, &status, 0);
+    fail_unless(cache.lookup(later, satisfiable) && satisfiable);
+    unlink(file);
+} END_TEST;
+
+Suite *query_cache_suite(void) {
+    Suite *s  = suite_create("QueryCache-test");
+    TCase *tc = tcase_create("QueryCache");
+    tcase_add_test(tc, formulaHashes);
+    tcase_add_test(tc, keys);
+    tcase_add_test(tc, sharedFile);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main() {
+    Suite *s = query_cache_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
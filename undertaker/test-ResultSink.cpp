@@ -0,0 +1,162 @@
+#include "ResultSink.h"
+#include <check.h>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <boost/filesystem.hpp>
+
+static const std::string directory = "/tmp/test-ResultSink";
+static const std::string sink = directory + "/sink";
+
+static std::string readFile(const std::string &file) {
+    std::ifstream in(file);
+    std::stringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+static bool exists(const std::string &file) {
+    return boost::filesystem::exists(file);
+}
+
+// the sink can't be disabled again, it is only enabled by the tests after this one
+START_TEST(withoutSink) {
+    boost::filesystem::remove_all(directory);
+    boost::filesystem::create_directories(directory);
+    ResultSink &results = ResultSink::getInstance();
+    fail_if(results.isEnabled());
+
+    fail_unless(results.write(directory + "/a.c.config1", "CONFIG_A=y\n"));
+    fail_unless(results.write(directory + "/a.c.config2", ""));
+    fail_unless(readFile(directory + "/a.c.config1") == "CONFIG_A=y\n");
+    fail_unless(exists(directory + "/a.c.config2"));
+    fail_unless(results.remove(directory + "/a.c.config*") == 2);
+    fail_if(exists(directory + "/a.c.config1"));
+    fail_if(results.write(directory + "/missing/a.c.config1", ""));
+} END_TEST;
+
+START_TEST(deferredResults) {
+    boost::filesystem::remove_all(directory);
+    boost::filesystem::create_directories(directory);
+    ResultSink &results = ResultSink::getInstance();
+    ResultSink::Deferred deferred;
+
+    ResultSink::deferTo(&deferred);
+    fail_unless(results.write(directory + "/a.c.config1", "CONFIG_A=y\n"));
+    ResultSink::deferTo(nullptr);
+    fail_if(exists(directory + "/a.c.config1"));
+    fail_unless(deferred.size() == 1);
+
+    fail_unless(results.commit(deferred));
+    fail_unless(readFile(directory + "/a.c.config1") == "CONFIG_A=y\n");
+
+    // errors only show up when the results are stored
+    deferred.clear();
+    ResultSink::deferTo(&deferred);
+    fail_unless(results.write(directory + "/missing/a.c.config1", ""));
+    ResultSink::deferTo(nullptr);
+    fail_if(results.commit(deferred));
+} END_TEST;
+
+START_TEST(mergeRecords) {
+    boost::filesystem::remove_all(directory);
+    boost::filesystem::create_directories(directory);
+    ResultSink &results = ResultSink::getInstance();
+    results.enable(sink);
+    fail_unless(results.isEnabled());
+
+    // a report of a previous run, it is removed like without the sink
+    std::ofstream(directory + "/a.c.B1.code.globally.dead") << "old";
+    fail_unless(results.remove(directory + "/a.c*.*dead") == 1);
+    fail_unless(exists(directory + "/a.c.B1.code.globally.dead"));
+    fail_unless(results.write(directory + "/a.c.B2.code.globally.dead", "#B2\nB2\n\tdata\n"));
+    // a forked worker appends to a file of its own
+    pid_t pid = fork();
+    if (pid == 0) {
+        results.write(directory + "/b.c.config1", "CONFIG_B=y\n");
+        _exit(EXIT_SUCCESS);
+    }
+    waitpid(pid, nullptr, 0);
+    fail_unless(results.write(directory + "/a.c.B2.code.globally.dead", "#B2\nnew\n"));
+    fail_if(exists(directory + "/a.c.B2.code.globally.dead"));
+
+    size_t sinks = 0;
+    for (const auto &entry : boost::filesystem::directory_iterator(sink)) {
+        (void) entry;
+        sinks++;
+    }
+    fail_unless(sinks == 2);
+
+    fail_unless(ResultSink::merge({sink}) == 3);
+    fail_if(exists(directory + "/a.c.B1.code.globally.dead"));
+    fail_unless(readFile(directory + "/a.c.B2.code.globally.dead") == "#B2\nnew\n");
+    fail_unless(readFile(directory + "/b.c.config1") == "CONFIG_B=y\n");
+} END_TEST;
+
+START_TEST(shortWrites) {
+    boost::filesystem::remove_all(directory);
+    ResultSink &results = ResultSink::getInstance();
+    results.enable(sink);
+    // a worker runs out of space in the middle of a record
+    pid_t pid = fork();
+    if (pid == 0) {
+        signal(SIGXFSZ, SIG_IGN);
+        struct rlimit limit;
+        getrlimit(RLIMIT_FSIZE, &limit);
+        const rlim_t unlimited = limit.rlim_cur;
+        bool ok = results.write(directory + "/a.c.config1", "CONFIG_A=y\n");
+        limit.rlim_cur = 4096;
+        setrlimit(RLIMIT_FSIZE, &limit);
+        ok = !results.write(directory + "/a.c.config2", std::string(10000, 'x')) && ok;
+        limit.rlim_cur = unlimited;
+        setrlimit(RLIMIT_FSIZE, &limit);
+        ok = results.write(directory + "/a.c.config3", "CONFIG_C=y\n") && ok;
+        _exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    fail_unless(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+    fail_unless(ResultSink::merge({sink}) == 2);
+    fail_unless(readFile(directory + "/a.c.config3") == "CONFIG_C=y\n");
+    fail_if(exists(directory + "/a.c.config2"));
+} END_TEST;
+
+START_TEST(truncatedRecords) {
+    boost::filesystem::remove_all(directory);
+    boost::filesystem::create_directories(directory);
+    const std::string file = directory + "/crashed.results";
+    std::ofstream(file) << "F\t1\t" << directory.size() + 6 << "\t3\n" << directory
+                        << "/a.c.1" << "abc"
+                        << "F\t2\t" << directory.size() + 6 << "\t300\n" << directory
+                        << "/a.c.2" << "abc";
+    fail_unless(ResultSink::merge({file}) == 1);
+    fail_unless(readFile(directory + "/a.c.1") == "abc");
+    fail_if(exists(directory + "/a.c.2"));
+    boost::filesystem::remove_all(directory);
+} END_TEST;
+
+Suite *result_sink_suite(void) {
+    Suite *s  = suite_create("ResultSink-test");
+    TCase *tc = tcase_create("ResultSink");
+    tcase_add_test(tc, withoutSink);
+    tcase_add_test(tc, deferredResults);
+    tcase_add_test(tc, mergeRecords);
+    tcase_add_test(tc, shortWrites);
+    tcase_add_test(tc, truncatedRecords);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main() {
+    Suite *s = result_sink_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
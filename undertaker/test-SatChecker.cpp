@@ -72,6 +72,73 @@ START_TEST(format_config_items_simple) {
                      "CONFIG_HURZ=y\n");
 } END_TEST
 
+START_TEST(block_variables) {
+    SatChecker::AssignmentMap m;
+    m.emplace("B00", true);
+    m.emplace("B0", false);
+    m.emplace("B2", true);
+    m.emplace("B1_foo_c", true);
+    m.emplace("BAR", true);
+    m.emplace("CONFIG_FOO", true);
+
+    std::vector<bool> blocks(4, false);
+    m.setEnabledBlocks(blocks);
+    ck_assert(blocks[0] && !blocks[1] && !blocks[2] && blocks[3]);
+
+    std::stringstream ss;
+    m.formatCPP(ss, nullptr);
+    ck_assert_str_eq(ss.str().c_str(), " -DB1_foo_c=1 -DBAR=1 -DCONFIG_FOO=1\n");
+} END_TEST
+
+START_TEST(assignment_projection) {
+    SatChecker::AssignmentProjection projection([](const std::string &name) {
+        return name != "B0";
+    });
+    SatChecker::AssignmentMap a, b;
+    a.emplace("CONFIG_A", true);
+    a.emplace("B0", true);
+    b.emplace("CONFIG_A", true);
+    b.emplace("B0", false);
+    b.emplace("CONFIG_B", false);
+    fail_unless(projection.bit("B0") == -1);
+
+    const SatChecker::AssignmentProjection::Bits pa = projection.project(a);
+    const SatChecker::AssignmentProjection::Bits pb = projection.project(b);
+    fail_if(pa == pb);
+    b.erase("CONFIG_B");
+    fail_unless(pa == projection.project(b));
+    fail_unless(SatChecker::AssignmentProjection::Hash()(pa)
+                == SatChecker::AssignmentProjection::Hash()(projection.project(b)));
+
+    const SatChecker::AssignmentProjection::Bits common
+        = SatChecker::AssignmentProjection::common({pa, pb});
+    fail_unless(common.getValue(projection.bit("CONFIG_A")));
+    fail_if(common.isAssigned(projection.bit("CONFIG_B")));
+} END_TEST
+
+START_TEST(pprint_assignments) {
+    SatChecker::AssignmentMap a, b;
+    a.emplace("CONFIG_A", true);
+    a.emplace("CONFIG_B", true);
+    b.emplace("CONFIG_A", true);
+    b.emplace("CONFIG_B", false);
+    b.emplace("CONFIG_C", false);
+
+    std::stringstream ss;
+    SatChecker::pprintAssignments(ss, {a, b}, nullptr, MissingSet());
+    ck_assert_str_eq(ss.str().c_str(),
+                     "I: Found 2 assignments\n"
+                     "I: Entries in missingSet: 0\n"
+                     "I: In all assignments the following symbols are equally set\n"
+                     "CONFIG_A=1\n"
+                     "I: All differences in the assignments\n"
+                     "I: Config 0\n"
+                     "CONFIG_B=1\n"
+                     "I: Config 1\n"
+                     "CONFIG_B=0\n"
+                     "CONFIG_C=0\n");
+} END_TEST
+
 START_TEST(format_config_items_module) {
     MissingSet dummy;
     SatChecker::AssignmentMap m;
@@ -116,13 +183,25 @@ START_TEST(test_base_expression) {
     fail_if(sat(a1));
 } END_TEST
 
+START_TEST(failed_assumptions) {
+    BaseExpressionSatChecker sat("(A -> !B) && C");
+    fail_if(sat({"A", "B", "C"}));
+    const std::set<std::string> failed = sat.getFailedAssumptions();
+    fail_unless(failed.count("A") == 1 && failed.count("B") == 1);
+    fail_unless(sat({"A", "C"}));
+} END_TEST
+
 Suite * satchecker_suite(void) {
     Suite *s  = suite_create("SatChecker");
     TCase *tc = tcase_create("SatChecker");
     tcase_add_test(tc, format_config_items_simple);
     tcase_add_test(tc, format_config_items_module);
+    tcase_add_test(tc, block_variables);
+    tcase_add_test(tc, assignment_projection);
+    tcase_add_test(tc, pprint_assignments);
     tcase_add_test(tc, format_config_items_module_not_valid_in_kconfig);
     tcase_add_test(tc, test_base_expression);
+    tcase_add_test(tc, failed_assumptions);
 
     suite_add_tcase(s, tc);
 
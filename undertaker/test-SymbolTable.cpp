@@ -0,0 +1,108 @@
+#include "SymbolTable.h"
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <check.h>
+
+START_TEST(internAndLookup) {
+    fail_unless(SymbolTable::lookup("CONFIG_NEVER_INTERNED") == 0);
+
+    SymbolId foo = SymbolTable::intern("CONFIG_FOO");
+    SymbolId bar = SymbolTable::intern("CONFIG_BAR");
+    fail_unless(foo != 0 && bar != 0 && foo != bar);
+    fail_unless(SymbolTable::intern("CONFIG_FOO") == foo);
+    fail_unless(SymbolTable::lookup("CONFIG_BAR") == bar);
+    fail_unless(SymbolTable::name(foo) == "CONFIG_FOO");
+    fail_unless(SymbolTable::name(bar) == "CONFIG_BAR");
+} END_TEST;
+
+START_TEST(manySymbols) {
+    // enough names to grow the index and to fill several chunks
+    std::vector<SymbolId> ids;
+    for (int i = 0; i < 100000; i++)
+        ids.push_back(SymbolTable::intern("CONFIG_MANY_" + std::to_string(i)));
+    for (int i = 0; i < 100000; i++) {
+        const std::string name = "CONFIG_MANY_" + std::to_string(i);
+        fail_unless(SymbolTable::lookup(name) == ids[i]);
+        fail_unless(SymbolTable::name(ids[i]) == name);
+    }
+} END_TEST;
+
+START_TEST(concurrentInterning) {
+    // all threads intern the same names and have to agree on the ids
+    std::vector<std::vector<SymbolId>> ids(4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+        threads.emplace_back([t, &ids]() {
+            for (int i = 0; i < 20000; i++)
+                ids[t].push_back(SymbolTable::intern("CONFIG_SHARED_" + std::to_string(i)));
+        });
+    for (std::thread &thread : threads)
+        thread.join();
+    for (int t = 1; t < 4; t++)
+        fail_unless(ids[t] == ids[0]);
+    fail_unless(std::set<SymbolId>(ids[0].begin(), ids[0].end()).size() == 20000);
+} END_TEST;
+
+START_TEST(lookupWhileInterning) {
+    // lookups don't take the lock, but must find every name interned before, even while
+    // another thread grows the index
+    const SymbolId known = SymbolTable::intern("CONFIG_KNOWN_BEFORE");
+    bool missed = false;
+    std::thread writer([]() {
+        for (int i = 0; i < 200000; i++)
+            SymbolTable::intern("CONFIG_GROWING_" + std::to_string(i));
+    });
+    std::thread reader([known, &missed]() {
+        for (int i = 0; i < 200000; i++)
+            if (SymbolTable::lookup("CONFIG_KNOWN_BEFORE") != known)
+                missed = true;
+    });
+    writer.join();
+    reader.join();
+    fail_if(missed);
+    fail_unless(SymbolTable::lookup("CONFIG_GROWING_199999") != 0);
+} END_TEST;
+
+START_TEST(symbolMap) {
+    SymbolMap<int> map;
+    fail_unless(map.find(1) == nullptr);
+    for (SymbolId id = 1; id <= 1000; id++)
+        map[id] = id * 2;
+    fail_unless(map.size() == 1000);
+    for (SymbolId id = 1; id <= 1000; id++)
+        fail_unless(map.find(id) && *map.find(id) == (int) id * 2);
+    fail_unless(map.find(1001) == nullptr);
+
+    int sum = 0;
+    map.forEach([&sum](SymbolId, int value) { sum += value; });
+    fail_unless(sum == 1000 * 1001);
+
+    SymbolSet set;
+    fail_unless(set.insert(42));
+    fail_if(set.insert(42));
+    fail_unless(set.contains(42));
+    fail_if(set.contains(43));
+} END_TEST;
+
+Suite *symbol_table_suite(void) {
+    Suite *s  = suite_create("SymbolTable-test");
+    TCase *tc = tcase_create("SymbolTable");
+    tcase_add_test(tc, internAndLookup);
+    tcase_add_test(tc, manySymbols);
+    tcase_add_test(tc, concurrentInterning);
+    tcase_add_test(tc, lookupWhileInterning);
+    tcase_add_test(tc, symbolMap);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main() {
+    Suite *s = symbol_table_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,104 @@
+#include "WorkStealingPool.h"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <check.h>
+
+static std::vector<std::string> makeItems(int n) {
+    std::vector<std::string> items;
+    for (int i = 0; i < n; i++)
+        items.push_back("file" + std::to_string(i) + ".c");
+    return items;
+}
+
+START_TEST(singleWorker) {
+    WorkStealingPool pool(1);
+    std::vector<std::string> items = makeItems(10);
+    std::vector<std::string> seen;
+
+    pool.run(items, [&seen](const std::string &item) { seen.push_back(item); });
+
+    // a single worker processes the items in worklist order
+    fail_unless(seen == items);
+} END_TEST;
+
+START_TEST(everyItemOnce) {
+    WorkStealingPool pool(4);
+    std::vector<std::string> items = makeItems(1000);
+    std::map<std::string, int> seen;
+    std::mutex lock;
+
+    pool.run(items, [&](const std::string &item) {
+        std::lock_guard<std::mutex> guard(lock);
+        seen[item]++;
+    });
+
+    fail_unless(seen.size() == items.size());
+    for (const auto &entry : seen)  // pair<string, int>
+        fail_unless(entry.second == 1, "%s processed %d times", entry.first.c_str(),
+                    entry.second);
+} END_TEST;
+
+START_TEST(moreWorkersThanItems) {
+    WorkStealingPool pool(8);
+    std::atomic<int> count(0);
+
+    pool.run(makeItems(3), [&count](const std::string &) { count++; });
+    fail_unless(count == 3);
+
+    pool.run({}, [&count](const std::string &) { count++; });
+    fail_unless(count == 3);
+} END_TEST;
+
+START_TEST(idleWorkersSteal) {
+    WorkStealingPool pool(2);
+    // worker 0 gets file0.c to file3.c, worker 1 gets file4.c to file7.c
+    std::vector<std::string> items = makeItems(8);
+    std::map<std::string, std::thread::id> worker;
+    std::atomic<int> others(0);
+    std::mutex lock;
+
+    pool.run(items, [&](const std::string &item) {
+        if (item == "file0.c") {
+            // block worker 0 until all other items are done, which is
+            // only possible if worker 1 steals file1.c to file3.c
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (others < 7 && std::chrono::steady_clock::now() < deadline)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        } else {
+            others++;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        worker[item] = std::this_thread::get_id();
+    });
+
+    // the other items did not have to wait for file0.c
+    fail_unless(others == 7);
+    fail_unless(worker.size() == 8);
+    for (const std::string stolen : {"file1.c", "file2.c", "file3.c"})
+        fail_unless(worker[stolen] == worker["file7.c"], "%s was not stolen", stolen.c_str());
+} END_TEST;
+
+Suite *work_stealing_pool_suite(void) {
+    Suite *s  = suite_create("WorkStealingPool-test");
+    TCase *tc = tcase_create("WorkStealingPool");
+    tcase_add_test(tc, singleWorker);
+    tcase_add_test(tc, everyItemOnce);
+    tcase_add_test(tc, moreWorkersThanItems);
+    tcase_add_test(tc, idleWorkersSteal);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main() {
+    Suite *s = work_stealing_pool_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    int number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
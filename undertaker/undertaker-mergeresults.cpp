@@ -0,0 +1,70 @@
+/*
+ *   undertaker-mergeresults - writes the result files recorded by 'undertaker -R'
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ResultSink.h"
+#include "Logging.h"
+#include "exceptions/IOException.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <unistd.h>
+
+
+static void usage(void) {
+    std::cerr << "undertaker-mergeresults [-v] [-q] <directory|file>..." << std::endl;
+    std::cerr << "  -v           increase verbosity" << std::endl;
+    std::cerr << "  -q           decrease verbosity" << std::endl;
+    std::cerr << "Writes the defect reports and configurations recorded by 'undertaker -R <directory>'"
+              << std::endl;
+    std::cerr << "as files, like undertaker does without -R. Relative names are relative to the"
+              << std::endl;
+    std::cerr << "directory undertaker was started in." << std::endl;
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+    int loglevel = Logging::getLogLevel();
+
+    while ((opt = getopt(argc, argv, "vqh")) != -1) {
+        switch (opt) {
+        case 'q':
+            loglevel = loglevel + 10;
+            Logging::setLogLevel(loglevel);
+            break;
+        case 'v':
+            loglevel = loglevel - 10;
+            if (loglevel < 0)
+                loglevel = Logging::LOG_EVERYTHING;
+            Logging::setLogLevel(loglevel);
+            break;
+        default:
+            usage();
+        }
+    }
+    if (optind >= argc)
+        usage();
+
+    try {
+        const size_t written = ResultSink::merge({argv + optind, argv + argc});
+        Logging::info("wrote ", written, " result files");
+    } catch (kconfig::IOException &e) {
+        Logging::error(e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -34,17 +34,35 @@
 #include "CoverageAnalyzer.h"
 #include "Logging.h"
 #include "Tools.h"
+#include "bool.h"
+#include "WorkStealingPool.h"
+#include "PreforkPool.h"
+#include "QueryCache.h"
+#include "AnalysisIndex.h"
+#include "CppFileSnapshot.h"
+#include "ResultSink.h"
+#include "BlockEvaluator.h"
+#include "exceptions/CNFBuilderError.h"
+#include "exceptions/IOException.h"
 #include "../version.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <exception>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <vector>
 #include <sys/wait.h>
-#include <glob.h>
 
 #include <boost/regex.hpp>
 #include <boost/thread.hpp>
 #include <boost/chrono.hpp>
+#include <boost/filesystem.hpp>
 
 
 using process_file_cb_t = void (*)(const std::string &filename);
@@ -63,12 +81,43 @@ enum class CoverageOutput {
 enum class CoverageMode {
     SIMPLE,    // simple, fast
     MINIMIZE,  // hopefully minimal configuration set
+    MAXSAT,    // most new blocks per configuration, within a time budget
 } coverageMode;
 
 static const char *coverage_exec_cmd = "cat";
 static bool skip_non_configuration_based_defects = false;
 static bool decision_coverage = false;
+//! seconds the maxsat coverage algorithm may spend on improving the configurations of a file
+static unsigned int coverage_budget = 60;
+//! seconds a coverage job may take in addition to the budget, e.g., for parsing the file
+static const unsigned int coverage_margin = 60;
 static bool do_mus_analysis = false;
+//! the concrete configurations of the blockeval job, see -K
+static ConfigurationSet configurations;
+
+/**
+ * \brief Thrown by the process_file_* jobs if a worklist entry cannot be processed
+ *
+ * The reason has already been reported when this is thrown, the caller
+ * only has to account for the failure.
+ */
+struct JobFailed : public std::runtime_error {
+    JobFailed() : runtime_error("job failed") {}
+};
+
+//! number of job threads that were abandoned after a timeout and may still be running
+static std::atomic<int> abandoned_jobs(0);
+
+/**
+ * Standard output of the job running on this thread. run_job passes the
+ * output of each job on in one piece, so the lines of jobs running in
+ * parallel threads don't interleave. Jobs started by run_with_timeout
+ * write into a buffer of their own, which is only passed on if they
+ * finish in time.
+ */
+static thread_local std::ostream *job_output = &std::cout;
+//! serializes the output of jobs running in parallel threads
+static std::mutex job_output_lock;
 
 void usage(std::ostream &out, const char *error) {
     if (error)
@@ -107,11 +156,30 @@ void usage(std::ostream &out, const char *error) {
     "                       (format in the file: see blockconf format)\n"
     "      blockrange     - List all blocks with the corresponding line ranges \n"
     "                       (output-format: <file>:<blockID>:<start>:<end>)\n"
-    "  -b  batch mode: analyze all files in a given worklist-file\n"
-    "  -t  specify a number of parallel processes (default: 1)\n"
+    "      blockeval      - List the enabled blocks for each configuration given with -K\n"
+    "                       (output-format: <file>:<config>:<bitmap>, with one character\n"
+    "                       per block B0, B1, ...: '1' enabled, '0' disabled, '?' unknown)\n"
+    "  -b  batch mode: analyze all files in a given worklist-file (- for stdin)\n"
+    "  -t  specify a number of parallel worker processes (default: 1)\n"
+    "  -T  use threads instead of processes for parallel batch mode\n"
+    "      (shares the loaded models, but a crash aborts the whole run)\n"
     "  -I  add an include path for #include directives\n"
+    "  -P  keep snapshots of the parsed files in the given directory and use them\n"
+    "      instead of parsing unchanged files again\n"
     "  -s  skip non-configuration based defect reports\n"
     "  -u  calculate a 'minimal unsatisfiable subset' of the defect-formula\n"
+    "  -p  use a compact, polarity aware CNF encoding for the checked formulas\n"
+    "  -S  solve only the clauses of cnf models connected to each dead/undead check\n"
+    "      (given twice: also solve the whole model and report differing results)\n"
+    "  -Q  cache the results of dead/undead checks in the given file, which may be\n"
+    "      shared by concurrent runs ('-': in memory only)\n"
+    "  -K  add a configuration (.config file) for the blockeval job, a directory\n"
+    "      adds all files in it\n"
+    "  -R  append the defect reports and configurations to one file per worker in the\n"
+    "      given directory instead of writing a file for each of them, use\n"
+    "      undertaker-mergeresults to write the files later on, not with -x\n"
+    "  -x  keep the results of the dead analysis in the given index and only analyze\n"
+    "      files whose content or model slice changed since they were indexed\n"
     "\nCoverage Options:\n"
     "  -O: specify the output mode of generated configurations\n"
     "      kconfig   - generated partial kconfig configuration (default)\n"
@@ -126,6 +194,10 @@ void usage(std::ostream &out, const char *error) {
     "      min              - slow but generates less configuration sets\n"
     "      simple_decision  - simple and decision coverage instead statement coverage\n"
     "      min_decision     - min and decision coverage instead statement coverage\n"
+    "      maxsat[:secs]    - as many new blocks per configuration as possible, the bound\n"
+    "                         is searched for at most secs seconds per file (default: 60),\n"
+    "                         files time out no sooner than 60 seconds after it\n"
+    "      maxsat_decision[:secs] - maxsat and decision coverage instead statement coverage\n"
     "\nSpecifying Files:\n"
     "  You can specify one or more 'file' arguments.\n"
     "  Some jobs require a different input format for 'file' arguments (i.e. blockconf).\n"
@@ -133,17 +205,100 @@ void usage(std::ostream &out, const char *error) {
 // XXX currently undocumented -O exec:cmd, -O commented, interactive mode
 }
 
-int rm_pattern(const char *pattern) {
-    glob_t globbuf;
+/**
+ * Runs 'helper(filename)' in a separate thread and waits at most 'seconds' for it.
+ *
+ * Exceptions thrown by the helper are passed on to the caller. On timeout,
+ * JobFailed is thrown and the helper thread is abandoned, it cannot be
+ * cancelled and keeps running until it finishes on its own. Its standard
+ * output and result files are held back until it finishes in time, so an
+ * abandoned helper never publishes results (it may still hold the lock of
+ * the parser for a while, which only delays other threads).
+ */
+void run_with_timeout(process_file_cb_t helper, const std::string &filename,
+                      unsigned int seconds) {
+    // shared with the helper thread, which may outlive this function
+    struct Results {
+        std::exception_ptr error;
+        std::ostringstream output;
+        ResultSink::Deferred files;
+    };
+    auto results = std::make_shared<Results>();
+    boost::thread t([helper, filename, results]() {
+        job_output = &results->output;
+        ResultSink::deferTo(&results->files);
+        try {
+            helper(filename);
+        } catch (...) {
+            results->error = std::current_exception();
+        }
+    });
+
+    if (!t.try_join_for(boost::chrono::seconds(seconds))) {
+        Logging::error("timeout passed while processing ", filename);
+        t.detach();
+        abandoned_jobs++;
+        throw JobFailed();
+    }
+    // like without holding them back, failed jobs pass on the results they have so far
+    const bool stored = ResultSink::getInstance().commit(results->files);
+    *job_output << results->output.str();
+    if (results->error)
+        std::rethrow_exception(results->error);
+    // the helper took its results as written, they were only stored now
+    if (!stored) {
+        Logging::error("failed to store the results of ", filename);
+        throw JobFailed();
+    }
+}
+
+/**
+ * Runs a single job and converts failures into an exit code.
+ *
+ * \return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int run_job(process_file_cb_t process_file, const std::string &argument) {
+    std::ostringstream output;
+    job_output = &output;
+    int status = EXIT_SUCCESS;
+    try {
+        process_file(argument);
+    } catch (JobFailed &) {
+        status = EXIT_FAILURE;
+    } catch (std::exception &e) {
+        Logging::error("processing ", argument, " failed: ", e.what());
+        status = EXIT_FAILURE;
+    }
+    job_output = &std::cout;
+    std::lock_guard<std::mutex> guard(job_output_lock);
+    std::cout << output.str() << std::flush;
+    return status;
+}
 
-    glob(pattern, 0, nullptr, &globbuf);
-    int nr = globbuf.gl_pathc;
-    for (int i = 0; i < nr; i++)
-        if (0 != unlink(globbuf.gl_pathv[i]))
-            fprintf(stderr, "E: Couldn't unlink %s: %m", globbuf.gl_pathv[i]);
+/**
+ * Returns 'status' as exit code of main().
+ *
+ * If a job thread was abandoned after a timeout, it may still use the
+ * loaded models. In that case the process is terminated without running
+ * the destructors of static objects.
+ */
+int finish(int status) {
+    if (abandoned_jobs > 0) {
+        std::cout << std::flush;
+        std::cerr << std::flush;
+        std::quick_exit(status);
+    }
+    return status;
+}
 
-    globfree(&globbuf);
-    return nr;
+//! reports the hits and misses of the query cache of all workers, returns 'status'
+int print_cache_stats(int status) {
+    if (QueryCache::getInstance().isEnabled()) {
+        const QueryCache::Stats stats = QueryCache::getInstance().getStats();
+        Logging::info("Query cache hits:     ", stats.hits);
+        Logging::info("Query cache misses:   ", stats.misses);
+    }
+    return status;
 }
 
 bool process_blockconf_helper(UniqueStringJoiner &sj, std::map<std::string, bool> &filesolvable,
@@ -239,8 +394,8 @@ void process_mergeblockconf(const std::string &filename) {
     /* Read files from worklist */
     std::ifstream workfile(filename);
     if (!workfile.good()) {
-        usage(std::cout, "worklist was not found");
-        std::exit(EXIT_FAILURE);
+        usage(*job_output, "worklist was not found");
+        throw JobFailed();
     }
 
     /* set extended Blockname */
@@ -276,7 +431,7 @@ void process_mergeblockconf(const std::string &filename) {
     // We want minimal configs, so we try to get many 'n's from the sat checker
     if (sc(sj.join("\n&&\n"))) {
         Logging::info("Solution found, result:");
-        sc.getAssignment().formatKconfig(std::cout, {});
+        sc.getAssignment().formatKconfig(*job_output, {});
     } else {
         Logging::error("Wasn't able to generate a valid configuration");
     }
@@ -286,19 +441,23 @@ void process_blockconf(const std::string &locationname) {
     UniqueStringJoiner sj;
     std::map<std::string, bool> filesolvable;
     if(!process_blockconf_helper(sj, filesolvable, locationname))
-        std::exit(EXIT_FAILURE);
+        throw JobFailed();
 
     SatChecker sc(ModelContainer::lookupMainModel(), Picosat::SAT_MIN);
     if (sc(sj.join("\n&&\n")))
-        sc.getAssignment().formatKconfig(std::cout, {});
+        sc.getAssignment().formatKconfig(*job_output, {});
 }
 
 void process_file_coverage_helper(const std::string &filename) {
-    CppFile file(filename);
+    // commented sources are printed from the Puma tokens, which snapshots don't have
+    const bool commented = coverageOutputMode == CoverageOutput::COMMENTED
+        || coverageOutputMode == CoverageOutput::COMBINED
+        || coverageOutputMode == CoverageOutput::EXEC;
+    CppFile file(filename, !commented);
 
     if (!file.good()) {
         Logging::error("failed to open file: `", filename, "'");
-        std::exit(EXIT_FAILURE);
+        throw JobFailed();
     } else if (decision_coverage) {
         file.decisionCoverage();
     }
@@ -307,8 +466,13 @@ void process_file_coverage_helper(const std::string &filename) {
 
     SimpleCoverageAnalyzer simple_analyzer(&file);
     MinimizeCoverageAnalyzer minimize_analyzer(&file);
+    MaxSatCoverageAnalyzer maxsat_analyzer(&file, coverage_budget);
     CoverageAnalyzer *analyzer = nullptr;
-    if (coverageMode == CoverageMode::MINIMIZE) {
+    if (coverageMode == CoverageMode::MAXSAT) {
+        Logging::debug("Calculating configurations using the 'maxsat",
+                       (decision_coverage ? " and decision coverage'" : "'"), " approach");
+        analyzer = &maxsat_analyzer;
+    } else if (coverageMode == CoverageMode::MINIMIZE) {
         Logging::debug("Calculating configurations using the 'greedy",
                        (decision_coverage ? " and decision coverage'" : "'"), " approach");
         analyzer = &minimize_analyzer;
@@ -333,50 +497,32 @@ void process_file_coverage_helper(const std::string &filename) {
     MissingSet missingSet = analyzer->getMissingSet();
 
     if (coverageOutputMode == CoverageOutput::STDOUT) {
-        SatChecker::pprintAssignments(std::cout, solutions, main_model, missingSet);
+        SatChecker::pprintAssignments(*job_output, solutions, main_model, missingSet);
         file.pop_front();
         return;
     }
 
+    ResultSink &sink = ResultSink::getInstance();
     int cruft = 0;
-    std::string pattern(filename);
-    pattern.append(".cppflags*");
-    cruft += rm_pattern(pattern.c_str());
+    cruft += sink.remove(filename + ".cppflags*");
+    cruft += sink.remove(filename + ".source*");
+    cruft += sink.remove(filename + ".config*");
 
-    pattern = filename;
-    pattern.append(".source*");
-    cruft += rm_pattern(pattern.c_str());
-
-    pattern = filename;
-    pattern.append(".config*");
-    cruft += rm_pattern(pattern.c_str());
-
-    Logging::info("Removed ", cruft, " leftovers for ", filename);
+    if (sink.isEnabled())
+        Logging::info("Recorded ", cruft, " removals of leftovers for ", filename);
+    else
+        Logging::info("Removed ", cruft, " leftovers for ", filename);
 
     int config_count = 1;
     std::vector<bool> block_bitvector(file.size(), false);
 
     unsigned int current = 0;
     for (auto &solution : solutions) {  // Satchecker::AssignmentMap
-        static const boost::regex block_regexp("B[0-9]+");
-        std::stringstream outfstream;
-        outfstream << filename << ".config" << config_count++;
-        std::ofstream outf;
+        const std::string outfile = filename + ".config" + std::to_string(config_count++);
+        std::ostringstream outf;
 
         solution.setEnabledBlocks(block_bitvector);
 
-        if (coverageOutputMode == CoverageOutput::KCONFIG
-            || coverageOutputMode == CoverageOutput::MODEL
-            || coverageOutputMode == CoverageOutput::ALL) {
-            outf.open(outfstream.str(), std::ios_base::trunc);
-            if (!outf.good()) {
-                Logging::error(" failed to write config in ", outfstream.str());
-                outf.close();
-                current++;
-                continue;
-            }
-        }
-
         switch (coverageOutputMode) {
         case CoverageOutput::KCONFIG:
             solution.formatKconfig(outf, missingSet);
@@ -384,7 +530,7 @@ void process_file_coverage_helper(const std::string &filename) {
         case CoverageOutput::MODEL:
             if (!main_model) {
                 Logging::error("no model loaded but, model output mode specified");
-                std::exit(EXIT_FAILURE);
+                throw JobFailed();
             }
             solution.formatModel(outf, main_model);
             break;
@@ -392,7 +538,7 @@ void process_file_coverage_helper(const std::string &filename) {
             solution.formatAll(outf);
             break;
         case CoverageOutput::CPP:
-            solution.formatCPP(std::cout, main_model);
+            solution.formatCPP(*job_output, main_model);
             break;
         case CoverageOutput::EXEC:
             solution.formatExec(file, coverage_exec_cmd);
@@ -407,7 +553,12 @@ void process_file_coverage_helper(const std::string &filename) {
         default:
             assert(false);
         }
-        outf.close();
+        if (coverageOutputMode == CoverageOutput::KCONFIG
+            || coverageOutputMode == CoverageOutput::MODEL
+            || coverageOutputMode == CoverageOutput::ALL) {
+            if (!sink.write(outfile, outf.str()))
+                Logging::error(" failed to write config in ", outfile);
+        }
         current++;
     }
 
@@ -427,12 +578,9 @@ void process_file_coverage_helper(const std::string &filename) {
 }
 
 void process_file_coverage(const std::string &filename) {
-    boost::thread t(process_file_coverage_helper, filename);
-
-    if (!t.try_join_for(boost::chrono::seconds(120))) {
-        Logging::error("timeout passed while processing ", filename);
-        std::exit(EXIT_FAILURE);
-    }
+    const unsigned int timeout = coverageMode == CoverageMode::MAXSAT
+        ? std::max(120u, coverage_budget + coverage_margin) : 120;
+    run_with_timeout(process_file_coverage_helper, filename, timeout);
 }
 
 void process_file_cpppc(const std::string &filename) {
@@ -440,7 +588,7 @@ void process_file_cpppc(const std::string &filename) {
 
     if (!file.good()) {
         Logging::error("failed to open file: `", filename, "'");
-        std::exit(EXIT_FAILURE);
+        throw JobFailed();
     } else if (decision_coverage) {
         file.decisionCoverage();
     }
@@ -469,7 +617,7 @@ void process_file_cpppc(const std::string &filename) {
             main_model->doIntersect(code_formula, nullptr, missingSet, code_formula);
             sj.push_back(code_formula);
         }
-        std::cout << sj.join("\n&& ") << std::endl;
+        *job_output << sj.join("\n&& ") << std::endl;
     } catch (std::runtime_error &e) {
         Logging::error("failed: ", e.what());
         return;
@@ -485,7 +633,7 @@ void process_file_cppsym_helper(const std::string &filename) {
     CppFile file(filename);
     if (!file.good()) {
         Logging::error("failed to open file: `", filename, "'");
-        std::exit(EXIT_FAILURE);
+        throw JobFailed();
     }
     // if the current file is arch specific, use only the matching model for analyses
     ConfigurationModel *main_model;
@@ -498,7 +646,8 @@ void process_file_cppsym_helper(const std::string &filename) {
     static const boost::regex valid_item("^([A-Za-z_][0-9A-Za-z_]*?)(\\.*)(_MODULE)?$");
     for (const auto &block : file) {  // ConditionalBlock *
         std::string expr = block->ifdefExpression();
-        for (const std::string &item : undertaker::itemsOfString(expr)) {
+        // each expression is scanned once here, so the cache of itemsOfString is not used
+        for (const std::string &item : kconfig::BoolExp::symbolsOfString(expr)) {
             boost::smatch what;
 
             if (boost::regex_match(item, what, valid_item)) {
@@ -547,17 +696,12 @@ void process_file_cppsym_helper(const std::string &filename) {
                                                                        : "NOT_CONFIG_LIKE");
         }
         assert(sj.size() == 5);
-        std::cout << sj.join(", ") << std::endl;
+        *job_output << sj.join(", ") << std::endl;
     }
 }
 
 void process_file_cppsym(const std::string &filename) {
-    boost::thread t(process_file_cppsym_helper, filename);
-
-    if (!t.try_join_for(boost::chrono::seconds(30))) {
-        Logging::error("timeout passed while processing ", filename);
-        std::exit(EXIT_FAILURE);
-    }
+    run_with_timeout(process_file_cppsym_helper, filename, 30);
 }
 
 void process_file_blockrange_helper(const std::string &filename) {
@@ -565,34 +709,55 @@ void process_file_blockrange_helper(const std::string &filename) {
 
     if (!cpp.good()) {
         Logging::error("failed to open file: `", filename, "'");
-        std::exit(EXIT_FAILURE);
+        throw JobFailed();
     }
 
-    std::cout << filename << ":" << cpp.topBlock()->getName() << ":";
-    std::cout << cpp.topBlock()->lineStart() << ":" << cpp.topBlock()->lineEnd() << std::endl;
+    *job_output << filename << ":" << cpp.topBlock()->getName() << ":";
+    *job_output << cpp.topBlock()->lineStart() << ":" << cpp.topBlock()->lineEnd() << std::endl;
     /* Iterate over all Blocks */
     for (const auto &block : cpp) {  // ConditionalBlock *
-        std::cout << filename << ":" << block->getName() << ":";
-        std::cout << block->lineStart() << ":" << block->lineEnd() << std::endl;
+        *job_output << filename << ":" << block->getName() << ":";
+        *job_output << block->lineStart() << ":" << block->lineEnd() << std::endl;
     }
 }
 
 void process_file_blockrange(const std::string &filename) {
-    boost::thread t(process_file_blockrange_helper, filename);
+    run_with_timeout(process_file_blockrange_helper, filename, 10);
+}
 
-    if (!t.try_join_for(boost::chrono::seconds(10))) {
-        Logging::error("timeout passed while processing ", filename);
-        std::exit(EXIT_FAILURE);
+void process_file_blockeval_helper(const std::string &filename) {
+    CppFile file(filename);
+    if (!file.good()) {
+        Logging::error("failed to open file: `", filename, "'");
+        throw JobFailed();
+    }
+    try {
+        BlockEvaluator evaluator(file);
+        evaluator.evaluate(configurations);
+
+        // one write for all lines, the output of parallel workers must not interleave
+        std::string out;
+        for (size_t config = 0; config < configurations.size(); config++)
+            out += filename + ":" + configurations.getName(config) + ":"
+                + evaluator.getBitmap(config) + "\n";
+        *job_output << out << std::flush;
+    } catch (CNFBuilderError &e) {
+        Logging::error("Couldn't process ", filename, ": ", e.what());
+        throw JobFailed();
     }
 }
 
+void process_file_blockeval(const std::string &filename) {
+    run_with_timeout(process_file_blockeval_helper, filename, 120);
+}
+
 void process_file_blockpc(const std::string &filename) {
     std::string file, position;
     size_t colon_pos = filename.find_first_of(':');
 
     if (colon_pos == filename.npos) {
         Logging::error("invalid format for block precondition");
-        std::exit(EXIT_FAILURE);
+        throw JobFailed();
     }
 
     file = filename.substr(0, colon_pos);
@@ -601,14 +766,14 @@ void process_file_blockpc(const std::string &filename) {
     CppFile cpp(file);
     if (!cpp.good()) {
         Logging::error("failed to open file: `", filename, "'");
-        std::exit(EXIT_FAILURE);
+        throw JobFailed();
     }
 
     ConditionalBlock *block = cpp.getBlockAtPosition(filename);
 
     if (block == nullptr) {
         Logging::info("No block at ", filename, " was found.");
-        std::exit(EXIT_FAILURE);
+        throw JobFailed();
     }
     // if the current file is arch specific, use only the matching model for analyses
     ConfigurationModel *main_model;
@@ -624,19 +789,17 @@ void process_file_blockpc(const std::string &filename) {
                   " | Global: ", (defect ? defect->isGlobal() : 0));
 
     /* Get and print the Precondition */
-    std::cout << BlockDefectAnalyzer::getBlockPrecondition(block, main_model) << std::endl;
+    *job_output << BlockDefectAnalyzer::getBlockPrecondition(block, main_model) << std::endl;
 }
 
 void process_file_dead_helper(const std::string &filename) {
     CppFile file(filename);
     if (!file.good()) {
         Logging::error("failed to open file: `", filename, "'");
-        std::exit(EXIT_FAILURE);
+        throw JobFailed();
     }
     // delete potential leftovers from previous run
-    std::string pattern(filename);
-    pattern.append("*.*dead");
-    rm_pattern(pattern.c_str());
+    ResultSink::getInstance().remove(filename + "*.*dead");
 
     // if the current file is arch specific, use only the matching model for analyses
     ConfigurationModel *main_model;
@@ -645,10 +808,16 @@ void process_file_dead_helper(const std::string &filename) {
     else
         main_model = ModelContainer::lookupMainModel();
 
-    static auto processBlock = [](ConditionalBlock *block, ConfigurationModel *main_model) {
-        const BlockDefect *defect = BlockDefectAnalyzer::analyzeBlock(block, main_model);
+    // most blocks have no defect, which one solver for the whole file shows quickly
+    FileDefectFilter filter(&file, main_model);
+
+    std::vector<std::string> reports;
+    auto processBlock = [&filter, &reports](ConditionalBlock *block,
+                                            ConfigurationModel *main_model) {
+        const BlockDefect *defect = BlockDefectAnalyzer::analyzeBlock(block, main_model, &filter);
         if (defect) {
-            defect->writeReportToFile(skip_non_configuration_based_defects);
+            if (defect->writeReportToFile(skip_non_configuration_based_defects))
+                reports.push_back(defect->getDefectReportFilename());
             if (do_mus_analysis)
                 defect->reportMUS(main_model);
             delete defect;
@@ -660,22 +829,27 @@ void process_file_dead_helper(const std::string &filename) {
     /* Iterate over all Blocks */
     for (const auto &block : file)  // ConditionalBlock *
         processBlock(block, main_model);
+
+    AnalysisIndex &index = AnalysisIndex::getInstance();
+    if (index.isEnabled())
+        index.record(filename, file, reports);
 }
 
 void process_file_dead(const std::string &filename) {
-    boost::thread t(process_file_dead_helper, filename);
-    static unsigned int timeout = 150;  // default timeout in seconds
+    unsigned int timeout = 150;  // default timeout in seconds
+
+    AnalysisIndex &index = AnalysisIndex::getInstance();
+    if (index.isEnabled() && index.isUpToDate(filename)) {
+        Logging::info("reusing the results of ", filename, " from the index");
+        return;
+    }
 
     ConfigurationModel *main_model = ModelContainer::lookupMainModel();
     if (main_model && "cnf" == main_model->getModelVersionIdentifier()) {
         Logging::debug("Increasing timeout for dead analysis to 3600 seconds");
         timeout = 3600;
     }
-
-    if (!t.try_join_for(boost::chrono::seconds(timeout))) {
-        Logging::error("timeout passed while processing ", filename);
-        std::exit(EXIT_FAILURE);
-    }
+    run_with_timeout(process_file_dead_helper, filename, timeout);
 }
 
 void process_file_interesting(const std::string &check_item) {
@@ -684,7 +858,7 @@ void process_file_interesting(const std::string &check_item) {
 
     if (!main_model) {
         Logging::error("for finding interesting items a (rsf based) model must be loaded");
-        std::exit(EXIT_FAILURE);
+        throw JobFailed();
     }
     /* Find all items that are related to the given item */
     std::set<std::string> interesting{check_item};
@@ -692,18 +866,18 @@ void process_file_interesting(const std::string &check_item) {
 
     /* remove the given item again */
     interesting.erase(check_item);
-    std::cout << check_item;
+    *job_output << check_item;
 
     for (const std::string &str : interesting) {
         if (main_model->containsSymbol(str)) {
             /* Item is present in model */
-            std::cout << " " << str;
+            *job_output << " " << str;
         } else {
             /* Item is missing in this model */
-            std::cout << " !" << str;
+            *job_output << " !" << str;
         }
     }
-    std::cout << std::endl;
+    *job_output << std::endl;
 }
 
 void process_file_checkexpr(const std::string &expression) {
@@ -712,7 +886,7 @@ void process_file_checkexpr(const std::string &expression) {
     ConfigurationModel *main_model = ModelContainer::lookupMainModel();
     if (!main_model) {
         Logging::error("for finding interesting items a model must be loaded");
-        std::exit(EXIT_FAILURE);
+        throw JobFailed();
     }
     std::set<std::string> missing;
     std::string intersected;
@@ -728,10 +902,10 @@ void process_file_checkexpr(const std::string &expression) {
 
     SatChecker sc(main_model);
     if (sc(formula)) {
-        sc.getAssignment().formatKconfig(std::cout, missing);
+        sc.getAssignment().formatKconfig(*job_output, missing);
     } else {
         Logging::info("Expression is NOT satisfiable");
-        std::exit(EXIT_FAILURE);
+        throw JobFailed();
     }
 }
 
@@ -739,26 +913,26 @@ void process_file_symbolpc(const std::string &symbol) {
     ConfigurationModel *main_model = ModelContainer::lookupMainModel();
     if (!main_model) {
         Logging::error("for symbolpc models must be loaded");
-        std::exit(EXIT_FAILURE);
+        throw JobFailed();
     }
     if (main_model->containsSymbol(symbol)) {
         Logging::info("Symbol Precondition for `", symbol, "'");
     } else {
         Logging::error("Symbol `", symbol, "' not contained in main model"
                        ", not possible to calculate precondition!");
-        std::exit(EXIT_FAILURE);
+        throw JobFailed();
     }
 
     /* Find all items that are related to the given item */
     std::string result;
     std::set<std::string> missingItems;
     main_model->doIntersect(symbol, nullptr, missingItems, result);
-    std::cout << result << std::endl;
+    *job_output << result << std::endl;
 
     if (missingItems.size() > 0)
-        std::cout << "\n&&\n" << ConfigurationModel::getMissingItemsConstraints(missingItems);
+        *job_output << "\n&&\n" << ConfigurationModel::getMissingItemsConstraints(missingItems);
 
-    std::cout << std::endl;
+    *job_output << std::endl;
 }
 
 process_file_cb_t parse_job_argument(const std::string arg) {
@@ -777,6 +951,8 @@ process_file_cb_t parse_job_argument(const std::string arg) {
         return process_file_blockpc;
     } else if (arg == "blockrange") {
         return process_file_blockrange;
+    } else if (arg == "blockeval") {
+        return process_file_blockeval;
     } else if (arg == "interesting") {
         return process_file_interesting;
     } else if (arg == "checkexpr") {
@@ -791,61 +967,52 @@ process_file_cb_t parse_job_argument(const std::string arg) {
     return nullptr;
 }
 
-int wait_for_forked_child(pid_t new_pid, int threads = 1, const char *argument = nullptr,
-                          bool print_stats = false) {
-    static struct { int ok, failed, signaled; } process_stats;
-
-    static std::map<pid_t, const char *> arguments;
-    static int running_processes = 0;
-
-    if (new_pid) {
-        running_processes++;
-        if (argument)
-            arguments[new_pid] = argument;
-    }
-
-    while (running_processes >= threads) {
-        int state = 0;
-        pid_t pid = waitpid(-1, &state, 0);
-        if (pid == -1)
-            break;
+void print_batch_stats(int ok, int failed, int signaled,
+                       const std::vector<std::string> &failed_files) {
+    Logging::info("Sucessful processed:  ", ok);
+    Logging::info("Failed with exitcode: ", failed);
+    Logging::info("Failed with signal:   ", signaled);
+    for (const std::string &file : failed_files)
+        Logging::info("Failed file: ", file);
+}
 
-        if (WIFEXITED(state)) {
-            if (WEXITSTATUS(state) == 0) {
-                process_stats.ok++;
-                arguments.erase(pid);
-            } else {
-                process_stats.failed++;
-                Logging::error("Process (pid: ", pid, ", args: ", arguments[pid],
-                               ") failed with exitcode ", WEXITSTATUS(state));
-            }
-        } else if (WIFSIGNALED(state)) {
-            process_stats.signaled++;
-            Logging::error("Process (pid: ", pid, ", args: ", arguments[pid],
-                           ") failed with signal ", WTERMSIG(state));
-        } else {
-            continue;
+/**
+ * Processes all files of the worklist on 'threads' threads within this process.
+ *
+ * The loaded models are shared by all threads. A failing job (including a
+ * timeout) only marks its file as failed, but unlike the forking batch mode
+ * a crashing job takes down the whole process.
+ */
+int process_worklist_threaded(process_file_cb_t process_file,
+                              const std::vector<std::string> &workfiles, int threads,
+                              bool print_stats) {
+    std::atomic<int> ok(0);
+    std::mutex failed_lock;
+    std::vector<std::string> failed_files;
+
+    WorkStealingPool pool(threads);
+    pool.run(workfiles, [&](const std::string &file) {
+        if (run_job(process_file, file) == EXIT_SUCCESS) {
+            ok++;
+            return;
         }
-        running_processes--;
-    }
-    if (print_stats) {
-        /* Shutdown phase */
-        Logging::info("Sucessful processed:  ", process_stats.ok);
-        Logging::info("Failed with exitcode: ", process_stats.failed);
-        Logging::info("Failed with signal:   ", process_stats.signaled);
-        for (const auto &it : arguments)  // pair<pid_t, const char *>
-            Logging::info("Failed file: ", it.second);
-    }
-    if (process_stats.failed > 0)
-        return EXIT_FAILURE;
+        Logging::error("Job (args: ", file, ") failed");
+        std::lock_guard<std::mutex> guard(failed_lock);
+        failed_files.push_back(file);
+    });
+
+    if (print_stats)
+        print_batch_stats(ok, failed_files.size(), 0, failed_files);
 
-    return EXIT_SUCCESS;
+    return failed_files.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 int main(int argc, char **argv) {
     int opt;
     std::string worklist;
+    std::string index_file;
     int threads = 1;
+    bool use_threads = false;
     std::vector<std::string> models_from_parameters;
     /* Default main model will be x86 or the first one in model container if x86 is not loaded */
     std::string main_model = "default";
@@ -867,7 +1034,7 @@ int main(int argc, char **argv) {
     coverageOutputMode = CoverageOutput::KCONFIG;
     coverageMode = CoverageMode::SIMPLE;
 
-    while ((opt = getopt(argc, argv, "ucb:M:m:t:i:B:W:sj:O:C:I:Vhvq")) != -1) {
+    while ((opt = getopt(argc, argv, "ucpSQ:x:P:R:K:b:M:m:t:Ti:B:W:sj:O:C:I:Vhvq")) != -1) {
         switch (opt) {
             int n;
         case 'i':
@@ -907,6 +1074,59 @@ int main(int argc, char **argv) {
                 Logging::error("Cannot do MUS-Analysis: picomus not in PATH. Continuing without "
                                "MUS-Analysis.");
             break;
+        case 'p':
+            SatChecker::encoding = kconfig::CNFBuilder::Encoding::COMPACT;
+            break;
+        case 'S':
+            SatChecker::slicing = (SatChecker::slicing == SatChecker::Slicing::OFF)
+                ? SatChecker::Slicing::ON : SatChecker::Slicing::VERIFY;
+            break;
+        case 'Q':
+            try {
+                QueryCache::getInstance().enable(strcmp(optarg, "-") ? optarg : "");
+            } catch (kconfig::IOException &e) {
+                Logging::error(e.what());
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'x':
+            index_file = optarg;
+            break;
+        case 'P':
+            try {
+                CppFileSnapshot::enable(optarg);
+            } catch (kconfig::IOException &e) {
+                Logging::error(e.what());
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'R':
+            try {
+                ResultSink::getInstance().enable(optarg);
+            } catch (kconfig::IOException &e) {
+                Logging::error(e.what());
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'K':
+            try {
+                if (boost::filesystem::is_directory(optarg)) {
+                    // sorted, the order of the configurations is the order of the output
+                    std::vector<std::string> files;
+                    for (const auto &entry : boost::filesystem::directory_iterator(optarg))
+                        if (boost::filesystem::is_regular_file(entry.path()))
+                            files.push_back(entry.path().string());
+                    std::sort(files.begin(), files.end());
+                    for (const std::string &file : files)
+                        configurations.add(file);
+                } else {
+                    configurations.add(optarg);
+                }
+            } catch (kconfig::IOException &e) {
+                Logging::error(e.what());
+                return EXIT_FAILURE;
+            }
+            break;
         case 'c':
             process_file = process_file_coverage;
             break;
@@ -944,6 +1164,29 @@ int main(int argc, char **argv) {
             } else if (0 == strcmp(optarg, "min_decision")) {
                 decision_coverage = true;
                 coverageMode = CoverageMode::MINIMIZE;
+            } else if (0 == strncmp(optarg, "maxsat", 6)) {
+                const char *budget = &optarg[6];
+                if (0 == strncmp(budget, "_decision", 9)) {
+                    decision_coverage = true;
+                    budget += 9;
+                }
+                coverageMode = CoverageMode::MAXSAT;
+                if (*budget == ':') {
+                    char *end;
+                    errno = 0;
+                    const unsigned long secs = strtoul(budget + 1, &end, 10);
+                    // the timeout of the jobs adds a margin, see process_file_coverage
+                    if (!isdigit(budget[1]) || *end != '\0' || errno == ERANGE
+                        || secs > UINT_MAX - coverage_margin) {
+                        usage(std::cerr, "Invalid time budget for the maxsat coverage algorithm");
+                        return EXIT_FAILURE;
+                    }
+                    coverage_budget = secs;
+                } else if (*budget != '\0') {
+                    Logging::warn("mode ", optarg, " is unknown, using 'simple' instead");
+                    decision_coverage = false;
+                    coverageMode = CoverageMode::SIMPLE;
+                }
             } else {
                 Logging::warn("mode ", optarg, " is unknown, using 'simple' instead");
             }
@@ -955,6 +1198,9 @@ int main(int argc, char **argv) {
                 threads = 1;
             }
             break;
+        case 'T':
+            use_threads = true;
+            break;
         case 'M':
             /* Specify a new main arch */
             main_model = optarg;
@@ -1029,23 +1275,59 @@ int main(int argc, char **argv) {
             model->addFeatureToWhitelist(str);
     }
 
+    if ((process_file == process_file_blockeval) != (configurations.size() > 0)) {
+        usage(std::cout, "the blockeval job needs configurations (-K), other jobs don't use them");
+        return EXIT_FAILURE;
+    }
+
+    if (index_file != "") {
+        if (process_file != process_file_dead) {
+            usage(std::cout, "the index can only be used with the dead analysis");
+            return EXIT_FAILURE;
+        }
+        // the reports of indexed files are checked on disk, they would be missing every time
+        if (ResultSink::getInstance().isEnabled()) {
+            usage(std::cout, "the index can't be used with -R");
+            return EXIT_FAILURE;
+        }
+        // the results depend on these options, they must match to reuse them
+        StringJoiner settings;
+        settings.push_back(skip_non_configuration_based_defects ? "skip" : "noskip");
+        settings.push_back(do_mus_analysis ? "mus" : "nomus");
+        for (const KconfigWhitelist *list : {&KconfigWhitelist::getIgnorelist(), &wl, &bl}) {
+            settings.push_back("|");
+            settings.insert(settings.end(), list->begin(), list->end());
+        }
+        // other include paths may resolve the #includes to other files
+        const std::list<std::string> &paths = PumaConditionalBlockBuilder::getIncludePaths();
+        settings.push_back("|");
+        settings.insert(settings.end(), paths.begin(), paths.end());
+        try {
+            AnalysisIndex::getInstance().enable(index_file, settings.join(" "));
+        } catch (kconfig::IOException &e) {
+            Logging::error(e.what());
+            return EXIT_FAILURE;
+        }
+    }
+
     std::vector<std::string> workfiles;
+    /* The worklist is read while the files are processed, so it may be a pipe */
+    std::ifstream workfile;
+    std::istream *workstream = nullptr;
     if (worklist == "") {
         /* Use files from command line */
         do {
             workfiles.push_back(argv[optind++]);
         } while (optind < argc);
+    } else if (worklist == "-") {
+        workstream = &std::cin;
     } else {
-        /* Read files from worklist */
-        std::ifstream workfile(worklist);
-        std::string line;
+        workfile.open(worklist);
         if (!workfile.good()) {
             usage(std::cout, "worklist was not found");
             return EXIT_FAILURE;
         }
-        /* Collect all files that should be worked on */
-        while (std::getline(workfile, line))
-            workfiles.push_back(line);
+        workstream = &workfile;
     }
 
     /* Specify main model, if models where loaded */
@@ -1069,7 +1351,7 @@ int main(int argc, char **argv) {
     }
 
     /* Read from stdin after loading all models and whitelist */
-    if (workfiles.size() > 0 && workfiles.begin()->compare("-") == 0) {
+    if (!workstream && workfiles.begin()->compare("-") == 0) {
         std::string line;
         /* Read from stdin and call process file for every line */
         while (1) {
@@ -1108,30 +1390,37 @@ int main(int argc, char **argv) {
                     process_mode = new_mode;
                 }
             }
-            if (line.size() > 0)
-                process_file(line);
+            if (line.size() > 0 && run_job(process_file, line) != EXIT_SUCCESS)
+                return finish(EXIT_FAILURE);
         }
-    } else if (workfiles.size() > 1) {
-        // flush stdout to prevent printing of stdout-buffer contents multiple times
-        // (can happen with fork() when startup (i.e., model loading) is finished too fast)
-        std::cout << std::flush;
-        for (const std::string &file : workfiles) {
-            pid_t pid = fork();
-            if (pid == 0) { /* child */
-                /* calling the function pointer */
-                process_file(file);
-                return EXIT_SUCCESS;
-            } else if (pid < 0) {
-                Logging::error("forking failed. Exiting.");
-                return EXIT_FAILURE;
-            } else { /* Father process */
-                wait_for_forked_child(pid, threads, file.c_str());
-            }
+    } else if (workstream || workfiles.size() > 1) {
+        if (use_threads) {
+            std::string line;
+            while (workstream && std::getline(*workstream, line))
+                workfiles.push_back(line);
+            return finish(print_cache_stats(
+                process_worklist_threaded(process_file, workfiles, threads, threads > 1)));
         }
-        /* Wait until fork count reaches zero */
-        return wait_for_forked_child(0, 0, nullptr, threads > 1);
+        /* The workers are forked once, the job runs in the worker process */
+        PreforkPool pool(threads, [process_file](const std::string &file) {
+            // a worker with an abandoned job thread exits and is replaced
+            return finish(run_job(process_file, file));
+        });
+        if (workstream) {
+            std::string line;
+            while (std::getline(*workstream, line))
+                pool.submit(line);
+        } else {
+            for (const std::string &file : workfiles)
+                pool.submit(file);
+        }
+        const PreforkPool::Stats &stats = pool.finish();
+        if (threads > 1)
+            print_batch_stats(stats.ok, stats.failed, stats.signaled, stats.failed_items);
+
+        return print_cache_stats(stats.failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
     } else if (workfiles.size() == 1) {
-        process_file(workfiles[0]);
+        return finish(print_cache_stats(run_job(process_file, workfiles[0])));
     }
-    return EXIT_SUCCESS;
+    return print_cache_stats(EXIT_SUCCESS);
 }
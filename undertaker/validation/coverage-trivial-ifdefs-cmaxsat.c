@@ -0,0 +1,21 @@
+#if 0
+  some code
+#else
+  other code
+#endif
+
+#if 1
+  some code
+#else
+  other code
+#endif
+
+/*
+ * check-name: Coverage on trivial (#if 1 / #if 0) code with "-C maxsat"
+ * check-command: undertaker -v -j coverage -C maxsat $file
+ * check-output-start
+I: coverage-trivial-ifdefs-cmaxsat.c, Covered Blocks: 3, Bound: 3, Optimal Solutions: 1/1
+I: Removed 0 leftovers for coverage-trivial-ifdefs-cmaxsat.c
+I: coverage-trivial-ifdefs-cmaxsat.c, Found Solutions: 1, Coverage: 3/5 blocks enabled (60%)
+ * check-output-end
+ */